@@ -199,6 +199,12 @@ function(linkOpenMP TARGET_NAME)
     endif ()
 endfunction()
 
+function(linkThreads TARGET_NAME)
+    set(THREADS_PREFER_PTHREAD_FLAG ON)
+    find_package(Threads REQUIRED)
+    target_link_libraries(${TARGET_NAME} PUBLIC Threads::Threads)
+endfunction()
+
 function(addExecutable TARGET_NAME TARGET_SOURCE)
     # include windows exe info
     if (MSVC)
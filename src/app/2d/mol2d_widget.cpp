@@ -6,6 +6,7 @@
 #include "util.h"
 #include <QDebug>
 #include <cmath>
+#include <utility>
 
 Mol2DWidget::Mol2DWidget(QWidget *parent) : GestureView(parent) {
     scene = new QGraphicsScene();
@@ -47,7 +48,8 @@ void Mol2DWidget::syncMolToScene(std::shared_ptr<GuiMol> _mol) {
     float delta = (std::min)(width(), height()) * 0.1;
     mol->norm2D(width(), height(), delta, delta);
     std::unordered_map<size_t, AtomItem *> atomItemMap;
-    mol->loopAtomVec([&](Atom &_atom) {
+    // 只读遍历，不触发写时复制
+    for (const Atom &_atom: std::as_const(*mol).atoms()) {
         auto atomItem = new AtomItem(_atom.getId());
         atomItem->setHTML(getRichText(_atom.getName()));
         if (std::isnan(_atom.x0) || std::isnan(_atom.y0)) {
@@ -61,18 +63,18 @@ void Mol2DWidget::syncMolToScene(std::shared_ptr<GuiMol> _mol) {
         }
 //        qDebug() << __FUNCTION__ << "add atom, implicit=" << _atom.isImplicit();
         scene->addItem(atomItem);
-    });
-    mol->loopBondVec([&](Bond &_bond) {
-        auto bondItem = new BondItem(_bond.getId());
+    }
+    for (const Bond &_bond: std::as_const(*mol).bonds()) {
         auto from = _bond.getFrom(), to = _bond.getTo();
-        if (!(from && to)) { return; }
+        if (!(from && to)) { continue; }
         auto itFrom = atomItemMap.find(from->getId()), itTo = atomItemMap.find(to->getId());
-        if (atomItemMap.end() == itFrom) { return; }
-        if (atomItemMap.end() == itTo) { return; }
+        if (atomItemMap.end() == itFrom) { continue; }
+        if (atomItemMap.end() == itTo) { continue; }
+        auto bondItem = new BondItem(_bond.getId());
 //        qDebug() << _bond.getFromOffset() << "," << _bond.getToOffset();
         bondItem->setBond(itFrom->second, itTo->second, _bond.getType(), _bond.getFromOffset(), _bond.getToOffset());
         scene->addItem(bondItem);
-    });
+    }
     // 图元显示的位置依赖确定的窗体布局
     update();
 }
@@ -114,7 +116,7 @@ void Mol2DWidget::endWaitHint() {
 QString Mol2DWidget::makeAtomInfo(const size_t &_aid) {
     QString info = tr("atom (global id=") + QString::number(_aid) + tr(") picked\n");
     if (mol) {
-        auto atom = mol->getAtom(_aid);
+        auto atom = std::as_const(*mol).getAtom(_aid);
         if (atom) {
             info.append("\n" + tr("element: ") + QString::fromStdString(atom->getName()));
             if (ElementType::SA != atom->getType()) {
@@ -128,7 +130,7 @@ QString Mol2DWidget::makeAtomInfo(const size_t &_aid) {
 QString Mol2DWidget::makeBondInfo(const size_t &_bid) {
     QString info = tr("bond (global id=") + QString::number(_bid) + tr(") picked\n");
     if (mol) {
-        auto bond = mol->getBond(_bid);
+        auto bond = std::as_const(*mol).getBond(_bid);
         if (bond) {
             info.append("\n" + tr("type: ") + getBondName(*bond));
             auto from = bond->getFrom();
@@ -10,6 +10,7 @@
 #include <QTimer>
 #include <QDebug>
 #include <QMessageBox>
+#include <utility>
 
 View2DWidget::View2DWidget(QWidget *parent)
         : QWidget(parent), ui(new Ui::View2DWidget), hyBtnClickTimes(0), expBtnClickTimes(0) {
@@ -61,12 +62,12 @@ void View2DWidget::showFormatDialog() {
     auto mol = MolManager::GetInstance().getFullHydrogenExpandedMol(false);
     if (mol) {
         bool hasSuperAtom = false;
-        mol->loopAtomVec([&](Atom &atom) {
+        for (const Atom &atom: std::as_const(*mol).atoms()) {
             if (ElementType::SA == atom.getType()) {
                 hasSuperAtom = true;
-                return;
+                break;
             }
-        });
+        }
         try {
             if (hasSuperAtom) {
                 QMessageBox::information(
@@ -76,7 +77,7 @@ void View2DWidget::showFormatDialog() {
                            "You can use 'expand' and 'see H' button to try again"),
                         QMessageBox::Yes);
             }
-            QString content = QString::fromStdString(mol->writeAs(currentFormat));
+            QString content = QString::fromStdString(mol->writeAs(currentFormat, Coord3DQuality::Fast));
             formatDialog->setFormatContent(content);
         } catch (...) {
             formatDialog->setFormatContent(tr("Format algorithm failed on your molecule"));
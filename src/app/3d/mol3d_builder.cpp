@@ -17,7 +17,9 @@
 #include <Qt3DExtras/QSphereMesh>
 #include <Qt3DExtras/QPhongMaterial>
 #include <QDebug>
+#include <utility>
 
+#include <algorithm>
 #include <optional>
 
 
@@ -47,8 +49,9 @@ void Mol3DBuilder::build() {
     float avgBondLength = mol->getAvgBondLength();
     if (avgBondLength < 1)avgBondLength = 20;
     // 添加3D原子球
-    mol->loopAtomVec([&](Atom &atom) {
-//        return;
+    // 只读遍历，不触发写时复制
+    for (const Atom &atom: std::as_const(*mol).atoms()) {
+//        continue;
         auto wrapper = std::make_shared<SphereWrapper>(molRoot);
         atoms[atom.getId()] = wrapper;
 //        qDebug() << getQVector3D(atom);
@@ -59,59 +62,48 @@ void Mol3DBuilder::build() {
         wrapper->setScale(1);
         wrapper->setRindsAndSlices(100, 100);
         wrapper->setObjectName(atom.getName().c_str() + QString(":%0").arg(atom.getId()));
-    });
+    }
     // 统计共轭键的共面原子，计算用于修正双键的中轴旋转角度
     std::unordered_map<size_t, QVector3D> normVecMap;
-    std::unordered_map<size_t, std::vector<size_t>> neighborMap;
-    // 初始化原子的邻接原子
-    mol->loopBondVec([&](Bond &bond) {
-        auto from = bond.getFrom()->getId(), to = bond.getTo()->getId();
-        neighborMap[from].push_back(to);
-        neighborMap[to].push_back(from);
-    });
-    // 寻找需要共面的共轭键
-    mol->loopBondVec([&](Bond &bond) {
+    auto graph = mol->getGraph();
+    using index_type = MolGraph::index_type;
+    auto get_pos = [&](const index_type &_i) -> QVector3D {
+        const auto&[x, y, z]=graph->getPos3D(_i);
+        return {x, y, z};
+    };
+    // 寻找需要共面的共轭键，邻接关系直接用图快照的 CSR
+    std::vector<index_type> aids;
+    graph->forEachBond([&](const index_type &_bIdx) {
         std::vector<QVector3D> poses;
-        switch (bond.getType()) {
+        const index_type from = graph->getBondFrom(_bIdx), to = graph->getBondTo(_bIdx);
+        switch (graph->getBondType(_bIdx)) {
             case BondType::DoubleBond:
-                poses = {getQVector3D(bond.getFrom()), getQVector3D(bond.getTo())};
+                poses = {get_pos(from), get_pos(to)};
                 break;
             case BondType::TripleBond:
                 break;
             default:
                 return;
         }
-        size_t from = bond.getFrom()->getId(), to = bond.getTo()->getId();
-        std::unordered_set<size_t> aids = {from, to};
-        auto collect_neb_pos = [&](const size_t &aid) {
-            auto it = neighborMap.find(aid);
-            if (it == neighborMap.end()) { return; }
-            for (auto &neb_id: it->second) {
-                auto nebIt = aids.find(neb_id);
-                if (aids.end() != nebIt) { continue; }
-                aids.insert(neb_id);
-                auto atom = mol->getAtom(neb_id);
-                poses.push_back(getQVector3D(atom));
-            }
+        aids = {from, to};
+        auto try_collect = [&](const index_type &_aIdx) {
+            if (aids.end() != std::find(aids.begin(), aids.end(), _aIdx)) { return; }
+            aids.push_back(_aIdx);
+            poses.push_back(get_pos(_aIdx));
+        };
+        auto collect_neb_pos = [&](const index_type &_aIdx) {
+            graph->forEachNeighbor(_aIdx, [&](const index_type &_neb, const index_type &) {
+                try_collect(_neb);
+            });
         };
         collect_neb_pos(from);
         collect_neb_pos(to);
         // 对于三键，存在直连原子不足的问题，找邻居的邻居
         if (poses.size() < 3) {
-            auto collect_neb_2_pos = [&](const size_t &aid) {
-                auto it = neighborMap.find(aid);
-                if (it == neighborMap.end()) { return; }
-                for (auto &neb_id: it->second) {
-                    auto it2 = neighborMap.find(neb_id);
-                    if (it2 == neighborMap.end()) { continue; }
-                    for (auto &neb_2_id: it2->second) {
-                        auto nebIt = aids.find(neb_2_id);
-                        if (aids.end() != nebIt) { continue; }
-                        aids.insert(neb_2_id);
-                        auto atom = mol->getAtom(neb_2_id);
-                        poses.push_back(getQVector3D(atom));
-                    }
-                }
+            auto collect_neb_2_pos = [&](const index_type &_aIdx) {
+                graph->forEachNeighbor(_aIdx, [&](const index_type &_neb, const index_type &) {
+                    collect_neb_pos(_neb);
+                });
             };
             collect_neb_2_pos(from);
             collect_neb_2_pos(to);
@@ -119,12 +111,12 @@ void Mol3DBuilder::build() {
 //        qDebug() << "poses.size()=" << poses.size();
         if (poses.size() >= 3) {
 //            qDebug() << "add with absent neb";
-            normVecMap[bond.getId()] = QVector3D::crossProduct(poses[0] - poses[1], poses[1] - poses[2]);
+            normVecMap[graph->getBondId(_bIdx)] = QVector3D::crossProduct(poses[0] - poses[1], poses[1] - poses[2]);
         }
     });
     float bondRadius = avgBondLength / 30;
-    mol->loopBondVec([&](Bond &bond) {
-//        return;
+    for (const Bond &bond: std::as_const(*mol).bonds()) {
+//        continue;
         auto fromAtom = bond.getFrom(), toAtom = bond.getTo();
         QVector3D from = getQVector3D(fromAtom), to = getQVector3D(toAtom);
         std::shared_ptr<BaseWrapper> wrapper;
@@ -177,7 +169,7 @@ void Mol3DBuilder::build() {
         wrapper->setId(bond.getId());
         wrapper->setObjectName(QString("bond:%0").arg(bond.getId()));
         bonds[bond.getId()] = wrapper;
-    });
+    }
     emit sig_mol_build_done();
 }
 
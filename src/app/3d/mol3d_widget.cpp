@@ -1,6 +1,7 @@
 #include "3d/mol3d_widget.h"
 #include "ckit/mol.h"
 #include "ckit/atom.h"
+#include "ckit/conformer_service.h"
 #include "3d/mol3d_window.h"
 #include "3d/mol3d_builder.h"
 #include "ui/waithint_widget.h"
@@ -10,8 +11,10 @@
 #include <QDebug>
 #include <QGesture>
 #include <QThreadPool>
+#include <utility>
 
-Mol3DWidget::Mol3DWidget(QWidget *parent) : QWidget(parent), mol(nullptr), minViewWidth(200) {
+Mol3DWidget::Mol3DWidget(QWidget *parent) : QWidget(parent), mol(nullptr), minViewWidth(200),
+                                            conformerService(std::make_unique<ConformerService>(1)), refineSerial(0) {
     root = new Qt3DCore::QEntity();
 
     builder = new Mol3DBuilder(this, root);
@@ -31,6 +34,12 @@ Mol3DWidget::Mol3DWidget(QWidget *parent) : QWidget(parent), mol(nullptr), minVi
     // prepare 运行在子线程， build 运行在 UI 线程
     connect(builder, &Mol3DBuilder::sig_mol_prepare_done, builder, &Mol3DBuilder::build);
     connect(builder, &Mol3DBuilder::sig_mol_build_done, this, &Mol3DWidget::endWaitHint);
+    connect(builder, &Mol3DBuilder::sig_mol_build_done, this, &Mol3DWidget::startRefine);
+}
+
+Mol3DWidget::~Mol3DWidget() {
+    // 等工作线程退出，之后不会再有回调投递过来
+    conformerService.reset();
 }
 
 void Mol3DWidget::syncMolToScene(std::shared_ptr<GuiMol> _mol) {
@@ -38,13 +47,54 @@ void Mol3DWidget::syncMolToScene(std::shared_ptr<GuiMol> _mol) {
     window->reset();
     qDebug() << __FUNCTION__;
     minViewWidth = (std::min)(width(), height()) / 6;
+    if (refineTask) {
+        refineTask->cancel();
+        refineTask = nullptr;
+    }
+    ++refineSerial;
     QThreadPool::globalInstance()->start([&]() {
 //        QThread::msleep(500);
+        mol->generate3D(Coord3DQuality::Builder);
         builder->prepare(mol, {minViewWidth, minViewWidth, minViewWidth});
     });
     startWaitHint();
 }
 
+void Mol3DWidget::startRefine() {
+    // 预览建好后提交一次，此时 mol 不再被预览线程改动；优化结果建好时也会走到这里
+    if (!mol || refineTask) { return; }
+    const size_t serial = refineSerial;
+    ConformerService::Options options;
+    options.onProgress = [this, serial](const float &_progress) {
+        QMetaObject::invokeMethod(this, [this, serial, _progress]() {
+            if (serial == refineSerial) { emit sig_refine_progress(_progress); }
+        }, Qt::QueuedConnection);
+    };
+    options.onFinished = [this, serial](const ConformerState &) {
+        QMetaObject::invokeMethod(this, [this, serial]() {
+            onRefineFinished(serial);
+        }, Qt::QueuedConnection);
+    };
+    refineTask = conformerService->submit(mol, options);
+}
+
+void Mol3DWidget::onRefineFinished(const size_t &_serial) {
+    // 分子已经换过了
+    if (_serial != refineSerial || !refineTask) { return; }
+    emit sig_refine_progress(1);
+    if (ConformerState::Done != refineTask->getState()) {
+        qDebug() << "refine conformer ends with state" << static_cast<int>(refineTask->getState());
+        return;
+    }
+    // 优化后的副本保留原子 id，拾取信息照常可用；提交过的任务留着，避免这次重建再触发优化
+    // norm3D 在子线程做完，build 经 sig_mol_prepare_done 回到 UI 线程
+    mol = refineTask->getMol();
+    const QVector3D viewSize(minViewWidth, minViewWidth, minViewWidth);
+    QThreadPool::globalInstance()->start([this, refined = mol, viewSize]() {
+        builder->prepare(refined, viewSize);
+    });
+}
+
 void Mol3DWidget::startWaitHint() {
     mol3DWindowContainer->hide();
     hintWidget->startWaitHint();
@@ -62,7 +112,7 @@ void Mol3DWidget::resizeEvent(QResizeEvent *e) {
 QString Mol3DWidget::makeAtomInfo(const size_t &_aid) {
     QString info = tr("atom (global id=") + QString::number(_aid) + tr(") picked\n");
     if (mol) {
-        auto atom = mol->getAtom(_aid);
+        auto atom = std::as_const(*mol).getAtom(_aid);
         if (atom) {
             info.append("\n" + tr("element: ") + QString::fromStdString(atom->getName()));
             if (ElementType::SA != atom->getType()) {
@@ -76,7 +126,7 @@ QString Mol3DWidget::makeAtomInfo(const size_t &_aid) {
 QString Mol3DWidget::makeBondInfo(const size_t &_bid) {
     QString info = tr("bond (global id=") + QString::number(_bid) + tr(") picked\n");
     if (mol) {
-        auto bond = mol->getBond(_bid);
+        auto bond = std::as_const(*mol).getBond(_bid);
         if (bond) {
             info.append("\n" + tr("type: ") + getBondName(*bond));
             auto from = bond->getFrom();
@@ -1,6 +1,7 @@
 #pragma once
 //#include "gesture_widget.h"
 #include <QWidget>
+#include <memory>
 
 class Mol3DWindow;
 
@@ -12,6 +13,10 @@ class WaitHintWidget;
 
 class GuiMol;
 
+class ConformerService;
+
+class ConformerTask;
+
 // Qt3DWindow 无法生成 QGestureEvent
 class Mol3DWidget : public QWidget {
 Q_OBJECT
@@ -22,9 +27,21 @@ Q_OBJECT
     Qt3DCore::QEntity *root;
     Mol3DBuilder *builder;
     float minViewWidth;
+    // 先显示只用 OBBuilder 拼出来的预览，后台优化完再换成优化后的构象
+    std::unique_ptr<ConformerService> conformerService;
+    std::shared_ptr<ConformerTask> refineTask;
+    // 换分子时加一，丢掉旧任务投递过来的回调
+    size_t refineSerial;
+
+    void startRefine();
+
+    void onRefineFinished(const size_t &_serial);
+
 public:
     Mol3DWidget(QWidget *parent = nullptr);
 
+    ~Mol3DWidget() override;
+
     void syncMolToScene(std::shared_ptr<GuiMol> _mol);
 
     void startWaitHint();
@@ -33,6 +50,10 @@ public:
 
     QString makeBondInfo(const size_t &_bid);
 
+signals:
+
+    void sig_refine_progress(const float &_progress);
+
 protected:
     void resizeEvent(QResizeEvent *e) override;
 
@@ -8,6 +8,7 @@
 #include "ui/format_dialog.h"
 #include "ckit/mol_util.h"
 #include "ckit/atom.h"
+#include <utility>
 
 View3DWidget::View3DWidget(QWidget *parent)
         : QWidget(parent), ui(new Ui::View3DWidget), expBtnClickTimes(0) {
@@ -34,6 +35,11 @@ View3DWidget::View3DWidget(QWidget *parent)
     auto l = new QHBoxLayout();
     mol3DWidget = new Mol3DWidget(ui->container);
     l->addWidget(mol3DWidget);
+    connect(mol3DWidget, &Mol3DWidget::sig_refine_progress, [&](const float &_progress) {
+        ui->pick_edit->setPlaceholderText(
+                _progress < 1 ? tr("optimizing 3D structure: ") + QString::number(int(_progress * 100)) + "%"
+                              : QString());
+    });
     l->setContentsMargins(0, 0, 0, 0);
     l->setSpacing(0);
     ui->container->setLayout(l);
@@ -69,12 +75,12 @@ void View3DWidget::showFormatDialog() {
     auto mol = MolManager::GetInstance().getFullHydrogenExpandedMol(false);
     if (mol) {
         bool hasSuperAtom = false;
-        mol->loopAtomVec([&](Atom &atom) {
+        for (const Atom &atom: std::as_const(*mol).atoms()) {
             if (ElementType::SA == atom.getType()) {
                 hasSuperAtom = true;
-                return;
+                break;
             }
-        });
+        }
         try {
             if (hasSuperAtom) {
                 QMessageBox::information(
@@ -84,7 +90,7 @@ void View3DWidget::showFormatDialog() {
                            "You can use 'expand' and 'see H' button to try again"),
                         QMessageBox::Yes);
             }
-            QString content = QString::fromStdString(mol->writeAs(currentFormat));
+            QString content = QString::fromStdString(mol->writeAs(currentFormat, Coord3DQuality::Fast));
             formatDialog->setFormatContent(content);
         } catch (...) {
             formatDialog->setFormatContent(tr("Format algorithm failed on your molecule"));
@@ -1,10 +1,14 @@
 #include "image_widget.h"
 #include "ui_image_widget.h"
 #include "util.h"
+#include "ocv/algorithm.h"
+#include "cocr/object_detector.h"
 
+#include <QFile>
 #include <QFileDialog>
 #include <QDebug>
 #include <QImage>
+#include <QImageReader>
 #include <QMessageBox>
 
 ImageWidget::ImageWidget(QWidget *parent) :
@@ -45,7 +49,33 @@ void ImageWidget::openImage() {
         return;
     }
     image = std::make_shared<QImage>();
-    if (image->load(fileName)) {
+#ifndef Q_OS_WASM
+    // 大图在解码阶段就按 1/2、1/4、1/8 缩小，长边仍不小于检测器输入上限
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly)) {
+        const QByteArray bytes = file.readAll();
+        std::vector<unsigned char> buffer(bytes.begin(), bytes.end());
+        auto mat = CvUtil::BufferToGrayMat(buffer, ObjectDetector::DEFAULT_MAX_SIDE);
+        if (mat.getWidth() > 0 && mat.getHeight() > 0) {
+            *image = QImage(mat.getData(), mat.getWidth(), mat.getHeight(), mat.getWidth(),
+                            QImage::Format_Grayscale8).copy();
+        }
+    }
+#endif
+    if (image->isNull()) {
+        // OpenCV 不认识的格式交给 Qt，同样按倍数缩小
+        QImageReader reader(fileName);
+        const QSize srcSize = reader.size();
+        if (srcSize.isValid()) {
+            int factor = CvUtil::GetReduceFactor(
+                    {srcSize.width(), srcSize.height()}, ObjectDetector::DEFAULT_MAX_SIDE);
+            if (factor > 1) {
+                reader.setScaledSize(srcSize / factor);
+            }
+        }
+        reader.read(image.get());
+    }
+    if (!image->isNull()) {
         *image = image->convertToFormat(QImage::Format_Grayscale8);
         showImage();
         emit sig_modified();
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "els_base_export.h"
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <type_traits>
+
+enum class LogLevel : int {
+    Trace = 0, Debug, Info, Warn, Error, Off
+};
+
+/**
+ * 编译期的最低日志级别，低于它的日志语句连同参数求值一起被编译掉
+ * 发布构建可以定义为 3（Warn），不需要打日志时定义为 5（Off）
+ */
+#ifndef ELS_LOG_COMPILE_LEVEL
+#define ELS_LOG_COMPILE_LEVEL 0
+#endif
+
+/**
+ * 分级日志：每个线程把日志攒在自己的缓冲里，攒满、遇到 Error 或线程退出时一次写到 stderr
+ * 运行期级别之下的日志只付出一次比较，参数不会求值
+ */
+class ELS_BASE_EXPORT Log {
+    static std::atomic<int> sLevel;
+    inline static const size_t sFlushSize = 4096;
+
+    static std::string &GetBuffer();
+
+public:
+    static void SetLevel(const LogLevel &_level);
+
+    static LogLevel GetLevel();
+
+    static bool IsEnabled(const LogLevel &_level) {
+        return static_cast<int>(_level) >= sLevel.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * 把当前线程攒下的日志写到 stderr
+     */
+    static void Flush();
+
+    /**
+     * 一条日志，析构时追加换行并交给当前线程的缓冲
+     */
+    class ELS_BASE_EXPORT Line {
+        LogLevel level;
+        std::string &buffer;
+
+        void append(const double &_value);
+
+        void append(const long long &_value);
+
+        void append(const unsigned long long &_value);
+
+    public:
+        Line(const LogLevel &_level, const char *_func);
+
+        ~Line();
+
+        Line(const Line &) = delete;
+
+        Line &operator=(const Line &) = delete;
+
+        Line &operator<<(const std::string_view &_text) {
+            buffer.append(_text.data(), _text.size());
+            buffer.push_back(' ');
+            return *this;
+        }
+
+        Line &operator<<(const char *_text) {
+            return *this << std::string_view(_text ? _text : "(null)");
+        }
+
+        Line &operator<<(const std::string &_text) {
+            return *this << std::string_view(_text);
+        }
+
+        Line &operator<<(const char &_c) {
+            buffer.push_back(_c);
+            buffer.push_back(' ');
+            return *this;
+        }
+
+        Line &operator<<(const bool &_value) {
+            return *this << std::string_view(_value ? "true" : "false");
+        }
+
+        template<typename T>
+        Line &operator<<(const T &_value) {
+            if constexpr (std::is_enum_v<T>) {
+                append(static_cast<long long>(_value));
+            } else if constexpr (std::is_floating_point_v<T>) {
+                append(static_cast<double>(_value));
+            } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+                append(static_cast<long long>(_value));
+            } else if constexpr (std::is_integral_v<T>) {
+                append(static_cast<unsigned long long>(_value));
+            } else {
+                std::ostringstream out;
+                out << _value;
+                *this << out.str();
+            }
+            return *this;
+        }
+    };
+};
+
+#define ELS_LOG(_level) \
+    if (static_cast<int>(LogLevel::_level) < ELS_LOG_COMPILE_LEVEL || !Log::IsEnabled(LogLevel::_level)) {} \
+    else Log::Line(LogLevel::_level, __FUNCTION__)
+
+#define LOG_TRACE ELS_LOG(Trace)
+#define LOG_DEBUG ELS_LOG(Debug)
+#define LOG_INFO ELS_LOG(Info)
+#define LOG_WARN ELS_LOG(Warn)
+#define LOG_ERROR ELS_LOG(Error)
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "els_base_export.h"
+#include <string>
+#include <cstddef>
+
+/**
+ * 只读的内存映射文件，映射在对象析构时解除
+ * 空文件不建立映射，isOpen 返回 false
+ */
+class ELS_BASE_EXPORT MappedFile {
+    const char *ptr = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void *fileHandle = nullptr, *mapHandle = nullptr;
+#endif
+
+public:
+    MappedFile() = default;
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    /**
+     * 打开失败时抛出 std::runtime_error
+     */
+    void open(const std::string &_path);
+
+    void close();
+
+    bool isOpen() const;
+
+    const char *data() const;
+
+    size_t size() const;
+};
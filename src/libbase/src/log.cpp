@@ -0,0 +1,82 @@
+#include "base/log.h"
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * 环境变量 ELS_LOG_LEVEL 取 0~5，对应 LogLevel，默认只输出警告和错误
+ */
+static int GetInitialLevel() {
+    if (const char *env = std::getenv("ELS_LOG_LEVEL")) {
+        const int level = std::atoi(env);
+        if (static_cast<int>(LogLevel::Trace) <= level && level <= static_cast<int>(LogLevel::Off)) {
+            return level;
+        }
+    }
+    return static_cast<int>(LogLevel::Warn);
+}
+
+std::atomic<int> Log::sLevel{GetInitialLevel()};
+
+static void WriteToStderr(std::string &_text) {
+    if (_text.empty()) { return; }
+    std::fwrite(_text.data(), 1, _text.size(), stderr);
+    std::fflush(stderr);
+    _text.clear();
+}
+
+namespace {
+    // 线程退出时把没写出去的日志补上
+    struct ThreadBuffer {
+        std::string text;
+
+        ~ThreadBuffer() { WriteToStderr(text); }
+    };
+}
+
+std::string &Log::GetBuffer() {
+    thread_local ThreadBuffer buffer;
+    return buffer.text;
+}
+
+void Log::SetLevel(const LogLevel &_level) {
+    sLevel.store(static_cast<int>(_level), std::memory_order_relaxed);
+}
+
+LogLevel Log::GetLevel() {
+    return static_cast<LogLevel>(sLevel.load(std::memory_order_relaxed));
+}
+
+void Log::Flush() {
+    WriteToStderr(GetBuffer());
+}
+
+Log::Line::Line(const LogLevel &_level, const char *_func) : level(_level), buffer(GetBuffer()) {
+    static const char *sTags[] = {"[T]", "[D]", "[I]", "[W]", "[E]", "[-]"};
+    *this << sTags[static_cast<int>(_level)] << _func;
+}
+
+Log::Line::~Line() {
+    buffer.back() = '\n';
+    if (level >= LogLevel::Error || buffer.size() >= sFlushSize) {
+        WriteToStderr(buffer);
+    }
+}
+
+void Log::Line::append(const double &_value) {
+    char text[32];
+    const int length = std::snprintf(text, sizeof(text), "%g", _value);
+    *this << std::string_view(text, length);
+}
+
+void Log::Line::append(const long long &_value) {
+    char text[24];
+    auto[end, _] = std::to_chars(text, text + sizeof(text), _value);
+    *this << std::string_view(text, end - text);
+}
+
+void Log::Line::append(const unsigned long long &_value) {
+    char text[24];
+    auto[end, _] = std::to_chars(text, text + sizeof(text), _value);
+    *this << std::string_view(text, end - text);
+}
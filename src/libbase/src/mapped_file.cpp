@@ -0,0 +1,90 @@
+#include "base/mapped_file.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+void MappedFile::open(const std::string &_path) {
+    close();
+#ifdef _WIN32
+    fileHandle = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (INVALID_HANDLE_VALUE == fileHandle) {
+        fileHandle = nullptr;
+        throw std::runtime_error("failed to open " + _path);
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(fileHandle, &fileSize);
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (0 == length) { return; }
+    mapHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapHandle) {
+        ptr = static_cast<const char *>(MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (!ptr) {
+        close();
+        throw std::runtime_error("failed to map " + _path);
+    }
+#else
+    const int fd = ::open(_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("failed to open " + _path);
+    }
+    struct stat st{};
+    if (0 != fstat(fd, &st)) {
+        ::close(fd);
+        throw std::runtime_error("failed to stat " + _path);
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (length > 0) {
+        void *addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (MAP_FAILED == addr) {
+            ::close(fd);
+            length = 0;
+            throw std::runtime_error("failed to map " + _path);
+        }
+        ptr = static_cast<const char *>(addr);
+    }
+    // 映射建立后文件描述符就不再需要了
+    ::close(fd);
+#endif
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (ptr) { UnmapViewOfFile(ptr); }
+    if (mapHandle) { CloseHandle(mapHandle); }
+    if (fileHandle) { CloseHandle(fileHandle); }
+    mapHandle = fileHandle = nullptr;
+#else
+    if (ptr) { munmap(const_cast<char *>(ptr), length); }
+#endif
+    ptr = nullptr;
+    length = 0;
+}
+
+bool MappedFile::isOpen() const {
+    return ptr != nullptr;
+}
+
+const char *MappedFile::data() const {
+    return ptr;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
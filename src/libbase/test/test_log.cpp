@@ -0,0 +1,16 @@
+#include <catch2/catch.hpp>
+#include "base/log.h"
+
+TEST_CASE("log below runtime level skips its arguments", "[log]") {
+    const auto oldLevel = Log::GetLevel();
+    int evaluated = 0;
+    auto touch = [&]() { return ++evaluated; };
+    Log::SetLevel(LogLevel::Warn);
+    LOG_DEBUG << "never" << touch();
+    REQUIRE(evaluated == 0);
+    Log::SetLevel(LogLevel::Trace);
+    LOG_DEBUG << "once" << touch() << 1.5f << 'c' << true << std::string("str");
+    REQUIRE(evaluated == 1);
+    Log::Flush();
+    Log::SetLevel(oldLevel);
+}
@@ -64,7 +64,7 @@ public:
     //
     void setId(const id_type &_id);
 
-    id_type getId();
+    id_type getId() const;
 
     //
     void setIsLeftToRight(bool isLeftToRight);
@@ -105,6 +105,8 @@ public:
 
     std::vector<std::pair<float, std::shared_ptr<Bond>>> &getSaBonds();
 
+    const std::vector<std::pair<float, std::shared_ptr<Bond>>> &getSaBonds() const;
+
     void insertSuperAtomBonds(std::shared_ptr<Bond> _bond, const float &_offset);
 
     //
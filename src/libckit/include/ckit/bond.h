@@ -66,6 +66,8 @@ public:
     //
     int getBondOrder() const;
 
+    static int GetBondOrder(const BondType &_type);
+
     void setOrder(const int &_order);
 
     //
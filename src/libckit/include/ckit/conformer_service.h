@@ -0,0 +1,109 @@
+#pragma once
+
+#include "els_ckit_export.h"
+#include "ckit/config.h"
+#include "ckit/mol_util.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class ConformerState {
+    Pending, Running, Done, Failed, Cancelled, TimedOut
+};
+
+/**
+ * 一个后台构象生成任务的句柄，可以跨线程查询、取消和等待
+ */
+class ELS_CKIT_EXPORT ConformerTask {
+    friend class ConformerService;
+
+    gui_mol mol;
+    Coord3DQuality quality;
+    std::chrono::milliseconds timeBudget;
+    std::function<void(const float &)> onProgress;
+    std::function<void(const ConformerState &)> onFinished;
+    std::atomic<ConformerState> state;
+    std::atomic<float> progress;
+    std::atomic<bool> isCancelled;
+    std::promise<ConformerState> promise;
+    std::shared_future<ConformerState> future;
+
+    void finish(const ConformerState &_state);
+
+public:
+    ConformerTask(gui_mol _mol, const Coord3DQuality &_quality);
+
+    /**
+     * 还在排队的任务不再运行，正在运行的任务在力场的下一个检查点放弃
+     */
+    void cancel();
+
+    float getProgress() const;
+
+    ConformerState getState() const;
+
+    /**
+     * 阻塞到任务结束
+     */
+    ConformerState wait() const;
+
+    std::shared_future<ConformerState> getFuture() const;
+
+    /**
+     * 服务持有的独立副本，Done 之后原子的三维坐标可用
+     */
+    gui_mol getMol() const;
+};
+
+/**
+ * 在固定数量的工作线程上异步生成三维坐标，单个分子卡住时只占一个线程
+ * 提交时复制一份分子，结果写进和原分子共享的几何缓存，原分子之后同一档次的导出直接命中缓存
+ */
+class ELS_CKIT_EXPORT ConformerService {
+public:
+    struct Options {
+        Coord3DQuality quality = Coord3DQuality::Refined;
+        // 单个分子的时间预算，从开始运行算起，不含排队时间；0 表示不限
+        std::chrono::milliseconds timeBudget{10000};
+        // 在工作线程上回调，进度是 0 到 1
+        std::function<void(const float &)> onProgress;
+        // 在工作线程上回调，取消排队中的任务时在调用 cancel 的线程上回调
+        std::function<void(const ConformerState &)> onFinished;
+    };
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::shared_ptr<ConformerTask>> tasks;
+    std::vector<std::shared_ptr<ConformerTask>> runningTasks;
+    bool isStopped;
+
+    void work();
+
+public:
+    /**
+     * @param _threadNum 0 表示取硬件线程数的一半，至少一个
+     */
+    explicit ConformerService(const size_t &_threadNum = 0);
+
+    /**
+     * 取消所有任务并等工作线程退出
+     */
+    ~ConformerService();
+
+    ConformerService(const ConformerService &) = delete;
+
+    ConformerService &operator=(const ConformerService &) = delete;
+
+    std::shared_ptr<ConformerTask> submit(const gui_mol &_mol, const Options &_options);
+
+    std::shared_ptr<ConformerTask> submit(const gui_mol &_mol);
+};
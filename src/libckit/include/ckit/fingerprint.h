@@ -0,0 +1,55 @@
+#pragma once
+
+#include "els_ckit_export.h"
+#include "ckit/mol_graph.h"
+
+#include <array>
+#include <cstdint>
+
+enum class FingerprintType : uint32_t {
+    // 长度不超过 7 根键的线性路径
+    Path = 0,
+    // 半径为 2 的原子环境，类似 ECFP4
+    Circular = 1
+};
+
+/**
+ * 在分子图上计算的定长位指纹，只看重原子
+ * 显式氢折叠进所连原子的氢计数，凯库勒式的芳环和离域键得到相同的指纹
+ */
+class ELS_CKIT_EXPORT Fingerprint {
+public:
+    inline static const size_t sBitNum = 2048;
+    inline static const size_t sWordNum = sBitNum / 64;
+private:
+    std::array<uint64_t, sWordNum> words{};
+    uint64_t graphHash = 0;
+
+public:
+    static Fingerprint FromGraph(const MolGraph &_graph, const FingerprintType &_type = FingerprintType::Circular);
+
+    const uint64_t *data() const;
+
+    /**
+     * 只由拓扑决定的规范哈希，同一个分子的不同画法、不同原子顺序得到相同的值，不含立体信息
+     * 不同分子碰撞的概率很小但不为零
+     */
+    const uint64_t &getGraphHash() const;
+
+    bool test(const size_t &_bit) const;
+
+    void set(const size_t &_bit);
+
+    size_t count() const;
+
+    bool operator==(const Fingerprint &_other) const;
+
+    static size_t PopCount(const uint64_t *_words);
+
+    /**
+     * 交集的位数，_a、_b 各有 sWordNum 个字
+     */
+    static size_t PopCountAnd(const uint64_t *_a, const uint64_t *_b);
+
+    static float Tanimoto(const Fingerprint &_a, const Fingerprint &_b);
+};
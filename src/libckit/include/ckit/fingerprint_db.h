@@ -0,0 +1,73 @@
+#pragma once
+
+#include "els_ckit_export.h"
+#include "ckit/fingerprint.h"
+#include "base/mapped_file.h"
+
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * 参考化合物库的指纹索引，文件可以直接内存映射，打开时不做解析
+ * 布局：文件头、指纹（每条 sWordNum 个字）、位数、规范哈希、按哈希排序的下标、原始行的偏移和文本
+ */
+class ELS_CKIT_EXPORT FingerprintDB {
+public:
+    struct Hit {
+        size_t index;
+        float similarity;
+    };
+private:
+    MappedFile file;
+    FingerprintType type = FingerprintType::Circular;
+    size_t count = 0;
+    const uint64_t *words = nullptr;
+    const uint32_t *popCounts = nullptr;
+    const uint64_t *graphHashes = nullptr;
+    const uint32_t *hashOrder = nullptr;
+    const uint64_t *textOffsets = nullptr;
+    const char *text = nullptr;
+
+public:
+    /**
+     * 从每行一个分子的 SMILES 文件建库，行内第一个空白之后的内容作为名字原样保留
+     * 解析失败的行跳过并记一条警告
+     * @return 入库的分子数
+     */
+    static size_t Build(std::istream &_in, const std::string &_path,
+                        const FingerprintType &_type = FingerprintType::Circular);
+
+    /**
+     * 文件不存在或格式不对时抛出 std::runtime_error
+     */
+    void open(const std::string &_path);
+
+    size_t size() const;
+
+    const FingerprintType &getType() const;
+
+    /**
+     * 建库时的原始行
+     */
+    std::string_view getRecord(const size_t &_index) const;
+
+    std::string_view getSmiles(const size_t &_index) const;
+
+    /**
+     * 按相似度降序返回至多 _k 个最近的分子，相似度相同时下标小的在前
+     * 库很大时用 OpenMP 分块并行扫描
+     */
+    std::vector<Hit> search(const Fingerprint &_query, const size_t &_k) const;
+
+    /**
+     * 规范哈希和指纹都相同的分子，按下标升序
+     */
+    std::vector<size_t> findExact(const Fingerprint &_query) const;
+
+    /**
+     * 先查精确匹配，够 _k 个时直接返回，不再扫描全库
+     */
+    std::vector<Hit> search(const MolGraph &_graph, const size_t &_k) const;
+};
@@ -2,6 +2,8 @@
 
 #include "els_ckit_export.h"
 #include "ckit/config.h"
+#include "ckit/mol_graph.h"
+#include "ckit/mol_util.h"
 #include "base/fraction.h"
 #include "base/point2.h"
 #include "base/point3.h"
@@ -26,6 +28,9 @@ class ELS_CKIT_EXPORT Mol {
 
 class ELS_CKIT_EXPORT GuiMol {
     std::shared_ptr<ckit_deprecated::JMol> m;
+    // 图快照是按需构建的缓存，只读接口里也会刷新
+    mutable std::shared_ptr<MolGraph> graph;
+    mutable size_t graphTopologyVersion, graphCoordVersion, graphRecordVersion;
 public:
     GuiMol();
 
@@ -35,6 +40,19 @@ public:
 
     gui_mol deepClone() const;
 
+    /**
+     * 写时复制的快照，和当前分子共享原子、键，适合在副本上只做加氢、展开之类的增量修改
+     * 通过非 const 的 getAtom、getBond、atoms、bonds、loopAtomVec 拿到可写的记录前会先复制出独占的一份，
+     * const 版本只读，不复制
+     */
+    gui_mol snapshot() const;
+
+    /**
+     * 按连通片拆成独立的分子，用于盐、反应式之类的多片段结构
+     * 片段保留原子、键的 id，按片段里最小的原子 id 排序
+     */
+    std::vector<gui_mol> split() const;
+
     void addAllHydrogens();
 
     bool tryExpand();
@@ -51,16 +69,86 @@ public:
             const float &x = 0, const float &y = 0, const float &z = 0,
             bool keepRatio = true);
 
+    /**
+     * 按 coordgen 布局二维坐标，只放置上次布局之后新增的原子；先 set2DInfoLatest(false) 则整体重新布局
+     */
+    bool generate2D();
+
+    /**
+     * 同步生成三维坐标，monitor 在力场各步之间回调，返回 false 时放弃并返回 false
+     * 后台生成、超时和取消见 ConformerService
+     */
+    bool generate3D(const Coord3DQuality &quality = Coord3DQuality::Refined, const Coord3DMonitor &monitor = nullptr);
+
     float getAvgBondLength();
 
     void loopAtomVec(std::function<void(Atom &atom)> func);
 
+    void loopAtomVec(std::function<void(const Atom &atom)> func) const;
+
     void loopBondVec(std::function<void(Bond &bond)> func);
 
+    void loopBondVec(std::function<void(const Bond &bond)> func) const;
+
+    /**
+     * 按 id 升序遍历原子记录：for (Atom &atom: mol.atoms())，const 分子上得到只读记录，不触发写时复制
+     * 底层是图快照里连续的记录指针，没有 std::function 的间接调用
+     * 遍历期间不要增删原子、键，也不要调用会刷新快照的接口
+     */
+    MolGraph::RecordRange<Atom> atoms();
+
+    MolGraph::RecordRange<const Atom> atoms() const;
+
+    MolGraph::RecordRange<Bond> bonds();
+
+    MolGraph::RecordRange<const Bond> bonds() const;
+
+    template<typename Func>
+    void forEachAtom(Func &&func) {
+        for (Atom &atom: atoms()) { func(atom); }
+    }
+
+    template<typename Func>
+    void forEachAtom(Func &&func) const {
+        for (const Atom &atom: atoms()) { func(atom); }
+    }
+
+    template<typename Func>
+    void forEachBond(Func &&func) {
+        for (Bond &bond: bonds()) { func(bond); }
+    }
+
+    template<typename Func>
+    void forEachBond(Func &&func) const {
+        for (const Bond &bond: bonds()) { func(bond); }
+    }
+
+    /**
+     * 原子够多时用 OpenMP 并行，func 只能改写传入的原子，适合坐标变换
+     */
+    template<typename Func>
+    void forEachAtomParallel(Func &&func) {
+        auto range = atoms();
+        const auto n = static_cast<std::ptrdiff_t>(range.size());
+#pragma omp parallel for if(n >= MolGraph::sParallelAtomNum)
+        for (std::ptrdiff_t i = 0; i < n; i++) { func(range[i]); }
+    }
+
+    /**
+     * 当前分子的紧凑图快照，拓扑未变时复用上一次的结果
+     * 通过非 const 接口拿到可写的记录后，下一次调用会重新读取元素、电荷、键型和坐标，
+     * 所以拿到的记录要在下一次调用 getGraph 之前改写完
+     */
+    std::shared_ptr<const MolGraph> getGraph() const;
+
     std::shared_ptr<Atom> getAtom(const id_type &aid);
 
+    std::shared_ptr<const Atom> getAtom(const id_type &aid) const;
+
     std::shared_ptr<Bond> getBond(const id_type &bid);
 
+    std::shared_ptr<const Bond> getBond(const id_type &bid) const;
+
     std::shared_ptr<Atom> addAtom(
             const ElementType &element, const float &x, const float &y, const float &z = 0);
 
@@ -69,14 +157,38 @@ public:
             const BondType &type = BondType::SingleBond,
             const float &offset1 = 0.5, const float &offset2 = 0.5);
 
-    std::string writeAs(const std::string &suffix);
+    /**
+     * 先删键再删原子，删除原子不会连带删除 JMol 里的键
+     */
+    std::shared_ptr<Atom> removeAtom(const id_type &aid);
+
+    std::shared_ptr<Bond> removeBond(const id_type &bid);
+
+    /**
+     * 导出不需要坐标或只需二维坐标的格式时不跑力场；
+     * 需要三维坐标时优先复用同一拓扑算过的几何，否则按 quality 生成
+     */
+    std::string writeAs(const std::string &suffix, const Coord3DQuality &quality = Coord3DQuality::Refined);
+
+    /**
+     * 经 OpenBabel 读入，追加到当前分子
+     */
+    void readAs(const std::string &buffer, const std::string &suffix);
 
     std::shared_ptr<Atom> addSuperAtom(
             const std::string &name,
             const float &x0 = 0, const float &y0 = 0,
             const float &x1 = 0, const float &y1 = 0);
 
+    /**
+     * 在图快照上用 RingFinder 求最小环基，环上的原子按顺序排列
+     */
     std::vector<std::vector<id_type>> getSSSR();
 
+    /**
+     * OpenBabel 的实现，留作对照
+     */
+    std::vector<std::vector<id_type>> getOpenBabelSSSR();
+
     void tryMarkDoubleBond(const id_type &bid);
 };
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "els_ckit_export.h"
+#include "ckit/mol_util.h"
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * 批量转换按行存放的分子（SMILES、InChI 等）
+ * 输入逐块读入，工作线程各自持有 OpenBabel 的转换上下文和力场实例，输出保持输入顺序
+ */
+class ELS_CKIT_EXPORT MolConverter {
+public:
+    struct Options {
+        std::string inputFormat = "smi";
+        std::string outputFormat = "can";
+        // 需要三维坐标的格式按这个档次生成
+        Coord3DQuality quality = Coord3DQuality::Fast;
+        bool addHydrogens = false;
+        // 0 表示取硬件线程数
+        size_t threadNum = 0;
+        // 每块读入的分子数，读下一块和转换上一块同时进行
+        size_t chunkSize = 256;
+    };
+
+    struct Failure {
+        // 输入里的第几个分子，从 0 开始，空行不计
+        size_t index;
+        std::string input, message;
+    };
+
+    struct Report {
+        size_t total = 0;
+        std::vector<Failure> failures;
+        double seconds = 0;
+
+        double getMolsPerSecond() const;
+    };
+
+private:
+    Options options;
+
+public:
+    explicit MolConverter(const Options &_options);
+
+    /**
+     * 转换失败的分子不写出，记在 Report::failures 里
+     * 多于一个线程时会关掉 OpenBabel 的全局错误日志
+     */
+    Report convert(std::istream &_in, std::ostream &_out);
+
+    /**
+     * 转换一个分子，返回以换行结尾的一条记录；失败时抛出 std::runtime_error
+     */
+    static std::string ConvertOne(const std::string &_input, const Options &_options);
+};
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "els_ckit_export.h"
+#include "ckit/config.h"
+#include "base/point2.h"
+#include "base/point3.h"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+
+namespace ckit_deprecated {
+    class JMol;
+}
+
+/**
+ * 分子图的紧凑快照：原子、键用 [0,n) 的稠密下标，邻接表为 CSR，坐标按分量分开存
+ * 由 GuiMol::getGraph 按需构建，分子拓扑改变后重建，坐标改变后只刷新坐标，
+ * 可写的记录交出去之后重新读取元素、电荷、键型和坐标
+ * 记录指针指向分子持有的 Atom、Bond，快照不能比分子活得久
+ */
+class ELS_CKIT_EXPORT MolGraph {
+public:
+    using index_type = uint32_t;
+    inline static const index_type npos = std::numeric_limits<index_type>::max();
+    // 原子数不少于它时坐标变换才分给 OpenMP，少了线程调度的开销盖过收益
+    inline static const index_type sParallelAtomNum = 4096;
+
+    /**
+     * 连续的记录指针上的区间，解引用直接得到 Atom&、Bond&，供范围 for 使用
+     */
+    template<typename T>
+    class RecordRange {
+        template<typename>
+        friend class RecordRange;
+
+        T *const *first;
+        T *const *last;
+    public:
+        class iterator {
+            T *const *p;
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = T *;
+            using reference = T &;
+
+            explicit iterator(T *const *_p) : p(_p) {}
+
+            T &operator*() const { return **p; }
+
+            T *operator->() const { return *p; }
+
+            iterator &operator++() {
+                ++p;
+                return *this;
+            }
+
+            bool operator==(const iterator &_other) const { return p == _other.p; }
+
+            bool operator!=(const iterator &_other) const { return p != _other.p; }
+        };
+
+        RecordRange(T *const *_first, T *const *_last) : first(_first), last(_last) {}
+
+        /**
+         * 可写区间转成只读区间
+         */
+        template<typename U, typename = std::enable_if_t<std::is_same_v<const U, T> && !std::is_same_v<U, T>>>
+        RecordRange(const RecordRange<U> &_range) : first(_range.first), last(_range.last) {}
+
+        iterator begin() const { return iterator(first); }
+
+        iterator end() const { return iterator(last); }
+
+        size_t size() const { return last - first; }
+
+        T &operator[](const size_t &_i) const { return *first[_i]; }
+    };
+private:
+    // 原子
+    std::vector<id_type> atomIds;
+    std::vector<ElementType> elements;
+    std::vector<int> charges;
+    std::vector<float> xs, ys, xxs, yys, zzs;
+    std::vector<Atom *> atomRecords;
+    // 键
+    std::vector<id_type> bondIds;
+    std::vector<index_type> bondFroms, bondTos;
+    std::vector<BondType> bondTypes;
+    std::vector<Bond *> bondRecords;
+    // adjAtoms[adjStart[i], adjStart[i+1]) 为原子 i 的邻居，adjBonds 同位置为对应的键
+    std::vector<index_type> adjStart, adjAtoms, adjBonds;
+    // id 到下标的直接映射，原子和键共用一个 id 空间
+    std::vector<index_type> atomIndexOf, bondIndexOf;
+    uint64_t topologyHash = 0;
+
+    void computeTopologyHash();
+
+public:
+    MolGraph() = default;
+
+    explicit MolGraph(ckit_deprecated::JMol &_mol);
+
+    /**
+     * 拓扑不变时只从原子记录重新读取坐标
+     */
+    void updateCoords();
+
+    /**
+     * 拓扑不变时从原子、键记录重新读取元素、电荷、键型和坐标，并重算拓扑哈希
+     * @return 记录的 id 或键的端点变了时返回 false，需要重建
+     */
+    bool updateRecords();
+
+    size_t getAtomNum() const;
+
+    /**
+     * 原子 id、元素、电荷和键 id、端点、类型的哈希，不含坐标，用作几何缓存的键
+     */
+    uint64_t getTopologyHash() const;
+
+    size_t getBondNum() const;
+
+    /**
+     * @return 不存在时返回 npos
+     */
+    index_type getAtomIndex(const id_type &_aid) const;
+
+    index_type getBondIndex(const id_type &_bid) const;
+
+    const id_type &getAtomId(const index_type &_i) const;
+
+    const ElementType &getElement(const index_type &_i) const;
+
+    const int &getCharge(const index_type &_i) const;
+
+    point2f getPos2D(const index_type &_i) const;
+
+    point3f getPos3D(const index_type &_i) const;
+
+    Atom &getAtom(const index_type &_i) const;
+
+    const id_type &getBondId(const index_type &_i) const;
+
+    const index_type &getBondFrom(const index_type &_i) const;
+
+    const index_type &getBondTo(const index_type &_i) const;
+
+    const BondType &getBondType(const index_type &_i) const;
+
+    Bond &getBond(const index_type &_i) const;
+
+    /**
+     * 按下标顺序的原子、键记录
+     */
+    RecordRange<Atom> atoms() const {
+        return {atomRecords.data(), atomRecords.data() + atomRecords.size()};
+    }
+
+    RecordRange<Bond> bonds() const {
+        return {bondRecords.data(), bondRecords.data() + bondRecords.size()};
+    }
+
+    index_type getDegree(const index_type &_i) const;
+
+    /**
+     * @return 两个原子之间的键，不相连时返回 npos
+     */
+    index_type findBond(const index_type &_a1, const index_type &_a2) const;
+
+    template<typename Func>
+    void forEachAtom(Func &&_func) const {
+        for (index_type i = 0; i < atomIds.size(); i++) { _func(i); }
+    }
+
+    template<typename Func>
+    void forEachBond(Func &&_func) const {
+        for (index_type i = 0; i < bondIds.size(); i++) { _func(i); }
+    }
+
+    /**
+     * @param _func (邻居原子下标, 键下标)
+     */
+    template<typename Func>
+    void forEachNeighbor(const index_type &_i, Func &&_func) const {
+        for (index_type k = adjStart[_i]; k < adjStart[_i + 1]; k++) { _func(adjAtoms[k], adjBonds[k]); }
+    }
+};
@@ -5,6 +5,10 @@
 
 class GuiMol;
 
+/**
+ * 界面当前的输入分子和它的派生视图，派生视图取自 MolViewCache，来回切换同一个分子时不再重算
+ * 只在界面线程使用；并发的请求直接用 MolViewCache
+ */
 class ELS_CKIT_EXPORT MolManager {
     gui_mol inputMol, currentMol;
 
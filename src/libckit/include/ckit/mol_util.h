@@ -2,11 +2,60 @@
 
 #include "els_ckit_export.h"
 #include "ckit/config.h"
+#include "base/element_type.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+class MolGraph;
+
+/**
+ * 导出格式对坐标的要求
+ */
+enum class CoordRequirement {
+    None, Coord2D, Coord3D
+};
+
+/**
+ * 三维坐标的生成档次：Builder 只用 OBBuilder 拼片段，Fast 再做一轮短的最速下降，Refined 额外做构象搜索
+ */
+enum class Coord3DQuality {
+    Builder, Fast, Refined
+};
+
+/**
+ * 三维坐标生成时在力场各步之间回调，参数是 0 到 1 的进度，返回 false 表示取消
+ */
+using Coord3DMonitor = std::function<bool(const float &_progress)>;
 
 class ELS_CKIT_EXPORT MolUtil {
 public:
+    /**
+     * 表里没有登记的格式按需要三维坐标处理
+     */
+    static CoordRequirement GetCoordRequirement(const std::string &suffix);
+
     static bool IsValidWritableFormat(const std::string &suffix);
 
     // define it in specific impl
     static std::vector<std::string> GetWritableFormats();
+
+    /**
+     * 进程内只加载一次 OpenBabel 的全部插件和构建器的片段库，多线程使用 OpenBabel 前调用
+     */
+    static void InitOpenBabel();
+
+    /**
+     * 按常用邻接键级补氢，硬编码处理碳正负离子、铵正离子、氧负离子
+     * 常用邻接键级表里没有的元素不补氢
+     * @param _bondOrderSum 已有键的键级之和
+     * @return 要补的氢数，可能为负
+     */
+    static int GetHydrogenNum(const ElementType &_element, const int &_charge, const int &_bondOrderSum);
+
+    /**
+     * 一次遍历键表算出每个原子要补的氢数，不改动分子，适合不需要显式氢的导出
+     * @param _numHs 下标和 _graph 的原子下标一致，不小于 0
+     */
+    static void GetHydrogenNums(const MolGraph &_graph, std::vector<int> &_numHs);
 };
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "els_ckit_export.h"
+#include "ckit/config.h"
+#include <array>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class GuiMol;
+
+/**
+ * 从输入分子派生出来的几种视图
+ * Coord2D 是展开后的 coordgen 布局，Coord3D 是展开、补氢后的三维构象
+ */
+enum class MolViewType : size_t {
+    Expanded = 0, FullHydrogen, FullHydrogenExpanded, Coord2D, Coord3D
+};
+
+/**
+ * 派生视图的线程安全缓存，同一份输入反复识别、撤销重做、来回切换视图时不再重算
+ * 视图沿用输入的原子 id 和画法，所以按规范图加上画法索引，同一结构的不同画法各算各的
+ * 视图按原子、键数估算内存，总量超过容量时淘汰最久没用过的分子
+ * 每次取出的都是和缓存共享记录的快照，调用方改写时才复制出自己的一份，缓存里的视图不受影响
+ */
+class ELS_CKIT_EXPORT MolViewCache {
+public:
+    struct Stats {
+        size_t hitNum = 0, missNum = 0, evictionNum = 0;
+        size_t entryNum = 0, viewNum = 0, bytes = 0;
+    };
+
+private:
+    inline static const size_t sViewTypeNum = 5;
+
+    struct Entry {
+        // 校验哈希碰撞
+        std::string inputKey;
+        // 计算中的视图算完时据此判断条目是否已被淘汰、作废后重建
+        uint64_t generation;
+        // 其它线程正在计算的视图也登记在这里，后来的线程等它算完
+        std::array<std::shared_future<gui_mol>, sViewTypeNum> views;
+        std::array<size_t, sViewTypeNum> viewBytes{};
+        std::list<uint64_t>::iterator lruIt;
+    };
+
+    size_t capacity;
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, Entry> entries;
+    // 最近用过的排在最前
+    std::list<uint64_t> lru;
+    uint64_t nextGeneration;
+    Stats stats;
+
+    /**
+     * 调用时持有锁
+     */
+    Entry &touch(const uint64_t &_key, const std::string &_inputKey);
+
+    void eraseLocked(const uint64_t &_key);
+
+    void evictLocked();
+
+    gui_mol compute(const gui_mol &_input, const MolViewType &_type);
+
+public:
+    /**
+     * @param _capacity 视图的估算内存上限，字节
+     */
+    explicit MolViewCache(const size_t &_capacity = 64 * 1024 * 1024);
+
+    MolViewCache(const MolViewCache &) = delete;
+
+    MolViewCache &operator=(const MolViewCache &) = delete;
+
+    /**
+     * 字符串原子带名字的规范 SMILES，和原子顺序、id、坐标无关
+     */
+    static std::string GetCanonicalKey(GuiMol &_mol);
+
+    /**
+     * 按 id 升序的原子 id、二维坐标和键的 id、端点，和规范键合起来唯一确定一份输入
+     */
+    static std::string GetDrawingKey(GuiMol &_mol);
+
+    /**
+     * 规范键加画法键的哈希
+     */
+    static uint64_t GetKey(GuiMol &_mol);
+
+    /**
+     * 取输入分子的派生视图，没有时就地计算，多个线程同时缺同一个视图时只算一次
+     * 计算抛出的异常原样抛给所有等待的调用方，不留缓存
+     * _input 和 GuiMol 的其它接口一样不加锁，调用期间不能有别的线程同时使用它
+     */
+    gui_mol get(const gui_mol &_input, const MolViewType &_type);
+
+    /**
+     * 丢掉一个分子的全部视图，正在计算的视图算完后照常交给等待的调用方，但不再进缓存
+     */
+    void invalidate(const uint64_t &_key);
+
+    void invalidate(GuiMol &_mol);
+
+    void clear();
+
+    void setCapacity(const size_t &_capacity);
+
+    Stats getStats() const;
+
+    /**
+     * 进程内共享的一份，供界面和服务端的并发请求共用
+     */
+    static MolViewCache &GetInstance();
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "els_ckit_export.h"
+#include "ckit/mol_graph.h"
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * 一组环，所有环的原子下标首尾相接存在同一个数组里
+ * 每个环的原子按环上的顺序排列，从下标最小的原子开始，朝下标较小的邻居方向走
+ */
+class ELS_CKIT_EXPORT RingSet {
+public:
+    using index_type = MolGraph::index_type;
+
+    class Span {
+        const index_type *first, *last;
+    public:
+        Span(const index_type *_first, const index_type *_last) : first(_first), last(_last) {}
+
+        const index_type *begin() const { return first; }
+
+        const index_type *end() const { return last; }
+
+        size_t size() const { return last - first; }
+
+        const index_type &operator[](const size_t &_k) const { return first[_k]; }
+    };
+
+private:
+    std::vector<index_type> atoms;
+    // 第 i 个环是 atoms[offsets[i], offsets[i+1])
+    std::vector<uint32_t> offsets = {0};
+
+    friend class RingFinder;
+
+public:
+    void clear();
+
+    size_t size() const;
+
+    bool empty() const;
+
+    Span operator[](const size_t &_i) const;
+};
+
+/**
+ * 在分子图上做环感知，不经过 OpenBabel
+ * 候选环取自每个原子的 BFS 树（Horton），按长度排序后在 GF(2) 上逐个消元
+ * 同一个对象反复使用时复用全部临时缓冲，返回的引用在下一次调用前有效
+ */
+class ELS_CKIT_EXPORT RingFinder {
+    using index_type = MolGraph::index_type;
+    struct Candidate {
+        uint32_t length, atomOffset, wordOffset;
+    };
+    size_t atomNum, bondNum, wordNum;
+    // 图的局部 CSR 拷贝
+    std::vector<index_type> adjStart, adjAtoms, adjBonds;
+    // 桥的判定
+    std::vector<char> isRingBond;
+    std::vector<uint32_t> disc, low;
+    std::vector<index_type> stackAtoms, stackPos;
+    // BFS
+    std::vector<uint32_t> dist;
+    std::vector<index_type> parentAtoms, parentBonds, queue;
+    // 候选环：原子序列和边集位向量
+    std::vector<Candidate> candidates;
+    std::vector<index_type> candidateAtoms;
+    std::vector<uint64_t> candidateWords;
+    std::vector<uint32_t> candidateOrder;
+    // 消元得到的基
+    std::vector<uint64_t> basisWords, work;
+    std::vector<uint32_t> pivots;
+    RingSet sssr, relevantCycles;
+
+    void buildAdjacency(const MolGraph &_graph);
+
+    /**
+     * 标出所有环键（非桥），返回圈秩 E - V + C
+     */
+    size_t findRingBonds();
+
+    void collectCandidates();
+
+    /**
+     * 用前 _rowNum 行基消去 work，返回是否还有剩余
+     */
+    bool reduce(const size_t &_rowNum);
+
+    void appendBasisRow();
+
+    void appendRing(RingSet &_rings, const Candidate &_candidate);
+
+public:
+    RingFinder();
+
+    /**
+     * 最小环基（SSSR），环数等于圈秩，按环长升序
+     */
+    const RingSet &findSSSR(const MolGraph &_graph);
+
+    /**
+     * 相关环：不能由更短的环异或得到的环，是所有最小环基的并集
+     */
+    const RingSet &findRelevantCycles(const MolGraph &_graph);
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "els_ckit_export.h"
+#include "ckit/config.h"
+#include <string>
+
+class MolGraph;
+
+/**
+ * 直接在分子图上生成规范 SMILES，不经过 OpenBabel
+ * 约定和 OpenBabel 的 can 格式一致：
+ * 1、显式氢折叠进所连原子的氢计数，再按 MolUtil::GetHydrogenNums 补上隐式氢，氢计数和 SMILES 默认价态不符时写成方括号原子
+ * 2、离域键两端写成小写的芳香原子
+ * 3、实楔形、虚楔形键的起点视为手性中心，按二维坐标判断 @、@@；不处理双键顺反
+ * 4、字符串原子写成 [At]
+ */
+class ELS_CKIT_EXPORT SmilesWriter {
+public:
+    /**
+     * @param _withSuperAtomNames 为 true 时字符串原子写成 [At:名字]，名字参与规范排序；
+     * 结果只用来区分分子，不是合法的 SMILES
+     */
+    static std::string Write(const MolGraph &_graph, const bool &_withSuperAtomNames = false);
+};
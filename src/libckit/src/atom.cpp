@@ -127,7 +127,7 @@ void Atom::setId(const id_type &_id) {
     id = _id;
 }
 
-id_type Atom::getId() {
+id_type Atom::getId() const {
     return id;
 }
 
@@ -163,6 +163,10 @@ std::vector<std::pair<float, std::shared_ptr<Bond>>> &Atom::getSaBonds() {
     return saBonds;
 }
 
+const std::vector<std::pair<float, std::shared_ptr<Bond>>> &Atom::getSaBonds() const {
+    return saBonds;
+}
+
 void Atom::insertSuperAtomBonds(std::shared_ptr<Bond> _bond, const float &_offset) {
     saBonds.emplace_back(_offset, std::move(_bond));
 }
@@ -95,7 +95,11 @@ BondType Bond::getType() const {
 }
 
 int Bond::getBondOrder() const {
-    switch (bondType) {
+    return GetBondOrder(bondType);
+}
+
+int Bond::GetBondOrder(const BondType &_type) {
+    switch (_type) {
         case BondType::SingleBond:
         case BondType::SolidWedgeBond:
         case BondType::DashWedgeBond:
@@ -0,0 +1,140 @@
+#include "ckit/conformer_service.h"
+#include "ckit/mol.h"
+#include "base/log.h"
+#include <algorithm>
+#include <stdexcept>
+
+ConformerTask::ConformerTask(gui_mol _mol, const Coord3DQuality &_quality)
+        : mol(std::move(_mol)), quality(_quality), timeBudget(0), state(ConformerState::Pending), progress(0),
+          isCancelled(false), future(promise.get_future().share()) {
+}
+
+void ConformerTask::finish(const ConformerState &_state) {
+    state = _state;
+    // 先回调再兑现 future，等到结果的一方能看到回调的副作用
+    if (onFinished) { onFinished(_state); }
+    promise.set_value(_state);
+}
+
+void ConformerTask::cancel() {
+    isCancelled = true;
+    // 还没被工作线程领走的任务由这里结束，领走了的由工作线程结束
+    auto expected = ConformerState::Pending;
+    if (state.compare_exchange_strong(expected, ConformerState::Cancelled)) {
+        finish(ConformerState::Cancelled);
+    }
+}
+
+float ConformerTask::getProgress() const {
+    return progress;
+}
+
+ConformerState ConformerTask::getState() const {
+    return state;
+}
+
+ConformerState ConformerTask::wait() const {
+    return future.get();
+}
+
+std::shared_future<ConformerState> ConformerTask::getFuture() const {
+    return future;
+}
+
+gui_mol ConformerTask::getMol() const {
+    return mol;
+}
+
+ConformerService::ConformerService(const size_t &_threadNum) : isStopped(false) {
+    // 力场吃满一个核，默认给界面和其它工作留一半
+    const size_t threadNum = _threadNum > 0 ? _threadNum : (std::max)(1u, std::thread::hardware_concurrency() / 2);
+    MolUtil::InitOpenBabel();
+    for (size_t i = 0; i < threadNum; i++) {
+        threads.emplace_back([this] { work(); });
+    }
+}
+
+ConformerService::~ConformerService() {
+    std::deque<std::shared_ptr<ConformerTask>> pendingTasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopped = true;
+        pendingTasks.swap(tasks);
+        for (auto &task: runningTasks) { task->isCancelled = true; }
+    }
+    cond.notify_all();
+    for (auto &task: pendingTasks) { task->cancel(); }
+    for (auto &thread: threads) { thread.join(); }
+}
+
+std::shared_ptr<ConformerTask> ConformerService::submit(const gui_mol &_mol, const Options &_options) {
+    auto task = std::make_shared<ConformerTask>(_mol->deepClone(), _options.quality);
+    task->onProgress = _options.onProgress;
+    task->onFinished = _options.onFinished;
+    task->timeBudget = _options.timeBudget;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (isStopped) {
+            throw std::runtime_error("conformer service is stopped");
+        }
+        tasks.push_back(task);
+    }
+    cond.notify_one();
+    return task;
+}
+
+std::shared_ptr<ConformerTask> ConformerService::submit(const gui_mol &_mol) {
+    return submit(_mol, Options());
+}
+
+void ConformerService::work() {
+    while (true) {
+        std::shared_ptr<ConformerTask> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&] { return isStopped || !tasks.empty(); });
+            if (isStopped) { return; }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            auto expected = ConformerState::Pending;
+            // 排队时已被取消
+            if (!task->state.compare_exchange_strong(expected, ConformerState::Running)) { continue; }
+            runningTasks.push_back(task);
+        }
+        const auto start = std::chrono::steady_clock::now();
+        bool isTimedOut = false;
+        auto monitor = [&](const float &_progress) {
+            if (task->isCancelled) { return false; }
+            if (task->timeBudget.count() > 0 && std::chrono::steady_clock::now() - start > task->timeBudget) {
+                isTimedOut = true;
+                return false;
+            }
+            task->progress = _progress;
+            if (task->onProgress) { task->onProgress(_progress); }
+            return true;
+        };
+        bool ok = false;
+        try {
+            ok = task->mol->generate3D(task->quality, monitor);
+        } catch (std::exception &e) {
+            LOG_WARN << "generate3D throws" << e.what();
+        }
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        LOG_DEBUG << "conformer task takes" << ms << "ms, ok=" << ok;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            runningTasks.erase(std::find(runningTasks.begin(), runningTasks.end(), task));
+        }
+        if (ok) {
+            task->progress = 1;
+            task->finish(ConformerState::Done);
+        } else if (isTimedOut) {
+            task->finish(ConformerState::TimedOut);
+        } else if (task->isCancelled) {
+            task->finish(ConformerState::Cancelled);
+        } else {
+            task->finish(ConformerState::Failed);
+        }
+    }
+}
@@ -1,8 +1,10 @@
 #include "jmol.h"
 #include "jmol_p.h"
+#include "base/log.h"
 #include <cmath>
 #include <iostream>
 #include <exception>
+#include <algorithm>
 #include <ckit/mol_util.h>
 
 using namespace ckit_deprecated;
@@ -22,7 +24,8 @@ std::shared_ptr<Bond> ckit_deprecated::JMol::getBond(const id_type &_bid) {
 
 std::shared_ptr<Atom> JMol::addAtom(const ElementType &_element, const float &_x, const float &_y) {
     _p->exceedValence();
-    auto atom = std::make_shared<Atom>(idBase++, _element, _x, _y);
+    touchTopology();
+    auto atom = newAtom(idBase++, _element, _x, _y);
     atomMap[atom->getId()] = atom;
     return atom;
 }
@@ -38,6 +41,7 @@ std::shared_ptr<Atom> JMol::addAtom(
 
 std::shared_ptr<Atom> JMol::removeAtom(const id_type &_aid) {
     _p->exceedValence();
+    touchTopology();
     auto atom = getAtom(_aid);
     if (atom) { atomMap.erase(_aid); }
     return atom;
@@ -45,6 +49,7 @@ std::shared_ptr<Atom> JMol::removeAtom(const id_type &_aid) {
 
 std::shared_ptr<Bond> JMol::removeBond(const id_type &_bid) {
     _p->exceedValence();
+    touchTopology();
     auto bond = getBond(_bid);
     if (bond) { bondMap.erase(_bid); }
     return bond;
@@ -59,32 +64,30 @@ id_type JMol::getId() {
 }
 
 JMol::JMol() : id(0), is3DInfoLatest(false), is2DInfoLatest(false), idBase(0),
-               _p(std::make_shared<JMol_p>(*this)) {
+               _p(std::make_shared<JMol_p>(*this)), arena(std::make_shared<RecordArena>()),
+               topologyVersion(0), coordVersion(0), recordVersion(0), shareToken(std::make_shared<char>()) {
 
 }
 
 void JMol::loopAtomVec(std::function<void(Atom &)> _func) {
-    for (auto &[aid, atom]: atomMap) {
-        if (atom) { _func(*atom); }
-    }
+    forEachAtom(_func);
 }
 
 void JMol::loopBondVec(std::function<void(Bond &)> _func) {
-    for (auto &[bid, bond]: bondMap) {
-        if (bond) { _func(*bond); }
-    }
+    forEachBond(_func);
 }
 
 std::shared_ptr<Atom> JMol::addAtom(const int &_atomicNumber) {
     _p->exceedValence();
-    auto atom = std::make_shared<Atom>(idBase++, static_cast<ElementType>(_atomicNumber));
+    touchTopology();
+    auto atom = newAtom(idBase++, static_cast<ElementType>(_atomicNumber));
     atomMap[atom->getId()] = atom;
     return atom;
 }
 
 void JMol::display() {
     onExtraDataNeeded();
-    loopAtomVec([&](Atom &atom) {
+    forEachAtom([&](Atom &atom) {
         std::cerr << atom.getId() << ":" << atom.getName().c_str();
         if (is2DInfoLatest) {
             std::cerr << "2d(" << atom.x << "," << atom.y << ")";
@@ -93,7 +96,7 @@ void JMol::display() {
             std::cerr << "3d(" << atom.xx << "," << atom.yy << atom.zz << ")";
         }
     });
-    loopBondVec([&](Bond &bond) {
+    forEachBond([&](Bond &bond) {
         std::cerr << bond.getId() << ":" << bond.getBondOrder() << ","
                   << bond.getFrom()->getId() << "-" << bond.getTo()->getId();
     });
@@ -103,14 +106,27 @@ void JMol::onExtraDataNeeded() {
     // default behavior: do nothing
 }
 
+void JMol::onAtomUpdated(const id_type &_aid) {
+    // default behavior: do nothing
+}
+
+void JMol::onBondUpdated(const id_type &_bid) {
+    // default behavior: do nothing
+}
+
+void JMol::onRecordsExposed() {
+    // default behavior: do nothing
+}
+
 void JMol::norm2D(const float &_w, const float &_h, const float &_x, const float &_y, bool keepRatio) {
+    detachRecords();
     if (!is2DInfoLatest) {
         generate2D();
     }
     float minx, miny, maxx, maxy;
     minx = miny = std::numeric_limits<float>::max();
     maxx = maxy = std::numeric_limits<float>::lowest();
-    loopAtomVec([&](Atom &_atom) {
+    forEachAtom([&](Atom &_atom) {
         minx = std::min(minx, _atom.x);
         miny = std::min(miny, _atom.y);
         maxx = std::max(maxx, _atom.x);
@@ -119,7 +135,7 @@ void JMol::norm2D(const float &_w, const float &_h, const float &_x, const float
     float kw = (_w - _x * 3) / (maxx - minx), kh = (_h - _y * 3) / (maxy - miny);
     if (keepRatio) {
         float k = std::min(kw, kh);
-        loopAtomVec([&](Atom &_atom) {
+        forEachAtomParallel([&](Atom &_atom) {
             _atom.x = (_atom.x - minx) * k + _x;
             _atom.y = (_atom.y - miny) * k + _y;
 
@@ -129,7 +145,7 @@ void JMol::norm2D(const float &_w, const float &_h, const float &_x, const float
             _atom.y1 = (_atom.y1 - miny) * k + _y;
         });
     } else {
-        loopAtomVec([&](Atom &_atom) {
+        forEachAtomParallel([&](Atom &_atom) {
             _atom.x = (_atom.x - minx) * kw + _x;
             _atom.y = (_atom.y - miny) * kh + _y;
 
@@ -139,18 +155,20 @@ void JMol::norm2D(const float &_w, const float &_h, const float &_x, const float
             _atom.y1 = (_atom.y1 - miny) * kh + _y;
         });
     }
+    touchCoords();
 }
 
 void JMol::norm3D(const float &_xx, const float &_yy, const float &_zz,
                   const float &_x, const float &_y, const float &_z, bool keepRatio) {
-    std::cerr << __FUNCTION__;
+    detachRecords();
     if (!is3DInfoLatest) {
-        std::cerr << __FUNCTION__ << "generate3D=" << generate3D();
+        const bool ok = generate3D();
+        LOG_DEBUG << "generate3D=" << ok;
     }
     float minx, miny, minz, maxx, maxy, maxz;
     minx = miny = minz = std::numeric_limits<float>::max();
     maxx = maxy = maxz = std::numeric_limits<float>::lowest();
-    loopAtomVec([&](Atom &_atom) {
+    forEachAtom([&](Atom &_atom) {
         minx = std::min(minx, _atom.xx);
         miny = std::min(miny, _atom.yy);
         minz = std::min(minz, _atom.zz);
@@ -162,28 +180,29 @@ void JMol::norm3D(const float &_xx, const float &_yy, const float &_zz,
     float dx = (minx + maxx) / 2, dy = (miny + maxy) / 2, dz = (minz + maxz) / 2;
     if (keepRatio) {
         float k = (std::min)(kx, (std::min)(ky, kz));
-        loopAtomVec([&](Atom &_atom) {
+        forEachAtomParallel([&](Atom &_atom) {
             _atom.xx = (_atom.xx - dx) * k + _x;
             _atom.yy = (_atom.yy - dy) * k + _y;
             _atom.zz = (_atom.zz - dz) * k + _z;
         });
     } else {
-        loopAtomVec([&](Atom &_atom) {
+        forEachAtomParallel([&](Atom &_atom) {
             _atom.xx = (_atom.xx - dx) * kx + _x;
             _atom.yy = (_atom.yy - dy) * ky + _y;
             _atom.zz = (_atom.zz - dz) * kz + _y;
         });
     }
+    touchCoords();
 }
 
 float JMol::getAvgBondLength() {
-    std::cerr << __FUNCTION__;
     if (bondMap.empty()) { return 0; }
     if (!is3DInfoLatest) {
-        std::cerr << __FUNCTION__ << "generate3D=" << generate3D();
+        const bool ok = generate3D();
+        LOG_DEBUG << "generate3D=" << ok;
     }
     float avgBondLength = 0;
-    loopBondVec([&](Bond &bond) {
+    forEachBond([&](Bond &bond) {
         auto from = bond.getFrom(), to = bond.getTo();
         avgBondLength += std::sqrt(std::pow(from->xx - to->xx, 2) +
                                    std::pow(from->yy - to->yy, 2) +
@@ -194,7 +213,7 @@ float JMol::getAvgBondLength() {
 
 float JMol::getAvgBondLength2D() {
     float avgBondLength = 0;
-    loopBondVec([&](Bond &bond) {
+    forEachBond([&](Bond &bond) {
         auto from = bond.getFrom(), to = bond.getTo();
         avgBondLength += std::sqrt(std::pow(from->x - to->x, 2) +
                                    std::pow(from->y - to->y, 2));
@@ -212,6 +231,27 @@ size_t JMol::getAtomNum() const {
 
 void JMol::set2DInfoLatest(bool _is2DInfoLatest) {
     is2DInfoLatest = _is2DInfoLatest;
+    touchCoords();
+}
+
+size_t JMol::getTopologyVersion() const {
+    return topologyVersion;
+}
+
+size_t JMol::getCoordVersion() const {
+    return coordVersion;
+}
+
+size_t JMol::getRecordVersion() const {
+    return recordVersion;
+}
+
+void JMol::touchTopology() {
+    ++topologyVersion;
+}
+
+void JMol::touchCoords() {
+    ++coordVersion;
 }
 
 
@@ -219,16 +259,44 @@ std::shared_ptr<Bond> JMol::addBond(
         std::shared_ptr<Atom> _a1, std::shared_ptr<Atom> _a2, const BondType &_type,
         const float &_offset1, const float &_offset2) {
     _p->exceedValence();
-    auto bond = std::make_shared<Bond>(idBase++, _a1, _a2, _type, _offset1, _offset2);
+    touchTopology();
+    auto bond = newBond(idBase++, _a1, _a2, _type, _offset1, _offset2);
     bondMap[bond->getId()] = bond;
     return bond;
 }
 
+void JMol::addFragment(const Fragment &_fragment, std::vector<std::shared_ptr<Atom>> &_atoms,
+                       std::shared_ptr<Atom> _root) {
+    _atoms.clear();
+    if (_fragment.atoms.empty()) { return; }
+    _p->exceedValence();
+    touchTopology();
+    atomMap.reserve(atomMap.size() + _fragment.atoms.size());
+    bondMap.reserve(bondMap.size() + _fragment.bonds.size());
+    size_t i = 0;
+    if (_root) {
+        _root->setCharge(0);
+        _root->setType(_fragment.atoms[0]);
+        _atoms.push_back(std::move(_root));
+        i = 1;
+    }
+    for (; i < _fragment.atoms.size(); i++) {
+        auto atom = newAtom(idBase++, _fragment.atoms[i]);
+        atomMap[atom->getId()] = atom;
+        _atoms.push_back(std::move(atom));
+    }
+    for (auto &record: _fragment.bonds) {
+        auto bond = newBond(idBase++, _atoms[record.from], _atoms[record.to], record.type, 0.5, 0.5);
+        bondMap[bond->getId()] = bond;
+    }
+}
+
 std::shared_ptr<Atom> JMol::addSuperAtom(
         const std::string &_name, const float &_x0, const float &_y0,
         const float &_x1, const float &_y1) {
     _p->exceedValence();
-    auto atom = std::make_shared<Atom>(idBase++, _name, _x0, _y0, _x1, _y1);
+    touchTopology();
+    auto atom = newAtom(idBase++, _name, _x0, _y0, _x1, _y1);
     atomMap[atom->getId()] = atom;
     return atom;
 }
@@ -240,18 +308,49 @@ void JMol::addAllHydrogens() {
     // 1、ELEMENT_COMMON_NEB_NUM_MAP 里没有记录的，一律不加氢
     // 2、硬编码特别处理常用原子带电荷的情况，如铵正离子、碳正离子、碳负离子、氧负离子
     // 3、其它情况按照 ELEMENT_COMMON_NEB_NUM_MAP 的记录默认处理
-    loopCurrentAtomPtrVec([&](std::shared_ptr<Atom> _atom) -> void {
-        int numHs = getNumHydrogen(_atom->getId());
-        if (numHs < 1) { return; }
-        while (numHs--) {
-            auto h = addAtom(ElementType::H);
-            auto bond = addBond(_atom, h);
-            _p->addBondOrder4Atom(h->getId(), 1);
-            _p->addBondOrder4Atom(_atom->getId(), 1);
-        }
+    // 键级累加在以原子 id 为下标的数组上一次算完，加氢过程中不再查、改价态表
+    std::vector<int> orders(idBase, 0);
+    for (auto &[bid, bond]: bondMap) {
+        if (!bond) { continue; }
+        auto from = bond->getFrom(), to = bond->getTo();
+        if (!from || !to) { continue; }
+        const int order = bond->getBondOrder();
+        orders[from->getId()] += order;
+        orders[to->getId()] += order;
+    }
+    std::vector<std::pair<std::shared_ptr<Atom>, int>> targets;
+    size_t numHs = 0;
+    for (auto &[aid, atom]: atomMap) {
+        if (!atom) { continue; }
+        const int num = MolUtil::GetHydrogenNum(atom->getType(), atom->getCharge(), orders[aid]);
+        if (num < 1) { continue; }
+        targets.emplace_back(atom, num);
+        numHs += num;
+    }
+    if (0 == numHs) { return; }
+    // 按原子 id 排序，氢的编号不依赖哈希表的遍历顺序
+    std::sort(targets.begin(), targets.end(), [](const auto &_a, const auto &_b) {
+        return _a.first->getId() < _b.first->getId();
     });
-    // 这里我之前有维护好加氢数据
-    _p->confirmValence();
+    _p->exceedValence();
+    touchTopology();
+    atomMap.reserve(atomMap.size() + numHs);
+    bondMap.reserve(bondMap.size() + numHs);
+    // 先连续分配全部氢原子的 id，再分配键的 id
+    std::vector<std::shared_ptr<Atom>> hydrogens;
+    hydrogens.reserve(numHs);
+    for (size_t i = 0; i < numHs; i++) {
+        auto h = newAtom(idBase++, ElementType::H);
+        atomMap[h->getId()] = h;
+        hydrogens.push_back(std::move(h));
+    }
+    auto h = hydrogens.begin();
+    for (auto &[atom, num]: targets) {
+        for (int i = 0; i < num; i++) {
+            auto bond = newBond(idBase++, atom, *h++, BondType::SingleBond, 0.5, 0.5);
+            bondMap[bond->getId()] = bond;
+        }
+    }
 }
 
 void JMol::loopCurrentAtomPtrVec(std::function<void(std::shared_ptr<Atom>)> _func) {
@@ -265,6 +364,15 @@ void JMol::loopCurrentAtomPtrVec(std::function<void(std::shared_ptr<Atom>)> _fun
 }
 
 bool JMol::tryExpand() {
+    // 展开时会原位改写字符串原子和它们的键，只复制这部分记录
+    if (isSharingRecords()) {
+        std::unordered_set<id_type> saIds;
+        for (auto &[aid, atom]: atomMap) {
+            if (atom && ElementType::SA == atom->getType()) { saIds.insert(aid); }
+        }
+        detachRecords(saIds, {});
+    }
+    touchTopology();
     bool ok = true;
     auto expand = [&](std::shared_ptr<Atom> atom) {
         if (!atom) { return; }
@@ -286,7 +394,14 @@ void JMol::tryMarkDoubleBond(const id_type &_bid) {
     auto from = bond->getFrom(), to = bond->getTo();
     if (getNumHydrogen(from->getId()) >= 1 && getNumHydrogen(to->getId()) >= 1 &&
         !_p->getDoubleBondNum(from->getId()) && !_p->getDoubleBondNum(to->getId())) {
+        // 加氢判据保证两端都不是字符串原子，这根键不在任何超原子键表里
+        if (isSharingRecords()) {
+            detachRecords({}, {_bid});
+            bond = getBond(_bid);
+        }
         bond->setType(BondType::DoubleBond);
+        touchTopology();
+        onBondUpdated(_bid);
         _p->addBondOrder4Atom(from->getId(), 1);
         _p->addBondOrder4Atom(to->getId(), 1);
         _p->addDoubleBondNum4Atom(from->getId(), 1);
@@ -300,45 +415,107 @@ int JMol::getNumHydrogen(const id_type &_aid) {
     }
     auto atom = getAtom(_aid);
     if (!atom) { return 0; }
-    auto result = ElementUtil::GetElementNebNum(atom->getType());
-    // 常用原子邻接键级表中没有的原子不加氢
-    if (!result) { return 0; }
-    int order = _p->getAtomOrder(atom->getId());
-    int numHs = result.value() - order;
-    // 对电荷的特别处理
-    int charge = atom->getCharge();
-    if (0 != charge) {
-        switch (atom->getType()) {
-            case ElementType::C: {
-                if (charge == 1) {// 碳正离子
-                    numHs -= 1;
-                } else if (charge == -1) {// 碳负离子
-                    numHs -= 1;
-                }
-                break;
-            }
-            case ElementType::N: {
-                if (charge == 1) {// 铵正离子
-                    numHs += 1;
-                } else {
-                    numHs -= std::floor(charge / 2.0);
-                }
-                break;
-            }
-            case ElementType::O: {
-                if (charge == -1) {
-                    numHs -= 1;
-                }
-                break;
-            }
-            default: {
-                numHs -= std::floor(charge / 2.0);
-                break;
-            }
+    int numHs = MolUtil::GetHydrogenNum(atom->getType(), atom->getCharge(), _p->getAtomOrder(atom->getId()));
+    LOG_TRACE << atom->getName() << numHs;
+    return numHs;
+}
+
+void JMol::cloneRecords(const std::unordered_map<id_type, std::shared_ptr<Atom>> &_atomMap,
+                        const std::unordered_map<id_type, std::shared_ptr<Bond>> &_bondMap) {
+    std::unordered_multimap<id_type, std::pair<float, std::shared_ptr<Atom>>> saMap;
+    atomMap.reserve(_atomMap.size());
+    bondMap.reserve(_bondMap.size());
+    for (auto &[aid, _atom]: _atomMap) {
+        if (!_atom) { continue; }
+        auto atom = newAtom(_atom->getId(), ElementType::SA);
+        *atom = *_atom;
+        atom->clearSABonds();
+        auto &sa = _atom->getSaBonds();
+        for (auto&[offset, bond]: sa) {
+            saMap.insert({bond->getId(), {offset, atom}});
         }
+        atomMap[atom->getId()] = atom;
     }
-    std::cerr << atom->getName() << numHs;
-    return numHs;
+    for (auto &[bid, _bond]: _bondMap) {
+        if (!_bond) { continue; }
+        auto bond = newBond(
+                _bond->getId(), atomMap[_bond->getFrom()->getId()], atomMap[_bond->getTo()->getId()],
+                _bond->getType(), _bond->getFromOffset(), _bond->getToOffset());
+        bondMap[bond->getId()] = bond;
+        auto it = saMap.equal_range(bond->getId());
+        for (auto itr = it.first; itr != it.second; ++itr) {
+            auto&[offset, atom]=itr->second;
+            atom->insertSuperAtomBonds(bond, offset);
+        }
+    }
+    // 记录换成了新复制的一份，图快照里的记录指针要重新取
+    touchTopology();
+}
+
+void JMol::shareRecords(const JMol &_mol) {
+    idBase = _mol.idBase;
+    atomMap = _mol.atomMap;
+    bondMap = _mol.bondMap;
+    shareToken = _mol.shareToken;
+    touchTopology();
+}
+
+void JMol::detachRecords() {
+    if (!isSharingRecords()) { return; }
+    auto sharedAtoms = std::move(atomMap);
+    auto sharedBonds = std::move(bondMap);
+    atomMap.clear();
+    bondMap.clear();
+    cloneRecords(sharedAtoms, sharedBonds);
+    shareToken = std::make_shared<char>();
+}
+
+void JMol::detachRecords(const std::unordered_set<id_type> &_atomIds, const std::unordered_set<id_type> &_bondIds) {
+    if (!isSharingRecords()) { return; }
+    std::vector<std::shared_ptr<Atom>> sharedAtoms;
+    sharedAtoms.reserve(_atomIds.size());
+    for (auto &aid: _atomIds) {
+        auto it = atomMap.find(aid);
+        if (atomMap.end() == it || !it->second) { continue; }
+        sharedAtoms.push_back(it->second);
+        auto atom = newAtom(aid, ElementType::SA);
+        *atom = *it->second;
+        atom->clearSABonds();
+        it->second = atom;
+    }
+    auto find_atom = [&](const std::shared_ptr<Atom> &_atom) -> std::shared_ptr<Atom> {
+        auto it = atomMap.find(_atom->getId());
+        return (atomMap.end() == it || !it->second) ? _atom : it->second;
+    };
+    for (auto &[bid, bond]: bondMap) {
+        if (!bond) { continue; }
+        auto from = bond->getFrom(), to = bond->getTo();
+        if (_bondIds.end() == _bondIds.find(bid) && _atomIds.end() == _atomIds.find(from->getId())
+            && _atomIds.end() == _atomIds.find(to->getId())) {
+            continue;
+        }
+        bond = newBond(bid, find_atom(from), find_atom(to),
+                       bond->getType(), bond->getFromOffset(), bond->getToOffset());
+    }
+    // 超原子键表保持原有顺序，指向新复制的键
+    for (auto &sharedAtom: sharedAtoms) {
+        auto atom = getAtom(sharedAtom->getId());
+        for (auto&[offset, sharedBond]: sharedAtom->getSaBonds()) {
+            auto bond = getBond(sharedBond->getId());
+            atom->insertSuperAtomBonds(bond ? bond : sharedBond, offset);
+        }
+    }
+    touchTopology();
+}
+
+bool JMol::isSharingRecords() const {
+    return shareToken.use_count() > 1;
+}
+
+void JMol::exposeRecords() {
+    detachRecords();
+    ++recordVersion;
+    onRecordsExposed();
 }
 
 void JMol::exceedAllData() {
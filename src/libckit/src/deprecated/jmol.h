@@ -2,15 +2,31 @@
 
 #include "ckit/atom.h"
 #include "ckit/bond.h"
+#include "ckit/mol_util.h"
+#include "ckit/mol_graph.h"
+#include "record_arena.h"
 #include <unordered_set>
 #include <vector>
 #include <memory>
 #include <functional>
 #include <string>
+#include <cstdint>
 
 namespace ckit_deprecated {
     class JMol_p;
 
+    /**
+     * 预先展开好的子图模板，键的两端是 atoms 里的下标
+     */
+    struct Fragment {
+        struct BondRecord {
+            uint8_t from, to;
+            BondType type;
+        };
+        std::vector<ElementType> atoms;
+        std::vector<BondRecord> bonds;
+    };
+
     class JMol {
     protected:
         id_type id;
@@ -19,6 +35,14 @@ namespace ckit_deprecated {
         std::unordered_map<id_type, std::shared_ptr<Atom>> atomMap;
         std::unordered_map<id_type, std::shared_ptr<Bond>> bondMap;
         bool is3DInfoLatest, is2DInfoLatest;
+        // 原子、键记录的分配区
+        std::shared_ptr<RecordArena> arena;
+        // 拓扑（原子、键、元素、键型）和坐标的修改计数，供 MolGraph 判断快照是否过期
+        size_t topologyVersion, coordVersion;
+        // 可写的原子、键记录交给调用方的次数，调用方可能原地改写了元素、电荷、键型或坐标
+        size_t recordVersion;
+        // 快照之间共享原子、键记录时持有同一个令牌，引用计数大于 1 表示记录不能原地改写
+        std::shared_ptr<char> shareToken;
 
         inline static std::unordered_set<std::string> sAvailableOutputFormat;
         inline static std::unordered_set<std::string> sAvailableInputFormat;
@@ -27,10 +51,35 @@ namespace ckit_deprecated {
 
         int getNumHydrogen(const id_type &_aid);
 
+        template<typename... Args>
+        std::shared_ptr<Atom> newAtom(Args &&... _args) {
+            return std::allocate_shared<Atom>(ArenaAllocator<Atom>(arena), std::forward<Args>(_args)...);
+        }
+
+        template<typename... Args>
+        std::shared_ptr<Bond> newBond(Args &&... _args) {
+            return std::allocate_shared<Bond>(ArenaAllocator<Bond>(arena), std::forward<Args>(_args)...);
+        }
+
+        void touchTopology();
+
+        void touchCoords();
+
+        /**
+         * 逐个复制原子、键记录，重建超原子的键关联
+         */
+        void cloneRecords(const std::unordered_map<id_type, std::shared_ptr<Atom>> &_atomMap,
+                          const std::unordered_map<id_type, std::shared_ptr<Bond>> &_bondMap);
+
+        /**
+         * 只复制记录指针，与 _mol 共享所有现存的原子、键
+         */
+        void shareRecords(const JMol &_mol);
+
     public:
         static bool IsValidWritableFormat(const std::string &_suffix);
 
-        void set2DInfoLatest(bool _is2DInfoLatest = true);
+        virtual void set2DInfoLatest(bool _is2DInfoLatest = true);
 
         void norm2D(const float &_w, const float &_h, const float &_x = 0, const float &_y = 0, bool keepRatio = true);
 
@@ -41,12 +90,21 @@ namespace ckit_deprecated {
 
         size_t getAtomNum() const;
 
+        size_t getTopologyVersion() const;
+
+        size_t getCoordVersion() const;
+
+        size_t getRecordVersion() const;
+
         float getAvgBondLength();
 
         float getAvgBondLength2D();
 
         JMol();
 
+        /**
+         * 按连通片拆成独立的分子，片段保留原子、键的 id，按片段里最小的原子 id 排序
+         */
         virtual std::vector<std::shared_ptr<JMol>> split() = 0;
 
         void loopAtomVec(std::function<void(Atom &_atom)> _func);
@@ -55,11 +113,72 @@ namespace ckit_deprecated {
 
         void loopBondVec(std::function<void(Bond &_bond)> _func);
 
+        /**
+         * 和 loopAtomVec 一样不排序，但回调直接内联，库内部的遍历用它
+         */
+        template<typename Func>
+        void forEachAtom(Func &&_func) {
+            for (auto &[aid, atom]: atomMap) {
+                if (atom) { _func(*atom); }
+            }
+        }
+
+        template<typename Func>
+        void forEachBond(Func &&_func) {
+            for (auto &[bid, bond]: bondMap) {
+                if (bond) { _func(*bond); }
+            }
+        }
+
+        /**
+         * 原子够多时先收集记录指针再用 OpenMP 并行，_func 只能改写传入的原子
+         */
+        template<typename Func>
+        void forEachAtomParallel(Func &&_func) {
+            if (atomMap.size() < MolGraph::sParallelAtomNum) {
+                forEachAtom(_func);
+                return;
+            }
+            std::vector<Atom *> atoms;
+            atoms.reserve(atomMap.size());
+            forEachAtom([&](Atom &_atom) { atoms.push_back(&_atom); });
+            const auto n = static_cast<std::ptrdiff_t>(atoms.size());
+#pragma omp parallel for
+            for (std::ptrdiff_t i = 0; i < n; i++) { _func(*atoms[i]); }
+        }
+
         virtual void display();
 
         virtual std::shared_ptr<JMol> deepClone() const = 0;
 
-        void addAllHydrogens();
+        /**
+         * 写时复制的快照：和当前分子共享原子、键记录，之后新增的原子、键只属于快照
+         * 任何一方要原地改写已有记录前都会先 detachRecords
+         */
+        virtual std::shared_ptr<JMol> snapshot() const = 0;
+
+        /**
+         * 记录被其它快照共享时复制一份独占的记录，此前拿到的 Atom、Bond 指针不再属于这个分子
+         */
+        void detachRecords();
+
+        /**
+         * 只复制 _atomIds 中的原子、与这些原子相连的键和 _bondIds 中的键，其余记录继续共享
+         * 调用方保证被复制的键不在未复制原子的超原子键表里
+         */
+        void detachRecords(const std::unordered_set<id_type> &_atomIds, const std::unordered_set<id_type> &_bondIds);
+
+        bool isSharingRecords() const;
+
+        /**
+         * 把可写的原子、键记录交给调用方时调用：先独占记录，再让图快照在下次使用前重新读取记录
+         */
+        void exposeRecords();
+
+        /**
+         * 按常用价态补全显式氢，整批追加：先连续分配所有氢原子的 id，再分配键的 id
+         */
+        virtual void addAllHydrogens();
 
         void setId(const id_type &_id);
 
@@ -79,6 +198,13 @@ namespace ckit_deprecated {
                 std::shared_ptr<Atom> _a1, std::shared_ptr<Atom> _a2,
                 const BondType &_type = BondType::SingleBond, const float &_offset1 = 0.5, const float &_offset2 = 0.5);
 
+        /**
+         * 一次插入整个子图模板，新原子按模板顺序写入 _atoms
+         * _root 不为空时原位改写为模板的第 0 个原子，而不是新建
+         */
+        virtual void addFragment(const Fragment &_fragment, std::vector<std::shared_ptr<Atom>> &_atoms,
+                                 std::shared_ptr<Atom> _root = nullptr);
+
         std::shared_ptr<Atom> getAtom(const id_type &_aid);
 
         std::shared_ptr<Bond> getBond(const id_type &_bid);
@@ -93,6 +219,18 @@ namespace ckit_deprecated {
 
         virtual void exceedAllData();
 
+        /**
+         * 原位改写了已有原子、键的元素、电荷、键型后调用，供适配器同步
+         */
+        virtual void onAtomUpdated(const id_type &_aid);
+
+        virtual void onBondUpdated(const id_type &_bid);
+
+        /**
+         * 可写的原子、键记录交给调用方后调用，调用方可能原位改了任意记录，供适配器在下次使用前整体同步
+         */
+        virtual void onRecordsExposed();
+
         virtual void rebuildAllData() = 0;
 
         virtual std::shared_ptr<Atom> removeAtom(const id_type &_aid);
@@ -103,7 +241,11 @@ namespace ckit_deprecated {
 
         virtual std::string writeAsSMI() = 0;
 
-        virtual std::string writeAs(const std::string &_formatSuffix) = 0;
+        /**
+         * 按格式对坐标的要求准备坐标后导出，只在需要重新生成三维坐标时用到 _quality
+         */
+        virtual std::string writeAs(const std::string &_formatSuffix,
+                                    const Coord3DQuality &_quality = Coord3DQuality::Refined) = 0;
 
         virtual void readAsPDB(const std::string &_buffer) = 0;
 
@@ -113,7 +255,11 @@ namespace ckit_deprecated {
 
         virtual bool generate2D() = 0;
 
-        virtual bool generate3D() = 0;
+        /**
+         * 缓存里没有同一拓扑、档次够的坐标时跑力场，_monitor 取消时返回 false，原子的三维坐标不变
+         */
+        virtual bool generate3D(const Coord3DQuality &_quality = Coord3DQuality::Refined,
+                                const Coord3DMonitor &_monitor = nullptr) = 0;
 
         virtual bool tryExpand();
 
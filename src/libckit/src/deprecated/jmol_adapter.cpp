@@ -1,6 +1,8 @@
 #include "jmol_adapter.h"
 #include "jmol_p.h"
-#include "math/alkane_graph.h"
+#include "math/union_find.h"
+#include "ckit/mol_graph.h"
+#include "base/log.h"
 
 #include <openbabel/atom.h>
 #include <openbabel/bond.h>
@@ -14,10 +16,16 @@
 
 #include <coordgenlibs/sketcherMinimizer.h>
 
+#include <algorithm>
+#include <limits>
+
 using namespace ckit_deprecated;
 
 
-JMolAdapter::JMolAdapter() : isOBMolLatest(true), obMol(std::make_shared<OpenBabel::OBMol>()) {
+JMolAdapter::JMolAdapter() : isOBMolLatest(true), isOBDataLatest(true),
+                             obMol(std::make_shared<OpenBabel::OBMol>()),
+                             geometryCache(std::make_shared<GeometryCache>()), obCoordDim(0),
+                             obCoordQuality(Coord3DQuality::Builder), layoutIdBase(0) {
 //    std::cerr << __FUNCTION__;
 }
 
@@ -26,74 +34,85 @@ JMolAdapter::~JMolAdapter() {
 }
 
 JMolAdapter::JMolAdapter(const JMolAdapter &_jMolAdapter) :
-        isOBMolLatest(false), obMol(std::make_shared<OpenBabel::OBMol>()), JMol() {
+        isOBMolLatest(false), isOBDataLatest(true), obMol(std::make_shared<OpenBabel::OBMol>()),
+        geometryCache(_jMolAdapter.geometryCache), obCoordDim(0), obCoordQuality(Coord3DQuality::Builder),
+        layoutIdBase(_jMolAdapter.layoutIdBase), JMol() {
 //    std::cerr << __FUNCTION__ << "const&";
     id = _jMolAdapter.id + 1;
     idBase = _jMolAdapter.idBase;
-    std::unordered_multimap<id_type, std::pair<float, std::shared_ptr<Atom>>> saMap;
-    const_cast<JMolAdapter &>(_jMolAdapter).loopAtomVec([&](Atom &_atom) {
-        auto atom = std::make_shared<Atom>(_atom.getId(), ElementType::SA);
-        *atom = _atom;
-        atom->clearSABonds();
-        auto &sa = _atom.getSaBonds();
-        for (auto&[offset, bond]: sa) {
-            saMap.insert({bond->getId(), {offset, atom}});
-        }
-        atomMap[atom->getId()] = atom;
-    });
-    const_cast<JMolAdapter &>(_jMolAdapter).loopBondVec([&](Bond &_bond) {
-        auto bond = std::make_shared<Bond>(
-                _bond.getId(), atomMap[_bond.getFrom()->getId()], atomMap[_bond.getTo()->getId()],
-                _bond.getType(), _bond.getFromOffset(), _bond.getToOffset());
-        bondMap[bond->getId()] = bond;
-        auto it = saMap.equal_range(bond->getId());
-        if (it.first != saMap.end()) {
-            for (auto itr = it.first; itr != it.second; ++itr) {
-                auto&[offset, atom]=itr->second;
-                atom->insertSuperAtomBonds(bond, offset);
-            }
-        }
-    });
+    cloneRecords(_jMolAdapter.atomMap, _jMolAdapter.bondMap);
+    copyOBMol(_jMolAdapter);
 }
 
 JMolAdapter::JMolAdapter(JMolAdapter &&_jMolAdapter) {
 //    std::cerr << __FUNCTION__ << "&&";
+    isOBDataLatest = _jMolAdapter.isOBDataLatest;
     obMol = _jMolAdapter.obMol;
+    geometryCache = _jMolAdapter.geometryCache;
+    obCoordDim = _jMolAdapter.obCoordDim;
+    obCoordQuality = _jMolAdapter.obCoordQuality;
+    layoutIdBase = _jMolAdapter.layoutIdBase;
 }
 
 std::shared_ptr<Atom> JMolAdapter::removeAtom(const size_t &_aid) {
     onMolUpdated();
-    isOBMolLatest = false;
-    return JMol::removeAtom(_aid);
+    auto atom = JMol::removeAtom(_aid);
+    if (atom) { logEdit(EditType::RemoveAtom, _aid); }
+    return atom;
 }
 
 std::shared_ptr<Bond> JMolAdapter::removeBond(const size_t &_bid) {
     onMolUpdated();
-    isOBMolLatest = false;
-    return JMol::removeBond(_bid);
+    auto bond = JMol::removeBond(_bid);
+    if (bond) { logEdit(EditType::RemoveBond, _bid); }
+    return bond;
 }
 
 std::shared_ptr<Bond> JMolAdapter::addBond(
         std::shared_ptr<Atom> _a1, std::shared_ptr<Atom> _a2, const BondType &_type,
         const float &_offset1, const float &_offset2) {
     onMolUpdated();
-    checkOBMol();
     auto bond = JMol::addBond(_a1, _a2, _type, _offset1, _offset2);
     if (!bond)return nullptr;
-    addOBBond(*bond);
+    logEdit(EditType::AddBond, bond->getId());
     return bond;
 }
 
 std::shared_ptr<Atom> JMolAdapter::addAtom(
         const ElementType &_element, const float &_x, const float &_y) {
     onMolUpdated();
-    checkOBMol();
     auto atom = JMol::addAtom(_element, _x, _y);
     if (!atom)return nullptr;
-    addOBAtom(*atom);
+    logEdit(EditType::AddAtom, atom->getId());
     return atom;
 }
 
+void JMolAdapter::addAllHydrogens() {
+    onMolUpdated();
+    const id_type idBegin = idBase;
+    const size_t atomNum = getAtomNum();
+    JMol::addAllHydrogens();
+    const id_type bondIdBegin = idBegin + (getAtomNum() - atomNum);
+    for (id_type id = idBegin; id < idBase; id++) {
+        logEdit(id < bondIdBegin ? EditType::AddAtom : EditType::AddBond, id);
+    }
+}
+
+void JMolAdapter::addFragment(const Fragment &_fragment, std::vector<std::shared_ptr<Atom>> &_atoms,
+                              std::shared_ptr<Atom> _root) {
+    onMolUpdated();
+    const bool hasRoot = nullptr != _root;
+    // 模板先按顺序分配新原子的 id，再分配键的 id
+    const id_type idBegin = idBase;
+    JMol::addFragment(_fragment, _atoms, std::move(_root));
+    if (_atoms.empty()) { return; }
+    if (hasRoot) { logEdit(EditType::UpdateAtom, _atoms[0]->getId()); }
+    const id_type bondIdBegin = idBegin + _atoms.size() - (hasRoot ? 1 : 0);
+    for (id_type id = idBegin; id < idBase; id++) {
+        logEdit(id < bondIdBegin ? EditType::AddAtom : EditType::AddBond, id);
+    }
+}
+
 std::shared_ptr<Atom> JMolAdapter::addAtom(
         const ElementType &_element, const float &_x, const float &_y, const float &_z) {
     auto atom = addAtom(_element, _x, _y);
@@ -106,23 +125,69 @@ std::string JMolAdapter::writeAsPDB() {
     return writeAs("pdb");
 }
 
-std::string JMolAdapter::writeAs(const std::string &_formatSuffix) {
-    checkOBMol();
-    OpenBabel::OBConversion conv;
-    auto formatOut = conv.FindFormat(_formatSuffix);
-    if (!formatOut || !conv.SetOutFormat(formatOut)) {
+/**
+ * 每个线程复用一个 OBConversion，格式插件查一次后缓存
+ */
+static OpenBabel::OBConversion &GetOutConversion(const std::string &_formatSuffix) {
+    thread_local OpenBabel::OBConversion conv = (MolUtil::InitOpenBabel(), OpenBabel::OBConversion());
+    thread_local std::unordered_map<std::string, OpenBabel::OBFormat *> formatMap;
+    auto it = formatMap.find(_formatSuffix);
+    if (formatMap.end() == it) {
+        it = formatMap.emplace(_formatSuffix, conv.FindFormat(_formatSuffix)).first;
+    }
+    if (!it->second || !conv.SetOutFormat(it->second)) {
         throw std::runtime_error("unknown format suffix: " + _formatSuffix);
     }
-    // TODO: 一些不需要运行分子力场的非3D坐标格式
-    static std::unordered_set<std::string> sNo3DWhiteList = {
-            "smi",
-            "can",
-            "inchi",
-            "smiles"
-    };
-    if (sNo3DWhiteList.end() == sNo3DWhiteList.find(_formatSuffix) && !is3DInfoLatest) {
-        if (!generate3D())
-            throw std::runtime_error("fail to generate 3d");
+    return conv;
+}
+
+static OpenBabel::OBConversion &GetInConversion(const std::string &_formatSuffix) {
+    thread_local OpenBabel::OBConversion conv = (MolUtil::InitOpenBabel(), OpenBabel::OBConversion());
+    thread_local std::unordered_map<std::string, OpenBabel::OBFormat *> formatMap;
+    auto it = formatMap.find(_formatSuffix);
+    if (formatMap.end() == it) {
+        it = formatMap.emplace(_formatSuffix, conv.FindFormat(_formatSuffix)).first;
+    }
+    if (!it->second || !conv.SetInFormat(it->second)) {
+        throw std::runtime_error("unknown readable format suffix: " + _formatSuffix);
+    }
+    return conv;
+}
+
+/**
+ * 力场插件是进程内的单例，每个线程复制一份自己的实例
+ */
+static OpenBabel::OBForceField *GetForceField() {
+    thread_local std::unique_ptr<OpenBabel::OBForceField> forceField = [] {
+        MolUtil::InitOpenBabel();
+        auto prototype = OpenBabel::OBForceField::FindForceField("uff");
+        return std::unique_ptr<OpenBabel::OBForceField>(prototype ? prototype->MakeNewInstance() : nullptr);
+    }();
+    return forceField.get();
+}
+
+std::string JMolAdapter::writeAs(const std::string &_formatSuffix, const Coord3DQuality &_quality) {
+    checkOBMol();
+    auto &conv = GetOutConversion(_formatSuffix);
+    switch (MolUtil::GetCoordRequirement(_formatSuffix)) {
+        case CoordRequirement::None:
+            break;
+        case CoordRequirement::Coord2D:
+            if (!write2DToOBMol())
+                throw std::runtime_error("fail to generate 2d");
+            break;
+        case CoordRequirement::Coord3D:
+            // 只用 OBBuilder 拼出来的坐标是预览用的，导出时按要求的档次重新生成
+            if (!is3DInfoLatest || (3 == obCoordDim && Coord3DQuality::Builder == obCoordQuality &&
+                                    Coord3DQuality::Builder != _quality)) {
+                if (!generate3D(_quality))
+                    throw std::runtime_error("fail to generate 3d");
+            } else if (3 != obCoordDim) {
+                // JMol 的三维坐标可能已被 norm3D 变换过，只恢复 OBMol 里的坐标
+                if (!load3DFromCache(Coord3DQuality::Fast) && !runForcefield(_quality))
+                    throw std::runtime_error("fail to generate 3d");
+            }
+            break;
     }
     return conv.WriteString(obMol.get(), true);
 }
@@ -141,18 +206,18 @@ void JMolAdapter::readAsSMI(const std::string &_pdbBuffer) {
 
 void JMolAdapter::readAs(const std::string &_dataBuffer, const std::string &_formatSuffix) {
     onMolUpdated();
-    OpenBabel::OBConversion conv;
-    auto formatIn = conv.FindFormat(_formatSuffix);
-    if (!formatIn || !conv.SetInFormat(formatIn)) {
-        throw std::runtime_error("unknown readable format suffix: " + _formatSuffix);
-    }
+    checkOBMol();
+    auto &conv = GetInConversion(_formatSuffix);
     std::stringstream ssm(_dataBuffer);
     if (!conv.Read(obMol.get(), &ssm)) {
         throw std::runtime_error("fail to read buffer as format suffix: " + _formatSuffix);
     }
     syncNewEntityFromOBMol();
+    obCoordDim = 0;
     if (obMol->Has3D()) {
         sync3D();
+        obCoordDim = 3;
+        obCoordQuality = Coord3DQuality::Refined;
     }
 }
 
@@ -160,35 +225,128 @@ void JMolAdapter::onMolUpdated() {
     is3DInfoLatest = is2DInfoLatest = false;
 }
 
-bool JMolAdapter::runForcefield() {
-    std::cerr << __FUNCTION__;
+/**
+ * 分段跑最速下降，每段之间把进度从 _from 推到 _to 回报一次，返回 false 表示被取消
+ */
+static bool RunSteepestDescent(OpenBabel::OBForceField *_pFF, const int &_steps, const double &_econv,
+                               const std::function<bool(const float &)> &_report,
+                               const float &_from, const float &_to) {
+    // 一段的步数，UFF 在百来个原子上一步不到一毫秒
+    const int stepsPerCheck = 10;
+    _pFF->SteepestDescentInitialize(_steps, _econv);
+    int doneSteps = 0;
+    while (_pFF->SteepestDescentTakeNSteps(stepsPerCheck)) {
+        doneSteps += stepsPerCheck;
+        if (!_report(_from + (_to - _from) * (std::min)(1.0f, float(doneSteps) / _steps))) { return false; }
+    }
+    return _report(_to);
+}
+
+bool JMolAdapter::runForcefield(const Coord3DQuality &_quality, const Coord3DMonitor &_monitor) {
     if (obMol->Empty())return true;
+    auto report = [&](const float &_progress) { return !_monitor || _monitor(_progress); };
+    if (!report(0)) { return false; }
     try {
+        // 构建器的片段表是进程内共享的静态数据，构建串行进行，力场优化各线程并行
+        static std::mutex builderMutex;
+        std::lock_guard<std::mutex> lock(builderMutex);
         OpenBabel::OBBuilder builder;
-        std::cerr << "builder.Build ret" << builder.Build(*obMol);
+        const bool built = builder.Build(*obMol);
+        LOG_DEBUG << "builder.Build ret" << built;
         // FIXME: 适配器的逻辑是手动添加氢原子，不能使用 OpenBabel 的 PH 计算机制
         // OpenBabel 的 gen3d 工具调用了这个接口，是因为 gen3d 的输入是文件
 //         std::cerr << "obMol->AddHydrogens ret" << obMol->AddHydrogens(false, true);
     } catch (...) {
         return false;
     }
-    auto pFF = OpenBabel::OBForceField::FindForceField("uff");
-    if (!pFF) {
-        return false;
+    // 构建已经改写了 OBMol 的坐标，之后取消或失败都要作废
+    obCoordDim = 0;
+    if (Coord3DQuality::Builder != _quality) {
+        const float builtProgress = 0.1;
+        if (!report(builtProgress)) { return false; }
+        auto pFF = GetForceField();
+        if (!pFF) {
+            return false;
+        }
+        pFF->SetLogLevel(OBFF_LOGLVL_NONE);
+        if (!pFF->Setup(*obMol)) {
+            LOG_WARN << "pFF->Setup ret false";
+        }
+        try {
+            if (Coord3DQuality::Fast == _quality) {
+                if (!RunSteepestDescent(pFF, 50, 1.0e-4, report, builtProgress, 1)) { return false; }
+            } else {
+                if (!RunSteepestDescent(pFF, 100, 1.0e-4, report, builtProgress, 0.3)) { return false; }
+                // 构象搜索没有分步的接口，只能在前后检查
+                pFF->WeightedRotorSearch(50, 50);
+                if (!report(0.8)) { return false; }
+                if (!RunSteepestDescent(pFF, 100, 1.0e-6, report, 0.8, 1)) { return false; }
+            }
+            const bool updated = pFF->UpdateCoordinates(*obMol);
+            LOG_DEBUG << "pFF->UpdateCoordinates ret" << updated;
+        } catch (...) {
+            return false;
+        }
     }
-    pFF->SetLogLevel(OBFF_LOGLVL_NONE);
-    if (!pFF->Setup(*obMol)) {
-        std::cerr << "pFF->Setup ret false";
+    obMol->SetDimension(3);
+    obCoordDim = 3;
+    obCoordQuality = _quality;
+    GeometryCache::Entry entry{getTopologyHash(), _quality, {}};
+    entry.coords.reserve(atomIdMap.size());
+    for (auto&[aid, obAtomId]: atomIdMap) {
+        auto obAtom = obMol->GetAtomById(obAtomId);
+        entry.coords.emplace_back(aid, point3f{obAtom->x(), obAtom->y(), obAtom->z()});
     }
-    try {
-        pFF->SteepestDescent(100, 1.0e-4);
-        pFF->WeightedRotorSearch(50, 50);
-        pFF->SteepestDescent(100, 1.0e-6);
-        std::cerr << "pFF->UpdateCoordinates ret" << pFF->UpdateCoordinates(*obMol);
-    } catch (...) {
+    std::lock_guard<std::mutex> lock(geometryCache->mutex);
+    auto &entries = geometryCache->entries;
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const GeometryCache::Entry &_e) {
+        return _e.hash == entry.hash;
+    }), entries.end());
+    if (entries.size() >= GeometryCache::sMaxEntryNum) {
+        entries.erase(entries.begin());
+    }
+    entries.push_back(std::move(entry));
+    return true;
+}
+
+uint64_t JMolAdapter::getTopologyHash() {
+    return MolGraph(*this).getTopologyHash();
+}
+
+bool JMolAdapter::load3DFromCache(const Coord3DQuality &_minQuality) {
+    if (obMol->Empty())return false;
+    const uint64_t hash = getTopologyHash();
+    std::lock_guard<std::mutex> lock(geometryCache->mutex);
+    for (auto &entry: geometryCache->entries) {
+        if (entry.hash != hash || entry.quality < _minQuality) { continue; }
+        if (entry.coords.size() != atomIdMap.size()) { return false; }
+        for (auto&[aid, pos]: entry.coords) {
+            auto it = atomIdMap.find(aid);
+            if (atomIdMap.end() == it) { return false; }
+        }
+        for (auto&[aid, pos]: entry.coords) {
+            auto&[x, y, z] = pos;
+            obMol->GetAtomById(atomIdMap[aid])->SetVector(x, y, z);
+        }
+        obMol->SetDimension(3);
+        obCoordDim = 3;
+        obCoordQuality = entry.quality;
+        return true;
+    }
+    return false;
+}
+
+bool JMolAdapter::write2DToOBMol() {
+    if (!is2DInfoLatest && !generate2D()) {
         return false;
     }
-    sync3D();
+    float k = getAvgBondLength2D();
+    k = k > 0 ? 1.5f / k : 1.f;
+    syncAtoms([&](Atom &atom, OpenBabel::OBAtom *obAtom) {
+        obAtom->SetVector(atom.x * k, -atom.y * k, 0);
+    });
+    obMol->SetDimension(2);
+    obCoordDim = 2;
     return true;
 }
 
@@ -213,48 +371,185 @@ void JMolAdapter::syncBonds(std::function<void(Bond &, OpenBabel::OBBond *)> _fu
 }
 
 void JMolAdapter::sync3D() {
-    std::cerr << __FUNCTION__;
+    LOG_TRACE;
+    detachRecords();
     syncAtoms([](Atom &atom, OpenBabel::OBAtom *obAtom) {
         atom.set3D(obAtom->x(), obAtom->y(), obAtom->z());
     });
     is3DInfoLatest = true;
+    touchCoords();
+}
+
+/**
+ * 求把 _from 对齐到 _to 的刚体变换（允许镜像），_from 先乘以 _scale，再把同一个变换作用到 _points 上
+ */
+static void AlignPoints(const std::vector<point2f> &_from, const std::vector<point2f> &_to, const float &_scale,
+                        std::vector<point2f> &_points) {
+    const float n = _from.size();
+    float fx = 0, fy = 0, tx = 0, ty = 0;
+    for (size_t i = 0; i < _from.size(); i++) {
+        fx += _from[i].first / n;
+        fy += _from[i].second / n;
+        tx += _to[i].first / n;
+        ty += _to[i].second / n;
+    }
+    // 不镜像和镜像两种情况下的 sum(p·q)、sum(p×q)，取模长大的那个，残差更小
+    float a = 0, b = 0, ma = 0, mb = 0;
+    for (size_t i = 0; i < _from.size(); i++) {
+        const float px = (_from[i].first - fx) * _scale, py = (_from[i].second - fy) * _scale;
+        const float qx = _to[i].first - tx, qy = _to[i].second - ty;
+        a += px * qx + py * qy;
+        b += px * qy - py * qx;
+        ma += px * qx - py * qy;
+        mb += px * qy + py * qx;
+    }
+    const bool mirror = ma * ma + mb * mb > a * a + b * b;
+    const float angle = mirror ? std::atan2(mb, ma) : std::atan2(b, a);
+    const float cosine = std::cos(angle), sine = std::sin(angle);
+    for (auto &[x, y]: _points) {
+        const float px = (x - fx) * _scale, py = (mirror ? fy - y : y - fy) * _scale;
+        x = px * cosine - py * sine + tx;
+        y = px * sine + py * cosine + ty;
+    }
 }
 
 bool JMolAdapter::generate2D() {
-    std::cerr << __FUNCTION__;
+    LOG_TRACE;
+    detachRecords();
     checkOBMol();
+    const MolGraph graph(*this);
+    const size_t atomNum = graph.getAtomNum();
+    std::vector<char> isPlaced(atomNum, 0);
+    size_t placedNum = 0;
+    graph.forEachAtom([&](const MolGraph::index_type &_i) {
+        if (graph.getAtomId(_i) < layoutIdBase) {
+            isPlaced[_i] = 1;
+            ++placedNum;
+        }
+    });
+    const bool isIncremental = placedNum > 0 && placedNum < atomNum;
+    if (!isIncremental && load2DFromCache(graph)) {
+        LOG_DEBUG << "reuse cached layout of" << atomNum << "atoms";
+        layoutIdBase = idBase;
+        is2DInfoLatest = true;
+        touchCoords();
+        return true;
+    }
+    // 已有坐标按平均键长缩放到 coordgen 的键长
+    float scale = 1;
+    if (isIncremental) {
+        float lengthSum = 0;
+        size_t lengthNum = 0;
+        graph.forEachBond([&](const MolGraph::index_type &_b) {
+            const auto &from = graph.getBondFrom(_b), &to = graph.getBondTo(_b);
+            if (isPlaced[from] && isPlaced[to]) {
+                lengthSum += getDistance(graph.getPos2D(from), graph.getPos2D(to));
+                ++lengthNum;
+            }
+        });
+        if (lengthNum > 0 && lengthSum > 0) { scale = BONDLENGTH * lengthNum / lengthSum; }
+    }
+    std::vector<point2f> coords(atomNum);
     try {
         sketcherMinimizer minimizer;
         auto cMol = new sketcherMinimizerMolecule();
-        std::unordered_map<Atom *, sketcherMinimizerAtom *> tmpAtomMap;
-        loopAtomVec([&](Atom &atom) {
+        std::vector<sketcherMinimizerAtom *> cAtoms(atomNum);
+        graph.forEachAtom([&](const MolGraph::index_type &_i) {
             auto cAtom = cMol->addNewAtom();
-            cAtom->setAtomicNumber(atom.getAtomicNumber());
-            tmpAtomMap[&atom] = cAtom;
+            cAtom->setAtomicNumber(graph.getAtom(_i).getAtomicNumber());
+            if (isIncremental && isPlaced[_i]) {
+                const auto[x, y] = graph.getPos2D(_i);
+                cAtom->constrained = true;
+                cAtom->templateCoordinates = sketcherMinimizerPointF(x * scale, y * scale);
+            }
+            cAtoms[_i] = cAtom;
         });
-        std::vector<sketcherMinimizerBond *> cBondVec;
-        loopBondVec([&](Bond &bond) {
-            auto cBond = cMol->addNewBond(tmpAtomMap[&*bond.getFrom()], tmpAtomMap[&*bond.getTo()]);
-            cBond->setBondOrder(bond.getBondOrder());
-            cBondVec.push_back(cBond);
+        graph.forEachBond([&](const MolGraph::index_type &_b) {
+            auto cBond = cMol->addNewBond(cAtoms[graph.getBondFrom(_b)], cAtoms[graph.getBondTo(_b)]);
+            cBond->setBondOrder(Bond::GetBondOrder(graph.getBondType(_b)));
         });
         minimizer.initialize(cMol);
         minimizer.runGenerateCoordinates();
-        for (auto&[atom, cAtom]: tmpAtomMap) {
-            auto pos = cAtom->getCoordinates();
-            atom->set2D(pos.x(), pos.y());
+        for (size_t i = 0; i < atomNum; i++) {
+            auto pos = cAtoms[i]->getCoordinates();
+            coords[i] = {pos.x(), pos.y()};
         }
     } catch (...) {
         return false;
     }
+    if (isIncremental) {
+        // 约束只是让 coordgen 尽量贴近旧坐标，最后把整体对齐回去，旧原子一个像素都不动
+        std::vector<point2f> from, to;
+        from.reserve(placedNum);
+        to.reserve(placedNum);
+        for (MolGraph::index_type i = 0; i < atomNum; i++) {
+            if (!isPlaced[i]) { continue; }
+            from.push_back(coords[i]);
+            to.push_back(graph.getPos2D(i));
+        }
+        AlignPoints(from, to, 1 / scale, coords);
+        LOG_DEBUG << "place" << atomNum - placedNum << "new atoms around" << placedNum << "fixed atoms";
+    } else {
+        store2DToCache(graph, coords);
+    }
+    for (MolGraph::index_type i = 0; i < atomNum; i++) {
+        if (isIncremental && isPlaced[i]) { continue; }
+        graph.getAtom(i).set2D(coords[i].first, coords[i].second);
+    }
+    layoutIdBase = idBase;
     is2DInfoLatest = true;
+    touchCoords();
     return true;
 }
 
-bool JMolAdapter::generate3D() {
-    std::cerr << __FUNCTION__;
+void JMolAdapter::set2DInfoLatest(bool _is2DInfoLatest) {
+    if (!_is2DInfoLatest) { layoutIdBase = 0; }
+    JMol::set2DInfoLatest(_is2DInfoLatest);
+}
+
+bool JMolAdapter::load2DFromCache(const MolGraph &_graph) {
+    const uint64_t hash = _graph.getTopologyHash();
+    std::lock_guard<std::mutex> lock(geometryCache->mutex);
+    auto &layouts = geometryCache->layouts;
+    auto it = std::find_if(layouts.begin(), layouts.end(), [&](const GeometryCache::Layout &_layout) {
+        return _layout.hash == hash;
+    });
+    if (layouts.end() == it || it->coords.size() != _graph.getAtomNum()) { return false; }
+    for (auto &[aid, pos]: it->coords) {
+        if (MolGraph::npos == _graph.getAtomIndex(aid)) { return false; }
+    }
+    for (auto &[aid, pos]: it->coords) {
+        _graph.getAtom(_graph.getAtomIndex(aid)).set2D(pos.first, pos.second);
+    }
+    std::rotate(it, it + 1, layouts.end());
+    return true;
+}
+
+void JMolAdapter::store2DToCache(const MolGraph &_graph, const std::vector<point2f> &_coords) {
+    GeometryCache::Layout layout{_graph.getTopologyHash(), {}};
+    layout.coords.reserve(_coords.size());
+    _graph.forEachAtom([&](const MolGraph::index_type &_i) {
+        layout.coords.emplace_back(_graph.getAtomId(_i), _coords[_i]);
+    });
+    std::lock_guard<std::mutex> lock(geometryCache->mutex);
+    auto &layouts = geometryCache->layouts;
+    layouts.erase(std::remove_if(layouts.begin(), layouts.end(), [&](const GeometryCache::Layout &_layout) {
+        return _layout.hash == layout.hash;
+    }), layouts.end());
+    if (layouts.size() >= GeometryCache::sMaxLayoutNum) {
+        layouts.erase(layouts.begin());
+    }
+    layouts.push_back(std::move(layout));
+}
+
+bool JMolAdapter::generate3D(const Coord3DQuality &_quality, const Coord3DMonitor &_monitor) {
+    LOG_TRACE;
     checkOBMol();
-    return runForcefield();
+    if (!load3DFromCache(_quality) && !runForcefield(_quality, _monitor)) {
+        return false;
+    }
+    sync3D();
+    return true;
 }
 
 void JMolAdapter::syncNewEntityFromOBMol() {
@@ -296,45 +591,155 @@ void JMolAdapter::syncNewEntityFromOBMol() {
 }
 
 void JMolAdapter::checkOBMol() {
+    if (isOBMolLatest && !editLog.empty()) {
+        size_t removals = 0;
+        for (auto &edit: editLog) {
+            if (EditType::RemoveAtom == edit.type || EditType::RemoveBond == edit.type) { ++removals; }
+        }
+        if (removals > sMaxIncrementalRemovals) {
+            isOBMolLatest = false;
+        }
+    }
     if (!isOBMolLatest) {
         resetOBMol();
+        return;
+    }
+    if (editLog.empty() && isOBDataLatest) { return; }
+    // 批量修改包在一次 BeginModify/EndModify 里，顺带清掉环、芳香性等感知结果
+    obMol->BeginModify();
+    for (auto &edit: editLog) {
+        applyEdit(edit);
+    }
+    if (!isOBDataLatest) {
+        for (auto &[aid, obAid]: atomIdMap) {
+            auto atom = getAtom(aid);
+            if (atom) { SetOBAtomData(*atom, *obMol->GetAtomById(obAid)); }
+        }
+        for (auto &[bid, obBid]: bondIdMap) {
+            auto bond = getBond(bid);
+            if (bond) { SetOBBondData(*bond, *obMol->GetBondById(obBid)); }
+        }
+        isOBDataLatest = true;
+    }
+    obMol->EndModify();
+    obMol->SetAromaticPerceived(false);
+    if (!editLog.empty()) {
+        editLog.clear();
+        // 新加的原子没有坐标
+        obCoordDim = 0;
+    }
+}
+
+void JMolAdapter::logEdit(const EditType &_type, const id_type &_id) {
+    // 等待整体重建时不必记录
+    if (isOBMolLatest) {
+        editLog.push_back({_type, _id});
+    }
+}
+
+void JMolAdapter::applyEdit(const Edit &_edit) {
+    switch (_edit.type) {
+        case EditType::AddAtom: {
+            auto atom = getAtom(_edit.id);
+            if (atom && atomIdMap.end() == atomIdMap.find(_edit.id)) { addOBAtom(*atom); }
+            break;
+        }
+        case EditType::AddBond: {
+            auto bond = getBond(_edit.id);
+            if (bond && bondIdMap.end() == bondIdMap.find(_edit.id)) { addOBBond(*bond); }
+            break;
+        }
+        case EditType::RemoveAtom:
+            removeOBAtom(_edit.id);
+            break;
+        case EditType::RemoveBond:
+            removeOBBond(_edit.id);
+            break;
+        case EditType::UpdateAtom: {
+            auto atom = getAtom(_edit.id);
+            auto it = atomIdMap.find(_edit.id);
+            if (atom && atomIdMap.end() != it) { SetOBAtomData(*atom, *obMol->GetAtomById(it->second)); }
+            break;
+        }
+        case EditType::UpdateBond: {
+            auto bond = getBond(_edit.id);
+            auto it = bondIdMap.find(_edit.id);
+            if (bond && bondIdMap.end() != it) { SetOBBondData(*bond, *obMol->GetBondById(it->second)); }
+            break;
+        }
+    }
+}
+
+void JMolAdapter::copyOBMol(const JMolAdapter &_jMolAdapter) {
+    if (!_jMolAdapter.isOBMolLatest) {
+        isOBMolLatest = false;
+        return;
+    }
+    *obMol = *_jMolAdapter.obMol;
+    // OBMol 复制时保留原子 id，键 id 按顺序重新编号
+    atomIdMap = _jMolAdapter.atomIdMap;
+    atomIdMap2 = _jMolAdapter.atomIdMap2;
+    bondIdMap.clear();
+    bondIdMap2.clear();
+    for (unsigned int i = 0; i < obMol->NumBonds(); i++) {
+        auto it = _jMolAdapter.bondIdMap2.find(_jMolAdapter.obMol->GetBond(i)->GetId());
+        if (_jMolAdapter.bondIdMap2.end() == it) { continue; }
+        auto obBondId = obMol->GetBond(i)->GetId();
+        bondIdMap[it->second] = obBondId;
+        bondIdMap2[obBondId] = it->second;
     }
+    editLog = _jMolAdapter.editLog;
+    isOBDataLatest = _jMolAdapter.isOBDataLatest;
+    obCoordDim = _jMolAdapter.obCoordDim;
+    obCoordQuality = _jMolAdapter.obCoordQuality;
     isOBMolLatest = true;
 }
 
-void JMolAdapter::addOBAtom(Atom &_atom) {
-    OpenBabel::OBAtom obAtom;
+void JMolAdapter::onAtomUpdated(const id_type &_aid) {
+    logEdit(EditType::UpdateAtom, _aid);
+}
+
+void JMolAdapter::onBondUpdated(const id_type &_bid) {
+    logEdit(EditType::UpdateBond, _bid);
+}
+
+void JMolAdapter::onRecordsExposed() {
+    // 改了哪些记录无从得知，等使用 OBMol 前整体刷一遍数据，拓扑不变所以不必重建
+    if (isOBMolLatest) { isOBDataLatest = false; }
+}
+
+bool JMolAdapter::tryExpand() {
+    onMolUpdated();
+    bool ok = JMol::tryExpand();
+    // 展开会改写字符串原子和键的端点，整体重建
+    isOBMolLatest = false;
+    editLog.clear();
+    return ok;
+}
+
+void JMolAdapter::SetOBAtomData(Atom &_atom, OpenBabel::OBAtom &_obAtom) {
     if (ElementType::SA == _atom.getType()) {
         // FIXME: 选择砹元素作为字符串的代理，这个元素的特点是价态足够、且一般没人写
         // FIXME: 这样在 3D 渲染的时候，如果没有展开字符串，那么字符串会被显示为一个球
-        obAtom.SetAtomicNum(85);
+        _obAtom.SetAtomicNum(85);
 //        auto label = new OpenBabel::OBPairData();
 //        label->SetAttribute("UserLabel");
 //        label->SetValue(_atom.getName());
 //        obAtom.SetData(label);
     } else if (ElementType::H == _atom.getType()) {
-        obAtom.SetAtomicNum(1);
+        _obAtom.SetAtomicNum(1);
     } else {
-//        std::cerr << "_atom.getAtomicNumber()=" << _atom.getAtomicNumber();
-        obAtom.SetAtomicNum(_atom.getAtomicNumber());
-
+        _obAtom.SetAtomicNum(_atom.getAtomicNumber());
     }
-    obAtom.SetFormalCharge(_atom.getCharge());
-    obAtom.SetId(obMol->NumAtoms());
-    obMol->AddAtom(obAtom, false);
-
-//    if (ElementType::H == _atom.getType()) {
-//        obMol->GetAtomById(obAtom.GetId())->SetAtomicNum(1);
-//    }
-    atomIdMap[_atom.getId()] = obAtom.GetId();
-    atomIdMap2[obAtom.GetId()] = _atom.getId();
-//    std::cerr << obAtom->GetAtomicMass();
+    _obAtom.SetFormalCharge(_atom.getCharge());
 }
 
-void JMolAdapter::addOBBond(Bond &_bond) {
-//    auto obBond = obMol->NewBond();
-    OpenBabel::OBBond obBond;
+void JMolAdapter::SetOBBondData(Bond &_bond, OpenBabel::OBBond &_obBond) {
     int obBondOrder;
+    _obBond.SetAromatic(false);
+    _obBond.SetWedge(false);
+    _obBond.SetHash(false);
+    _obBond.SetWedgeOrHash(false);
     switch (_bond.getType()) {
         case BondType::SingleBond:
             obBondOrder = 1;
@@ -346,24 +751,40 @@ void JMolAdapter::addOBBond(Bond &_bond) {
             obBondOrder = 3;
             break;
         case BondType::DelocalizedBond:
-            obBond.SetAromatic(true);
+            _obBond.SetAromatic(true);
             obBondOrder = 5;
             break;
         case BondType::SolidWedgeBond:
-            obBond.SetWedge(true);
+            _obBond.SetWedge(true);
             obBondOrder = 1;
             break;
         case BondType::DashWedgeBond:
-            obBond.SetHash(true);
+            _obBond.SetHash(true);
             obBondOrder = 1;
             break;
         case BondType::WaveBond:
-            obBond.SetWedgeOrHash(true);
+            _obBond.SetWedgeOrHash(true);
             obBondOrder = 1;
             break;
         default:
             throw std::runtime_error("BondType obTo OpenBabel::BondOrder not Implemented!");
     }
+    _obBond.SetBondOrder(obBondOrder);
+}
+
+void JMolAdapter::addOBAtom(Atom &_atom) {
+    OpenBabel::OBAtom obAtom;
+    SetOBAtomData(_atom, obAtom);
+    // OBMol 分配单调递增的 id，删除原子后不会复用
+    obMol->AddAtom(obAtom, true);
+    auto obAtomId = obMol->GetAtom(obMol->NumAtoms())->GetId();
+    atomIdMap[_atom.getId()] = obAtomId;
+    atomIdMap2[obAtomId] = _atom.getId();
+}
+
+void JMolAdapter::addOBBond(Bond &_bond) {
+    OpenBabel::OBBond obBond;
+    SetOBBondData(_bond, obBond);
     auto from = _bond.getFrom();
     if (from) {
         auto obFrom = atomIdMap.find(from->getId());
@@ -379,7 +800,6 @@ void JMolAdapter::addOBBond(Bond &_bond) {
     if (to) {
         auto obTo = atomIdMap.find(to->getId());
         if (atomIdMap.end() != obTo) {
-//            std::cerr << "setEnd" << obMol->GetAtomById(obTo->second)->GetId();
             obBond.SetEnd(obMol->GetAtomById(obTo->second));
         } else {
             throw std::runtime_error("atomIdMap empty for jatom to in addOBBond");
@@ -387,11 +807,37 @@ void JMolAdapter::addOBBond(Bond &_bond) {
     } else {
         throw std::runtime_error("jmol bond to empty");
     }
-    obBond.SetBondOrder(obBondOrder);
-    obBond.SetId(obMol->NumBonds());
-    obMol->AddBond(obBond);
-    bondIdMap[_bond.getId()] = obBond.GetId();
-    bondIdMap2[obBond.GetId()] = _bond.getId();
+    // 两个原子之间已经有键时 OBMol 不会再加
+    if (!obMol->AddBond(obBond)) { return; }
+    auto obBondId = obMol->GetBond(obMol->NumBonds() - 1)->GetId();
+    bondIdMap[_bond.getId()] = obBondId;
+    bondIdMap2[obBondId] = _bond.getId();
+}
+
+void JMolAdapter::removeOBBond(const id_type &_bid) {
+    auto it = bondIdMap.find(_bid);
+    if (bondIdMap.end() == it) { return; }
+    auto obBond = obMol->GetBondById(it->second);
+    bondIdMap2.erase(it->second);
+    bondIdMap.erase(it);
+    if (obBond) { obMol->DeleteBond(obBond); }
+}
+
+void JMolAdapter::removeOBAtom(const id_type &_aid) {
+    auto it = atomIdMap.find(_aid);
+    if (atomIdMap.end() == it) { return; }
+    auto obAtom = obMol->GetAtomById(it->second);
+    atomIdMap2.erase(it->second);
+    atomIdMap.erase(it);
+    if (!obAtom) { return; }
+    // OBMol 删除原子时连带删除它的键，这些键的映射一并去掉
+    FOR_BONDS_OF_ATOM(obBondIter, *obAtom) {
+        auto it2 = bondIdMap2.find(obBondIter->GetId());
+        if (bondIdMap2.end() == it2) { continue; }
+        bondIdMap.erase(it2->second);
+        bondIdMap2.erase(it2);
+    }
+    obMol->DeleteAtom(obAtom);
 }
 
 void JMolAdapter::onExtraDataNeeded() {
@@ -407,12 +853,16 @@ void JMolAdapter::resetOBMol() {
     atomIdMap2.clear();
     obMol = std::make_shared<OpenBabel::OBMol>();
     onMolUpdated();
-    loopAtomVec([&](Atom &atom) {
+    forEachAtom([&](Atom &atom) {
         addOBAtom(atom);
     });
-    loopBondVec([&](Bond &bond) {
+    forEachBond([&](Bond &bond) {
         addOBBond(bond);
     });
+    editLog.clear();
+    obCoordDim = 0;
+    isOBMolLatest = true;
+    isOBDataLatest = true;
 }
 
 std::shared_ptr<Atom>
@@ -420,10 +870,9 @@ JMolAdapter::addSuperAtom(const std::string &_name, const float &_x0, const floa
                           const float &_y1) {
 //    std::cerr << __FUNCTION__;
     onMolUpdated();
-    checkOBMol();
     auto atom = JMol::addSuperAtom(_name, _x0, _y0, _x1, _y1);
     if (!atom)return nullptr;
-    addOBAtom(*atom);
+    logEdit(EditType::AddAtom, atom->getId());
     return atom;
 }
 
@@ -446,6 +895,16 @@ std::shared_ptr<JMol> JMolAdapter::deepClone() const {
     return newMol;
 }
 
+std::shared_ptr<JMol> JMolAdapter::snapshot() const {
+    auto newMol = std::make_shared<JMolAdapter>();
+    newMol->id = id + 1;
+    newMol->shareRecords(*this);
+    newMol->geometryCache = geometryCache;
+    newMol->layoutIdBase = layoutIdBase;
+    newMol->copyOBMol(*this);
+    return newMol;
+}
+
 std::vector<std::vector<id_type>> JMolAdapter::getLSSR() {
     checkOBMol();
     const auto &obRingVec = obMol->GetLSSR();
@@ -481,6 +940,8 @@ void JMolAdapter::exceedAllData() {
     bondIdMap2.clear();
     atomIdMap2.clear();
     obMol = std::make_shared<OpenBabel::OBMol>();
+    editLog.clear();
+    isOBMolLatest = false;
     onMolUpdated();
 }
 
@@ -490,41 +951,57 @@ void JMolAdapter::rebuildAllData() {
 
 
 std::vector<std::shared_ptr<JMol>> JMolAdapter::split() {
-    AlkaneGraph<size_t> graph;
-    std::unordered_map<id_type, size_t> j2gAidMap, g2jMap;
-    std::vector<std::shared_ptr<JMol>> result;
-    size_t gAidIdx = 0;
-    loopAtomVec([&](Atom &atom) {
-        j2gAidMap[atom.getId()] = gAidIdx++;
-    });
-    loopBondVec([&](Bond &bond) {
-        auto from = bond.getFrom(), to = bond.getTo();
-        if (from && to) {
-            graph.push_back(j2gAidMap[from->getId()], j2gAidMap[to->getId()]);
-        }
+    // 原子按 id 升序编号，连通片按其中最小的原子 id 排序
+    std::vector<std::shared_ptr<Atom>> atoms;
+    atoms.reserve(atomMap.size());
+    id_type maxId = 0;
+    for (auto &[aid, atom]: atomMap) {
+        if (!atom) { continue; }
+        atoms.push_back(atom);
+        maxId = (std::max)(maxId, aid);
+    }
+    std::sort(atoms.begin(), atoms.end(), [](const std::shared_ptr<Atom> &_a, const std::shared_ptr<Atom> &_b) {
+        return _a->getId() < _b->getId();
     });
-    for (auto&[jAid, gAid]: j2gAidMap) { g2jMap[gAid] = jAid; }
-    // 保证一个连通片不和其它连通片共享边 or 节点
-    std::vector<std::unordered_set<size_t>> groups = graph.dfsTraceGroup();
-//    for (auto &group:groups) {
-//        auto mol = std::make_shared<JMolAdapter>();
-//        std::unordered_map<size_t, size_t> aidMap;//<old,new>
-//        for (auto &gid:group) {
-//            size_t oldAid = g2jMap[gid];
-//            auto atom = _mol.getAtomById(oldAid);
-//            if (!atom) continue;
-//            auto newAtom = mol->addAtom(atom->getAtomicNumber());
-//            aidMap[oldAid] = newAtom->getId();
-//        }
-//        _mol.safeTraverseBonds([&](const size_t &bid) {
-//            auto bond = _mol.getBondById(bid);
-//            if (!bond)return;
-//            if (notExist(group, bond->getAtomFrom())) return;
-//            mol->addBond(aidMap[bond->getAtomFrom()], aidMap[bond->getAtomTo()],
-//                         bond->getBondType());
-//        });
-//        result.push_back(std::move(mol));
-//    }
+    const uint32_t npos = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> indexOf(atoms.empty() ? 0 : maxId + 1, npos);
+    for (uint32_t i = 0; i < atoms.size(); i++) { indexOf[atoms[i]->getId()] = i; }
+    auto index_of = [&](const std::shared_ptr<Atom> &_atom) -> uint32_t {
+        if (!_atom || _atom->getId() >= indexOf.size()) { return npos; }
+        return indexOf[_atom->getId()];
+    };
+    // 和 MolGraph 一样跳过端点已被删除的悬空键
+    std::vector<std::pair<uint32_t, std::shared_ptr<Bond>>> bonds;
+    bonds.reserve(bondMap.size());
+    UnionFind<uint32_t> components(atoms.size());
+    for (auto &[bid, bond]: bondMap) {
+        if (!bond) { continue; }
+        const uint32_t from = index_of(bond->getFrom()), to = index_of(bond->getTo());
+        if (npos == from || npos == to) { continue; }
+        components.unite(from, to);
+        bonds.emplace_back(from, bond);
+    }
+    const auto labels = components.getLabels();
+    std::vector<std::unordered_map<id_type, std::shared_ptr<Atom>>> atomMaps(components.getComponentNum());
+    std::vector<std::unordered_map<id_type, std::shared_ptr<Bond>>> bondMaps(components.getComponentNum());
+    for (uint32_t i = 0; i < atoms.size(); i++) {
+        atomMaps[labels[i]].emplace(atoms[i]->getId(), atoms[i]);
+    }
+    for (auto &[from, bond]: bonds) {
+        bondMaps[labels[from]].emplace(bond->getId(), bond);
+    }
+    // 片段保留原来的 id，之后新增的记录从同一个 idBase 继续编号，不会和原分子冲突
+    std::vector<std::shared_ptr<JMol>> result;
+    result.reserve(atomMaps.size());
+    for (size_t c = 0; c < atomMaps.size(); c++) {
+        auto mol = std::make_shared<JMolAdapter>();
+        mol->id = id + 1;
+        mol->idBase = idBase;
+        mol->isOBMolLatest = false;
+        mol->layoutIdBase = layoutIdBase;
+        mol->cloneRecords(atomMaps[c], bondMaps[c]);
+        result.push_back(std::move(mol));
+    }
     return result;
 }
 
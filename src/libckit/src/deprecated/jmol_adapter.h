@@ -1,8 +1,15 @@
 #pragma once
 
 #include "jmol.h"
+#include "base/point2.h"
+#include "base/point3.h"
 #include <unordered_map>
 #include <functional>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+class MolGraph;
 
 namespace OpenBabel {
     class OBMol;
@@ -18,14 +25,80 @@ namespace ckit_deprecated {
      * 2、使用 coordgenlibs 实现二维标准化
      */
     class JMolAdapter : public JMol {
+        enum class EditType {
+            AddAtom, AddBond, RemoveAtom, RemoveBond, UpdateAtom, UpdateBond
+        };
+        struct Edit {
+            EditType type;
+            id_type id;
+        };
+        /**
+         * 同一拓扑算过的三维坐标，按 MolGraph 拓扑哈希索引，克隆和快照共享一份
+         * 撤销、重做和来回切换导出格式时不再重跑力场
+         */
+        struct GeometryCache {
+            struct Entry {
+                uint64_t hash;
+                Coord3DQuality quality;
+                std::vector<std::pair<id_type, point3f>> coords;
+            };
+            /**
+             * coordgen 的整体布局，最近用过的排在最后，满了淘汰最前面的
+             */
+            struct Layout {
+                uint64_t hash;
+                std::vector<std::pair<id_type, point2f>> coords;
+            };
+            inline static const size_t sMaxEntryNum = 4;
+            inline static const size_t sMaxLayoutNum = 8;
+            std::mutex mutex;
+            std::vector<Entry> entries;
+            std::vector<Layout> layouts;
+        };
+        // OBMol 删除原子、键要重排下标，单次代价和重建相当，攒太多时直接重建
+        inline static const size_t sMaxIncrementalRemovals = 8;
         std::shared_ptr<OpenBabel::OBMol> obMol;
         std::unordered_map<id_type, unsigned long> atomIdMap;
         std::unordered_map<id_type, unsigned long> bondIdMap;
         std::unordered_map<unsigned long, id_type> atomIdMap2;
         std::unordered_map<unsigned long, id_type> bondIdMap2;
+        // false 表示 OBMol 需要整体重建，否则只需按 editLog 增量同步
         bool isOBMolLatest;
-
-        bool runForcefield();
+        std::vector<Edit> editLog;
+        // false 表示记录可能被原位改写过，增量同步时要把所有原子、键的元素、电荷、键型重新写一遍
+        bool isOBDataLatest;
+        std::shared_ptr<GeometryCache> geometryCache;
+        // OBAtom 里坐标的维数，0 表示无效；导出二维格式会写入二维坐标
+        int obCoordDim;
+        // obCoordDim 为 3 时 OBMol 里三维坐标的档次
+        Coord3DQuality obCoordQuality;
+        // id 小于它的原子的二维坐标来自上一次布局，再布局时只放置其余的新原子
+        id_type layoutIdBase;
+
+        /**
+         * 只更新 OBMol 的坐标并写入几何缓存，不同步到 JMol
+         * _monitor 返回 false 时在下一个检查点放弃，OBMol 的坐标作废
+         */
+        bool runForcefield(const Coord3DQuality &_quality, const Coord3DMonitor &_monitor = nullptr);
+
+        uint64_t getTopologyHash();
+
+        /**
+         * 缓存里有同一拓扑、档次不低于 _minQuality 的坐标时写入 OBMol
+         */
+        bool load3DFromCache(const Coord3DQuality &_minQuality);
+
+        /**
+         * 缓存里有同一拓扑的整体布局时写入原子的二维坐标
+         */
+        bool load2DFromCache(const MolGraph &_graph);
+
+        void store2DToCache(const MolGraph &_graph, const std::vector<point2f> &_coords);
+
+        /**
+         * 把 JMol 的二维坐标按平均键长缩放到 1.5 埃、翻转 y 轴后写入 OBMol
+         */
+        bool write2DToOBMol();
 
         void onMolUpdated();
 
@@ -38,14 +111,34 @@ namespace ckit_deprecated {
         // 使用OpenBabel的加氢接口修改OBMol，向JMol同步数据
         void syncNewEntityFromOBMol();
 
+        /**
+         * 使用 OBMol 前调用：需要时整体重建，否则把 editLog 里攒下的修改依次同步过去
+         */
         void checkOBMol();
 
         void resetOBMol();
 
+        void applyEdit(const Edit &_edit);
+
+        void logEdit(const EditType &_type, const id_type &_id);
+
+        /**
+         * 复制一个已同步的 OBMol 和 id 映射，代替按记录重建
+         */
+        void copyOBMol(const JMolAdapter &_jMolAdapter);
+
         void addOBAtom(Atom &_atom);
 
         void addOBBond(Bond &_bond);
 
+        void removeOBAtom(const id_type &_aid);
+
+        void removeOBBond(const id_type &_bid);
+
+        static void SetOBAtomData(Atom &_atom, OpenBabel::OBAtom &_obAtom);
+
+        static void SetOBBondData(Bond &_bond, OpenBabel::OBBond &_obBond);
+
 
     public:
         JMolAdapter();
@@ -58,6 +151,8 @@ namespace ckit_deprecated {
 
         std::shared_ptr<JMol> deepClone() const override;
 
+        std::shared_ptr<JMol> snapshot() const override;
+
         void display() override;
 
         void exceedAllData() override;
@@ -66,6 +161,14 @@ namespace ckit_deprecated {
 
         void onExtraDataNeeded() override;
 
+        void onAtomUpdated(const id_type &_aid) override;
+
+        void onBondUpdated(const id_type &_bid) override;
+
+        void onRecordsExposed() override;
+
+        bool tryExpand() override;
+
         JMolAdapter &operator=(const JMolAdapter &) = delete;
 
         // FIXME: 必须先调用 removeBond 再调用 removeAtom，因为 OBAtom 持有 OBBond，删除 OBBond 的时候会调用 OBAtom
@@ -80,6 +183,11 @@ namespace ckit_deprecated {
 
         std::shared_ptr<Atom> addAtom(const ElementType &_element, const float &_x = 0, const float &_y = 0) override;
 
+        void addAllHydrogens() override;
+
+        void addFragment(const Fragment &_fragment, std::vector<std::shared_ptr<Atom>> &_atoms,
+                         std::shared_ptr<Atom> _root = nullptr) override;
+
         std::shared_ptr<Atom> addSuperAtom(
                 const std::string &_name, const float &_x0 = 0, const float &_y0 = 0,
                 const float &_x1 = 0, const float &_y1 = 0) override;
@@ -91,7 +199,8 @@ namespace ckit_deprecated {
 
         std::string writeAsSMI() override;
 
-        std::string writeAs(const std::string &_formatSuffix) override;
+        std::string writeAs(const std::string &_formatSuffix,
+                            const Coord3DQuality &_quality = Coord3DQuality::Refined) override;
 
         void readAsPDB(const std::string &_pdbBuffer) override;
 
@@ -99,9 +208,19 @@ namespace ckit_deprecated {
 
         void readAs(const std::string &_dataBuffer, const std::string &_formatSuffix) override;
 
+        /**
+         * 已有布局的原子作为 coordgen 的约束原地不动，只放置加氢、展开等新增的原子；
+         * 没有可用的旧坐标或显式要求重新布局时整体布局，整体布局的结果按拓扑缓存
+         */
         bool generate2D() override;
 
-        bool generate3D() override;
+        /**
+         * 置为 false 表示要求整体重新布局
+         */
+        void set2DInfoLatest(bool _is2DInfoLatest = true) override;
+
+        bool generate3D(const Coord3DQuality &_quality = Coord3DQuality::Refined,
+                        const Coord3DMonitor &_monitor = nullptr) override;
 
         std::vector<std::vector<id_type>> getLSSR() override;
 
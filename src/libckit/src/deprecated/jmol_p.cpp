@@ -1,5 +1,7 @@
 #include "jmol_p.h"
 #include "ckit/atom.h"
+#include "base/log.h"
+#include <array>
 
 using namespace ckit_deprecated;
 using atom_t = std::shared_ptr<Atom>;
@@ -102,7 +104,7 @@ void JMol_p::updateValenceMap() {
     atomTotalBondOrderMap.clear();
     atomDoubleBondNum.clear();
     // 初始化原子邻接键的键级累加表
-    mol.loopBondVec([&](Bond &_bond) {
+    mol.forEachBond([&](Bond &_bond) {
         int order = _bond.getBondOrder();
         auto from = _bond.getFrom();
         auto to = _bond.getTo();
@@ -122,220 +124,246 @@ bool JMol_p::IsValenceDataLatest() const {
     return isValenceDataLatest;
 }
 
-JMol_p::JMol_p(JMol &_mol) : mol(_mol), isValenceDataLatest(false), last_holder(nullptr) {
-
-}
-
-std::pair<atom_t, atom_t> JMol_p::makeAbbType(const TokenType &_abb) {
-    std::cerr << __FUNCTION__ << static_cast<int>(_abb);
-    switch (_abb) {
-        case TokenType::Me: {
-            return makeAlkane(1);
-        }
-        case TokenType::Et: {
-            auto[first, last]= makeAlkane(2);
-            return {first, last};
-        }
-        case TokenType::iPr: {
-            auto[first, last]=makeAlkane(2);
-            mol.addBond(first, mol.addAtom(ElementType::C));
-            return {first, first};
-        }
-        case TokenType::nPr: {
-            auto[first, last]= makeAlkane(3);
-            return {first, first};
-        }
-        case TokenType::iBu: {
-            auto[first, last]=makeAlkane(3);
-            mol.addBond(first, mol.addAtom(ElementType::C));
-            return {first, first};
-        }
-        case TokenType::tBu: {
-            auto[first, last]=makeAlkane(2);
-            mol.addBond(first, mol.addAtom(ElementType::C));
-            mol.addBond(first, mol.addAtom(ElementType::C));
-            return {first, first};
-        }
-        case TokenType::nBu: {
-            auto[first, last]= makeAlkane(4);
-            return {first, first};
-        }
-        case TokenType::Am: {
-            auto[first, last]= makeAlkane(5);
-            return {first, first};
-        }
-        case TokenType::NO2: {
-            auto[n, _]= makeAcyl(ElementType::O, ElementType::N);
-            auto o1 = mol.addAtom(ElementType::O);
-            mol.addBond(n, o1, BondType::SingleBond);
-            return {n, n};
-        }
-        case TokenType::NO: {
-            return makeAcyl(ElementType::O, ElementType::N);
-        }
-        case TokenType::SO3: {
-            auto[s, _]= makeAcyl(ElementType::O, ElementType::S);
-            auto o1 = mol.addAtom(ElementType::O);
-            mol.addBond(s, o1, BondType::DoubleBond);
-            auto o2 = mol.addAtom(ElementType::O);
-            mol.addBond(s, o2);
-            return {s, o2};
-        }
-        case TokenType::SO2: {
-            auto[s, _]= makeAcyl(ElementType::O, ElementType::S);
-            auto o = mol.addAtom(ElementType::O);
-            mol.addBond(s, o, BondType::DoubleBond);
-            return {s, s};
-        }
-        case TokenType::SO: {
-            return makeAcyl(ElementType::O, ElementType::S);
-        }
-        case TokenType::CO2: {
-            auto[c, _]= makeAcyl(ElementType::O, ElementType::C);
-            auto o = mol.addAtom(ElementType::O);
-            mol.addBond(c, o);
-            return {c, o};
-        }
-        case TokenType::CO: {
-            return makeAcyl(ElementType::O, ElementType::C);
-        }
-        case TokenType::Ph: {
-            auto c6 = makeBenzene();
-            auto c = std::get<0>(c6);
-            return {c, c};
-        }
-        case TokenType::Bn: {
-            auto C = mol.addAtom(ElementType::C);
-            auto c6 = makeBenzene();
-            auto c = std::get<0>(c6);
-            mol.addBond(c, C);
-            return {C, C};
-        }
-        case TokenType::Bz: {
-            auto[co, _]= makeAcyl();
-            auto c6 = makeBenzene();
-            auto c = std::get<0>(c6);
-            mol.addBond(c, co);
-            return {co, co};
-        }
-        case TokenType::CSO: {
-            auto[c, _]= makeAcyl(ElementType::S, ElementType::C);
-            auto o = mol.addAtom(ElementType::O);
-            mol.addBond(c, o);
-            return {c, o};
-        }
-        case TokenType::COS: {
-            auto[c, _]= makeAcyl(ElementType::O, ElementType::C);
-            auto s = mol.addAtom(ElementType::O);
-            mol.addBond(c, s);
-            return {c, s};
-        }
-        case TokenType::N2H4: {
-            auto[n1, n2]=makeAlkane(2, ElementType::N);
-            return {n1, n2};
-        }
-        case TokenType::N2H5: {
-            auto[n1, _]=makeAlkane(2, ElementType::N);
-            return {n1, n1};
-        }
-        case TokenType::Cbz: {// 苄氧羰基
-            auto[co, _]= makeAcyl();
-            auto c6 = makeBenzene();
-            auto c0 = std::get<0>(c6);
-            auto[c, __]=makeAlkane(1);
-            mol.addBond(c, c0);
-            auto o = mol.addAtom(ElementType::O);
-            mol.addBond(c, o);
-            mol.addBond(o, co);
-            return {co, co};
-        }
-        case TokenType::SCN: {
-            auto[s, _]=makeElementType(ElementType::S);
-//            auto[s, _]=makeAlkane(1,ElementType::S);
-            auto c = mol.addAtom(ElementType::C);
-            auto n = mol.addAtom(ElementType::N);
-            mol.addBond(s, c);
-            mol.addBond(c, n, BondType::TripleBond);
-            return {s, s};
-        }
-        case TokenType::CN: {
-            auto[c, _]=makeElementType(ElementType::C);
-//            auto[c, _]=makeAlkane(1,ElementType::C);
-            auto n = mol.addAtom(ElementType::N);
-            mol.addBond(c, n, BondType::TripleBond);
-            return {c, c};
+/**
+ * 超原子词表的字典树，词表只含 ASCII 字符，每个节点按字节直接跳转
+ */
+class SuperAtomTrie {
+    struct Node {
+        std::array<uint16_t, 128> next;
+        bool isWord = false;
+        TokenType type = TokenType::None;
+        ElementType element = ElementType::SA;
+
+        Node() { next.fill(0); }
+    };
+    // 0 号节点是根，子节点下标为 0 表示没有这条边
+    std::vector<Node> nodes;
+public:
+    explicit SuperAtomTrie(const std::unordered_map<std::string, TokenType> &_words) : nodes(1) {
+        for (const auto&[word, type]: _words) {
+            size_t cur = 0;
+            for (const auto &c: word) {
+                const auto uc = static_cast<unsigned char>(c);
+                if (uc >= 128) { throw std::runtime_error("non-ascii super atom token: " + word); }
+                if (!nodes[cur].next[uc]) {
+                    nodes[cur].next[uc] = static_cast<uint16_t>(nodes.size());
+                    nodes.emplace_back();
+                }
+                cur = nodes[cur].next[uc];
+            }
+            nodes[cur].isWord = true;
+            nodes[cur].type = type;
+            if (TokenType::Element == type) {
+                nodes[cur].element = ElementUtil::convertStringToElementType(word);
+            }
         }
-        default: {
-            break;
+    }
+
+    /**
+     * 从 _text 开头做最长匹配，返回匹配长度，0 表示没有匹配
+     */
+    size_t match(std::string_view _text, TokenType &_type, ElementType &_element) const {
+        size_t cur = 0, length = 0;
+        for (size_t i = 0; i < _text.length(); i++) {
+            const auto uc = static_cast<unsigned char>(_text[i]);
+            if (uc >= 128 || !nodes[cur].next[uc]) { break; }
+            cur = nodes[cur].next[uc];
+            if (nodes[cur].isWord) {
+                length = i + 1;
+                _type = nodes[cur].type;
+                _element = nodes[cur].element;
+            }
         }
+        return length;
     }
-    return {nullptr, nullptr};
+};
+
+static const SuperAtomTrie &GetSuperAtomTrie() {
+    static const SuperAtomTrie trie = [] {
+        initSuperAtomMap();
+        return SuperAtomTrie(SUPER_ATOM_MAP);
+    }();
+    return trie;
 }
 
-std::pair<atom_t, atom_t> JMol_p::makeElementType(const ElementType &_ele) {
-    atom_t first;
-    if (last_holder) {
-        last_holder->setCharge(0);
-        last_holder->setType(_ele);
-        first = last_holder;
-        clearLastHolder();
-    } else {
-        first = mol.addAtom(_ele);
+/**
+ * 缩写的子图模板，first、last 是两侧裸露原子在模板里的下标
+ * 模板的第 0 个原子是接入点，展开时原位改写字符串原子
+ */
+struct AbbTemplate {
+    Fragment fragment;
+    uint8_t first = 0, last = 0;
+
+    uint8_t add(const ElementType &_ele) {
+        fragment.atoms.push_back(_ele);
+        return static_cast<uint8_t>(fragment.atoms.size() - 1);
     }
-    return {first, first};
-}
 
-std::pair<atom_t, atom_t> JMol_p::makeAlkane(const int &_num, const ElementType &_ele) {
-    if (_num <= 0) { return {nullptr, nullptr}; }
-    atom_t first;
-    if (last_holder) {
-        last_holder->setCharge(0);
-        last_holder->setType(_ele);
-        first = last_holder;
-        clearLastHolder();
-    } else {
-        first = mol.addAtom(_ele);
+    uint8_t add(const ElementType &_ele, const uint8_t &_parent, const BondType &_type = BondType::SingleBond) {
+        auto atom = add(_ele);
+        bond(_parent, atom, _type);
+        return atom;
     }
-    auto last = first;
-    for (int i = 1; i < _num; i++) {
-        auto next = mol.addAtom(_ele);
-        mol.addBond(last, next);
-        last = next;
+
+    void bond(const uint8_t &_from, const uint8_t &_to, const BondType &_type = BondType::SingleBond) {
+        fragment.bonds.push_back({_from, _to, _type});
     }
-    return {first, last};
-}
 
-std::tuple<atom_t, atom_t, atom_t, atom_t, atom_t, atom_t> JMol_p::makeBenzene() {
-    atom_t atoms[6];
-    if (last_holder) {
-        last_holder->setCharge(0);
-        last_holder->setType(ElementType::C);
-        atoms[0] = last_holder;
-        clearLastHolder();
-    } else {
-        atoms[0] = mol.addAtom(ElementType::C);
+    /**
+     * 从 _parent 开始接一条 _num 个原子的链，_parent 本身算第 1 个
+     */
+    uint8_t chain(const uint8_t &_parent, const int &_num, const ElementType &_ele = ElementType::C) {
+        auto last = _parent;
+        for (int i = 1; i < _num; i++) { last = add(_ele, last); }
+        return last;
+    }
+
+    /**
+     * 凯库勒式苯环，返回第 1 个碳
+     */
+    uint8_t benzene() {
+        uint8_t atoms[6];
+        atoms[0] = add(ElementType::C);
+        for (int i = 1; i < 6; i++) {
+            atoms[i] = add(ElementType::C);
+            bond(atoms[i], atoms[i - 1], i % 2 ? BondType::SingleBond : BondType::DoubleBond);
+        }
+        bond(atoms[0], atoms[5], BondType::DoubleBond);
+        return atoms[0];
+    }
+};
+
+static std::unordered_map<TokenType, AbbTemplate> MakeAbbTemplates() {
+    std::unordered_map<TokenType, AbbTemplate> templates;
+    auto alkane = [&](const TokenType &_abb, const int &_num, const bool &_isLastExposed,
+                      const ElementType &_ele = ElementType::C) {
+        auto &t = templates[_abb];
+        auto root = t.add(_ele);
+        auto last = t.chain(root, _num, _ele);
+        t.last = _isLastExposed ? last : root;
+    };
+    // 接入点带一个双键杂原子，返回接入点
+    auto acyl = [](AbbTemplate &_t, const ElementType &_acyl = ElementType::O,
+                   const ElementType &_root = ElementType::C) {
+        auto root = _t.add(_root);
+        _t.add(_acyl, root, BondType::DoubleBond);
+        return root;
+    };
+    alkane(TokenType::Me, 1, false);
+    alkane(TokenType::Et, 2, true);
+    alkane(TokenType::nPr, 3, false);
+    alkane(TokenType::nBu, 4, false);
+    alkane(TokenType::Am, 5, false);
+    alkane(TokenType::N2H4, 2, true, ElementType::N);
+    alkane(TokenType::N2H5, 2, false, ElementType::N);
+    {
+        auto &t = templates[TokenType::iPr];
+        t.chain(t.add(ElementType::C), 2);
+        t.add(ElementType::C, 0);
+    }
+    {
+        auto &t = templates[TokenType::iBu];
+        t.chain(t.add(ElementType::C), 3);
+        t.add(ElementType::C, 0);
+    }
+    {
+        auto &t = templates[TokenType::tBu];
+        t.chain(t.add(ElementType::C), 2);
+        t.add(ElementType::C, 0);
+        t.add(ElementType::C, 0);
+    }
+    {
+        auto &t = templates[TokenType::NO2];
+        t.add(ElementType::O, acyl(t, ElementType::O, ElementType::N));
     }
-    for (int i = 1; i < 6; i++) {
-        atoms[i] = mol.addAtom(ElementType::C);
-        mol.addBond(atoms[i], atoms[i - 1], i % 2 ? BondType::SingleBond : BondType::DoubleBond);
+    acyl(templates[TokenType::NO], ElementType::O, ElementType::N);
+    {
+        auto &t = templates[TokenType::SO3];
+        auto s = acyl(t, ElementType::O, ElementType::S);
+        t.add(ElementType::O, s, BondType::DoubleBond);
+        t.last = t.add(ElementType::O, s);
     }
-    mol.addBond(atoms[0], atoms[5], BondType::DoubleBond);
-    return std::make_tuple(atoms[0], atoms[1], atoms[2], atoms[3], atoms[4], atoms[5]);
+    {
+        auto &t = templates[TokenType::SO2];
+        t.add(ElementType::O, acyl(t, ElementType::O, ElementType::S), BondType::DoubleBond);
+    }
+    acyl(templates[TokenType::SO], ElementType::O, ElementType::S);
+    {
+        auto &t = templates[TokenType::CO2];
+        t.last = t.add(ElementType::O, acyl(t));
+    }
+    acyl(templates[TokenType::CO]);
+    templates[TokenType::Ph].benzene();
+    {
+        auto &t = templates[TokenType::Bn];
+        auto c = t.add(ElementType::C);
+        t.bond(t.benzene(), c);
+    }
+    {
+        auto &t = templates[TokenType::Bz];
+        auto co = acyl(t);
+        t.bond(t.benzene(), co);
+    }
+    {
+        auto &t = templates[TokenType::CSO];
+        t.last = t.add(ElementType::O, acyl(t, ElementType::S, ElementType::C));
+    }
+    {
+        auto &t = templates[TokenType::COS];
+        t.last = t.add(ElementType::S, acyl(t));
+    }
+    {// 苄氧羰基
+        auto &t = templates[TokenType::Cbz];
+        auto co = acyl(t);
+        auto c0 = t.benzene();
+        auto c = t.add(ElementType::C);
+        t.bond(c, c0);
+        auto o = t.add(ElementType::O, c);
+        t.bond(o, co);
+    }
+    {
+        auto &t = templates[TokenType::SCN];
+        auto c = t.add(ElementType::C, t.add(ElementType::S));
+        t.add(ElementType::N, c, BondType::TripleBond);
+    }
+    {
+        auto &t = templates[TokenType::CN];
+        t.add(ElementType::N, t.add(ElementType::C), BondType::TripleBond);
+    }
+    return templates;
+}
+
+static const AbbTemplate *GetAbbTemplate(const TokenType &_abb) {
+    static const std::unordered_map<TokenType, AbbTemplate> templates = MakeAbbTemplates();
+    auto it = templates.find(_abb);
+    return templates.end() == it ? nullptr : &it->second;
 }
 
-std::pair<atom_t, atom_t> JMol_p::makeAcyl(const ElementType &_acyl, const ElementType &_root) {
-    auto acyl = mol.addAtom(_acyl);
-    atom_t root;
+JMol_p::JMol_p(JMol &_mol) : mol(_mol), isValenceDataLatest(false), last_holder(nullptr) {
+
+}
+
+std::pair<atom_t, atom_t> JMol_p::makeAbbType(const TokenType &_abb) {
+    LOG_TRACE << static_cast<int>(_abb);
+    auto t = GetAbbTemplate(_abb);
+    if (!t) { return {nullptr, nullptr}; }
+    auto root = last_holder;
+    clearLastHolder();
+    mol.addFragment(t->fragment, fragmentAtoms, std::move(root));
+    return {fragmentAtoms[t->first], fragmentAtoms[t->last]};
+}
+
+std::pair<atom_t, atom_t> JMol_p::makeElementType(const ElementType &_ele) {
+    atom_t first;
     if (last_holder) {
-        last_holder->setType(_root);
         last_holder->setCharge(0);
-        root = last_holder;
+        last_holder->setType(_ele);
+        first = last_holder;
         clearLastHolder();
     } else {
-        root = mol.addAtom(_root);
+        first = mol.addAtom(_ele);
     }
-    mol.addBond(acyl, root, BondType::DoubleBond);
-    return {root, root};
+    return {first, first};
 }
 
 void ckit_deprecated::initSuperAtomMap() {
@@ -400,36 +428,30 @@ void ckit_deprecated::initSuperAtomMap() {
 }
 //#include <iostream>
 
-std::optional<JMol_p::token_struct> JMol_p::interpret(const std::string &inputName) {
+std::optional<JMol_p::token_struct> JMol_p::interpret(std::string_view inputName) {
+    auto &trie = GetSuperAtomTrie();
     std::vector<TokenType> tokenVec;
     std::unordered_map<size_t, ElementType> elementMap;
     std::unordered_map<size_t, int> numberMap;
     size_t it = 0;
     while (it < inputName.length()) {
-        size_t offset = (std::min)(inputName.length() - it, MAX_SUPER_ATOM_LENGTH);
-//        std::cout << "offset=" << offset << std::endl;
-        std::string subStr = inputName.substr(it, offset);
-        auto its = SUPER_ATOM_MAP.find(subStr);
-        while (SUPER_ATOM_MAP.end() == its && offset >= 1) {
-            offset -= 1;
-            subStr = inputName.substr(it, offset);
-            its = SUPER_ATOM_MAP.find(subStr);
-        }
-        if (SUPER_ATOM_MAP.end() == its) { return std::nullopt; }
-        tokenVec.push_back(its->second);
-        if (isNumberToken(its->second)) {
-            size_t idx = it + offset;
-            while (idx < inputName.length() && '0' <= inputName[idx] && inputName[idx] <= '9') {
+        TokenType type;
+        ElementType element;
+        size_t offset = trie.match(inputName.substr(it), type, element);
+        if (0 == offset) { return std::nullopt; }
+        tokenVec.push_back(type);
+        if (isNumberToken(type)) {
+            // 词表只收录单个数字，后续数字就地累加
+            int number = inputName[it] - '0';
+            while (it + offset < inputName.length() && '0' <= inputName[it + offset] && inputName[it + offset] <= '9') {
+                number = number * 10 + (inputName[it + offset] - '0');
                 ++offset;
-                ++idx;
             }
-            subStr = inputName.substr(it, offset);
-            numberMap[tokenVec.size() - 1] = std::stoi(subStr);
-        } else if (isElementToken(its->second)) {
-            elementMap[tokenVec.size() - 1] = ElementUtil::convertStringToElementType(subStr);
+            numberMap[tokenVec.size() - 1] = number;
+        } else if (isElementToken(type)) {
+            elementMap[tokenVec.size() - 1] = element;
         }
         it += offset;
-//        std::cout << subStr << std::endl;
     }
     // 这里最好 move 一下，防止编译器没实现这种优化
     return std::make_tuple(std::move(tokenVec), std::move(numberMap), std::move(elementMap));
@@ -437,7 +459,7 @@ std::optional<JMol_p::token_struct> JMol_p::interpret(const std::string &inputNa
 
 std::pair<atom_t, atom_t> JMol_p::extractNoBracketTokens(
         token_struct &tokenStruct, size_t iBeg, size_t iEnd, int suffix, atom_t parent) {
-    std::cerr << __FUNCTION__ << "suffix=" << suffix;
+    LOG_TRACE << "suffix=" << suffix;
     auto&[tokens, numbers, elements]=tokenStruct;
     atom_t a_beg0 = nullptr, a_end0 = nullptr;
     // 如果有要被挂载的原子，那么不可能原位修改接入原子
@@ -459,7 +481,7 @@ std::pair<atom_t, atom_t> JMol_p::extractNoBracketTokens(
                     auto &nextToken = tokens[i + 1];
                     if (isNumberToken(nextToken)) {
                         number = numbers[i + 1];
-                        std::cerr << "number=" << number;
+                        LOG_TRACE << "number=" << number;
                         std::tie(a1, a2) = makeElementType(
                                 elements[i], last_ele, number);
                         i += 1;
@@ -468,20 +490,20 @@ std::pair<atom_t, atom_t> JMol_p::extractNoBracketTokens(
                         std::tie(a1, a2) = makeElementType(elements[i]);
                         if (a1 && a1->getCommonNebNum() > 1) {
                             // 如果遇到可续接的原子，更新主原子信息
-                            std::cerr << "bind" << a1->getName();
+                            LOG_TRACE << "bind" << a1->getName();
                             last_ele = a1;
                         }
                     }
                 } else {
                     std::tie(a1, a2) = makeElementType(elements[i]);
                     if (a1 && a1->getCommonNebNum() > 1) {
-                        std::cerr << "bind" << a1->getName();
+                        LOG_TRACE << "bind" << a1->getName();
                         last_ele = a1;
                     }
                 }
             } else if (isAbbToken(curToken)) {
                 // 拼接缩略词
-                std::cerr << __FUNCTION__ << "isAbbToken:" << (int) curToken;
+                LOG_TRACE << "isAbbToken:" << (int) curToken;
                 std::tie(a1, a2) = makeAbbType(curToken);
             } else if (isChargeToken(curToken)) {
                 // 向主原子划归电荷，FIXME: 这里是一个粗糙的实现
@@ -538,16 +560,15 @@ std::pair<atom_t, atom_t> JMol_p::extractNoBracketTokens(
  * 2、没有分隔符，请使用最长单词试探法
  */
 bool ckit_deprecated::JMol_p::tryExpand(const id_type &_aid) {
-    initSuperAtomMap();
     auto atom = mol.getAtom(_aid);
     if (!atom) { return false; }
     if (ElementType::SA != atom->getType()) { return false; }
     std::string inputName = atom->getName();
-    std::cerr << __FUNCTION__ << inputName.c_str();
+    LOG_DEBUG << inputName;
     auto opt = interpret(inputName);
     if (!opt) { return false; }
     auto &tokenStruct = opt.value();
-    std::cerr << "atom->isLeftToRight=" << atom->isLeftToRight();
+    LOG_TRACE << "atom->isLeftToRight=" << atom->isLeftToRight();
     if (!atom->isLeftToRight()) {
         // reverse tokenStruct here
         if (!reverseTokens(tokenStruct)) { return false; }
@@ -563,7 +584,6 @@ bool ckit_deprecated::JMol_p::tryExpand(const id_type &_aid) {
 //    std::cerr << "token" << (int) token;
 //        }
 //    }
-    std::cerr << "**********";
     bindLastHolder(atom);// 原位修改起始原子
     atom_t a_end = atom, a1, a2;
     int number;
@@ -624,7 +644,7 @@ bool ckit_deprecated::JMol_p::tryExpand(const id_type &_aid) {
     // TODO: 解决多点接入问题
     if (atom && a_end) {
         auto &bonds = atom->getSaBonds();
-        std::cerr << "bonds.size()=" << bonds.size();
+        LOG_TRACE << "bonds.size()=" << bonds.size();
         if (bonds.size() > 1) {
             std::sort(bonds.begin(), bonds.end(), [](
                     const std::pair<float, std::shared_ptr<Bond>> &a,
@@ -640,7 +660,7 @@ bool ckit_deprecated::JMol_p::tryExpand(const id_type &_aid) {
 //            mol.rebuildAllData();
         }
     }
-    std::cerr << __FUNCTION__ << "return true";
+    LOG_TRACE << "return true";
     return true;
 }
 
@@ -704,10 +724,10 @@ bool JMol_p::reverseTokens(JMol_p::token_struct &tokenStruct) {
         elements2.size() == elements.size() &&
         tokens2.size() == tokens.size()) {
         std::swap(newStruct, tokenStruct);
-        std::cerr << __FUNCTION__ << "ret true";
+        LOG_TRACE << "ret true";
         return true;
     }
-    std::cerr << __FUNCTION__ << "ret false" << numbers2.size() << numbers.size()
+    LOG_DEBUG << "ret false" << numbers2.size() << numbers.size()
               << elements2.size() << elements.size()
               << tokens2.size() << tokens.size();
     return false;
@@ -5,6 +5,8 @@
 #include <memory>
 #include <optional>
 #include <queue>
+#include <string_view>
+#include <vector>
 
 namespace ckit_deprecated {
 
@@ -71,6 +73,8 @@ namespace ckit_deprecated {
          * 在任何地方使用过 last_holder 后，应该调用 clearLastHolder 清除之
          */
         atom_t last_holder;
+        // 插入缩写模板时复用的原子缓冲
+        std::vector<atom_t> fragmentAtoms;
     public:
         /**
          * 绑定要求原位修改的起始原子
@@ -107,6 +111,7 @@ namespace ckit_deprecated {
         /**
          * 构造缩写表达的超原子，将两侧裸露的原子返回
          * 如果只有一个原子，那么这个原子同时作为两侧
+         * 每种缩写的子图只展开一次，之后整段插入
          * @param _abb 缩写枚举
          * @return 两侧的原子
          */
@@ -116,14 +121,10 @@ namespace ckit_deprecated {
 
         std::pair<atom_t, atom_t> makeElementType(const ElementType &_ele, atom_t parent, int num);
 
-        std::pair<atom_t, atom_t> makeAlkane(const int &_num, const ElementType &_ele = ElementType::C);
-
-        std::pair<atom_t, atom_t> makeAcyl(
-                const ElementType &_acyl = ElementType::O, const ElementType &_root = ElementType::C);
-
-        std::tuple<atom_t, atom_t, atom_t, atom_t, atom_t, atom_t> makeBenzene();
-
-        std::optional<token_struct> interpret(const std::string &inputName);
+        /**
+         * 在超原子词表的字典树上做最长匹配分词，不产生子串
+         */
+        std::optional<token_struct> interpret(std::string_view inputName);
 
         /**
          * 如果挂载前缀，那么返回前缀，不需要调用点关注；
@@ -0,0 +1,304 @@
+#include "ckit/fingerprint.h"
+#include "ckit/bond.h"
+#include "ckit/mol_util.h"
+#include "ckit/ring_finder.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+
+#include <intrin.h>
+
+#endif
+
+/**
+ * x86-64 的 Linux 上按处理器挑选实现：支持 AVX512 VPOPCNTDQ 的处理器上整段向量化，否则至少用上 popcnt 指令
+ */
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__linux__)
+#define ELS_POPCNT_CLONES __attribute__((target_clones("arch=icelake-server", "popcnt", "default")))
+#else
+#define ELS_POPCNT_CLONES
+#endif
+
+using index_type = MolGraph::index_type;
+
+static inline uint64_t PopCount64(const uint64_t &_x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    return __popcnt64(_x);
+#else
+    return __builtin_popcountll(_x);
+#endif
+}
+
+static uint64_t Mix(uint64_t _h, const uint64_t &_v) {
+    _h ^= _v + 0x9e3779b97f4a7c15ull + (_h << 6) + (_h >> 2);
+    // splitmix64 的收尾，让低位也充分混合，指纹直接取低位
+    _h ^= _h >> 31;
+    _h *= 0x7fb5d329728ea185ull;
+    _h ^= _h >> 27;
+    _h *= 0x81dadef4bc2d35b3ull;
+    _h ^= _h >> 33;
+    return _h;
+}
+
+namespace {
+    /**
+     * 只含重原子的 CSR 图，键编码 1、2、3 为键级，4 为芳香键
+     */
+    struct HeavyGraph {
+        inline static const uint8_t sAromaticCode = 4;
+        std::vector<uint32_t> adjStart, adjAtoms;
+        std::vector<uint8_t> adjCodes;
+        std::vector<uint64_t> invariants;
+        size_t bondNum = 0;
+
+        explicit HeavyGraph(const MolGraph &_graph);
+
+        size_t size() const { return invariants.size(); }
+    };
+
+    /**
+     * 枚举从每个原子出发、不超过 sMaxLength 根键的简单路径，正反两个方向的哈希取较小者
+     */
+    class PathWalker {
+        inline static const size_t sMaxLength = 7;
+        const HeavyGraph &g;
+        Fingerprint &fp;
+        std::vector<char> visited;
+        uint32_t atoms[sMaxLength + 1];
+        uint8_t codes[sMaxLength];
+
+        void record(const size_t &_length) {
+            uint64_t forward = Mix(0, _length), backward = forward;
+            for (size_t k = 0; k <= _length; k++) {
+                forward = Mix(forward, g.invariants[atoms[k]]);
+                backward = Mix(backward, g.invariants[atoms[_length - k]]);
+                if (k < _length) {
+                    forward = Mix(forward, codes[k]);
+                    backward = Mix(backward, codes[_length - k - 1]);
+                }
+            }
+            fp.set((std::min)(forward, backward) & (Fingerprint::sBitNum - 1));
+        }
+
+        void walk(const size_t &_length) {
+            record(_length);
+            if (_length == sMaxLength) { return; }
+            const uint32_t i = atoms[_length];
+            for (uint32_t k = g.adjStart[i]; k < g.adjStart[i + 1]; k++) {
+                const uint32_t j = g.adjAtoms[k];
+                if (visited[j]) { continue; }
+                visited[j] = 1;
+                atoms[_length + 1] = j;
+                codes[_length] = g.adjCodes[k];
+                walk(_length + 1);
+                visited[j] = 0;
+            }
+        }
+
+    public:
+        PathWalker(const HeavyGraph &_graph, Fingerprint &_fp) : g(_graph), fp(_fp), visited(_graph.size(), 0) {}
+
+        void run() {
+            for (uint32_t i = 0; i < g.size(); i++) {
+                visited[i] = 1;
+                atoms[0] = i;
+                walk(0);
+                visited[i] = 0;
+            }
+        }
+    };
+}
+
+HeavyGraph::HeavyGraph(const MolGraph &_graph) {
+    const size_t atomNum = _graph.getAtomNum();
+    std::vector<uint32_t> heavyOf(atomNum, MolGraph::npos);
+    uint32_t heavyNum = 0;
+    _graph.forEachAtom([&](const index_type &_i) {
+        if (ElementType::H != _graph.getElement(_i)) { heavyOf[_i] = heavyNum++; }
+    });
+    std::vector<uint8_t> codes(_graph.getBondNum());
+    _graph.forEachBond([&](const index_type &_b) {
+        const auto &type = _graph.getBondType(_b);
+        codes[_b] = BondType::DelocalizedBond == type ? sAromaticCode : Bond::GetBondOrder(type);
+    });
+    // 环上的原子、键
+    RingFinder finder;
+    auto &rings = finder.findSSSR(_graph);
+    std::vector<char> isRingAtom(atomNum, 0), isRingBond(codes.size(), 0);
+    for (size_t r = 0; r < rings.size(); r++) {
+        auto ring = rings[r];
+        for (size_t k = 0; k < ring.size(); k++) {
+            isRingAtom[ring[k]] = 1;
+            isRingBond[_graph.findBond(ring[k], ring[(k + 1) % ring.size()])] = 1;
+        }
+    }
+    // 芳香性：环上全是离域键；六元环每个原子都有环上的双键；五元环除一个 N、O、S 外都有环上的双键
+    auto hasRingPiBond = [&](const index_type &_i) {
+        bool result = false;
+        _graph.forEachNeighbor(_i, [&](const index_type &, const index_type &_b) {
+            result |= isRingBond[_b] && (2 == codes[_b] || sAromaticCode == codes[_b]);
+        });
+        return result;
+    };
+    std::vector<char> isAromatic(atomNum, 0);
+    for (size_t r = 0; r < rings.size(); r++) {
+        auto ring = rings[r];
+        size_t piNum = 0, delocalizedNum = 0;
+        index_type lonePairAtom = MolGraph::npos;
+        for (size_t k = 0; k < ring.size(); k++) {
+            if (hasRingPiBond(ring[k])) {
+                ++piNum;
+            } else {
+                lonePairAtom = ring[k];
+            }
+            const auto b = _graph.findBond(ring[k], ring[(k + 1) % ring.size()]);
+            delocalizedNum += BondType::DelocalizedBond == _graph.getBondType(b);
+        }
+        bool aromatic = delocalizedNum == ring.size();
+        if (!aromatic && 6 == ring.size()) {
+            aromatic = 6 == piNum;
+        } else if (!aromatic && 5 == ring.size() && 4 == piNum) {
+            const auto &element = _graph.getElement(lonePairAtom);
+            aromatic = ElementType::N == element || ElementType::O == element || ElementType::S == element;
+        }
+        if (!aromatic) { continue; }
+        for (size_t k = 0; k < ring.size(); k++) {
+            isAromatic[ring[k]] = 1;
+            codes[_graph.findBond(ring[k], ring[(k + 1) % ring.size()])] = sAromaticCode;
+        }
+    }
+    // 芳香原子的氢数依赖凯库勒式的写法，不进入原子不变量
+    std::vector<int> numHs;
+    MolUtil::GetHydrogenNums(_graph, numHs);
+    adjStart.assign(heavyNum + 1, 0);
+    invariants.resize(heavyNum);
+    _graph.forEachAtom([&](const index_type &_i) {
+        const uint32_t u = heavyOf[_i];
+        if (MolGraph::npos == u) { return; }
+        uint32_t degree = 0;
+        _graph.forEachNeighbor(_i, [&](const index_type &_j, const index_type &_b) {
+            if (MolGraph::npos == heavyOf[_j]) {
+                ++numHs[_i];
+            } else {
+                ++degree;
+                adjAtoms.push_back(heavyOf[_j]);
+                adjCodes.push_back(codes[_b]);
+            }
+        });
+        adjStart[u + 1] = adjAtoms.size();
+        uint64_t h = Mix(0, static_cast<uint64_t>(_graph.getElement(_i)));
+        h = Mix(h, static_cast<uint64_t>(_graph.getCharge(_i)));
+        h = Mix(h, degree);
+        h = Mix(h, isAromatic[_i] ? 0xff : numHs[_i]);
+        invariants[u] = Mix(h, isRingAtom[_i]);
+    });
+    bondNum = adjAtoms.size() / 2;
+}
+
+/**
+ * 一轮 Morgan 迭代：原子的新标识由旧标识和按序排列的 (键编码, 邻居旧标识) 决定
+ */
+static void Refine(const HeavyGraph &_g, const std::vector<uint64_t> &_ids, std::vector<uint64_t> &_next,
+                   const uint64_t &_round) {
+    std::vector<std::pair<uint8_t, uint64_t>> env;
+    _next.resize(_ids.size());
+    for (uint32_t i = 0; i < _g.size(); i++) {
+        env.clear();
+        for (uint32_t k = _g.adjStart[i]; k < _g.adjStart[i + 1]; k++) {
+            env.emplace_back(_g.adjCodes[k], _ids[_g.adjAtoms[k]]);
+        }
+        std::sort(env.begin(), env.end());
+        uint64_t h = Mix(_ids[i], _round);
+        for (auto&[code, id]: env) {
+            h = Mix(Mix(h, code), id);
+        }
+        _next[i] = h;
+    }
+}
+
+static size_t CountDistinct(std::vector<uint64_t> _ids) {
+    std::sort(_ids.begin(), _ids.end());
+    return std::unique(_ids.begin(), _ids.end()) - _ids.begin();
+}
+
+Fingerprint Fingerprint::FromGraph(const MolGraph &_graph, const FingerprintType &_type) {
+    Fingerprint fp;
+    const HeavyGraph g(_graph);
+    std::vector<uint64_t> ids = g.invariants, next;
+    if (FingerprintType::Path == _type) {
+        PathWalker(g, fp).run();
+    } else {
+        for (auto &id: ids) { fp.set(id & (sBitNum - 1)); }
+        for (uint64_t round = 1; round <= 2; round++) {
+            Refine(g, ids, next, round);
+            for (auto &id: next) { fp.set(id & (sBitNum - 1)); }
+            ids.swap(next);
+        }
+        ids = g.invariants;
+    }
+    // 细化到等价类不再分裂，排序后的标识与原子顺序无关
+    size_t classNum = CountDistinct(ids);
+    for (uint64_t round = 1; round <= g.size(); round++) {
+        Refine(g, ids, next, round);
+        const size_t nextClassNum = CountDistinct(next);
+        if (nextClassNum <= classNum) { break; }
+        ids.swap(next);
+        classNum = nextClassNum;
+    }
+    std::sort(ids.begin(), ids.end());
+    uint64_t h = Mix(g.size(), g.bondNum);
+    for (auto &id: ids) { h = Mix(h, id); }
+    fp.graphHash = h;
+    return fp;
+}
+
+const uint64_t *Fingerprint::data() const {
+    return words.data();
+}
+
+const uint64_t &Fingerprint::getGraphHash() const {
+    return graphHash;
+}
+
+bool Fingerprint::test(const size_t &_bit) const {
+    return (words[_bit / 64] >> (_bit % 64)) & 1;
+}
+
+void Fingerprint::set(const size_t &_bit) {
+    words[_bit / 64] |= 1ull << (_bit % 64);
+}
+
+size_t Fingerprint::count() const {
+    return PopCount(words.data());
+}
+
+bool Fingerprint::operator==(const Fingerprint &_other) const {
+    return words == _other.words;
+}
+
+ELS_POPCNT_CLONES
+size_t Fingerprint::PopCount(const uint64_t *_words) {
+    uint64_t sum = 0;
+    for (size_t k = 0; k < sWordNum; k++) { sum += PopCount64(_words[k]); }
+    return sum;
+}
+
+ELS_POPCNT_CLONES
+size_t Fingerprint::PopCountAnd(const uint64_t *_a, const uint64_t *_b) {
+    // 四路累加，打断相邻 popcnt 之间的依赖
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (size_t k = 0; k < sWordNum; k += 4) {
+        s0 += PopCount64(_a[k] & _b[k]);
+        s1 += PopCount64(_a[k + 1] & _b[k + 1]);
+        s2 += PopCount64(_a[k + 2] & _b[k + 2]);
+        s3 += PopCount64(_a[k + 3] & _b[k + 3]);
+    }
+    return s0 + s1 + s2 + s3;
+}
+
+float Fingerprint::Tanimoto(const Fingerprint &_a, const Fingerprint &_b) {
+    const size_t both = PopCountAnd(_a.data(), _b.data());
+    const size_t either = _a.count() + _b.count() - both;
+    return either ? static_cast<float>(both) / either : 1.0f;
+}
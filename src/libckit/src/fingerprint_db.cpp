@@ -0,0 +1,270 @@
+#include "ckit/fingerprint_db.h"
+#include "ckit/mol.h"
+#include "base/log.h"
+#include <openbabel/oberror.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+    /**
+     * 文件按本机字节序存放，只在同一种架构上读写
+     */
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t type;
+        uint32_t wordNum;
+        uint32_t reserved;
+        uint64_t count;
+        uint64_t textSize;
+    };
+
+    /**
+     * 各段在文件里的偏移，按 64 字节对齐，方便向量化读取
+     */
+    struct FileLayout {
+        size_t words, popCounts, graphHashes, hashOrder, textOffsets, text, total;
+
+        FileLayout(const size_t &_count, const size_t &_textSize) {
+            auto align = [](const size_t &_offset) { return (_offset + 63) / 64 * 64; };
+            words = align(sizeof(FileHeader));
+            popCounts = align(words + _count * Fingerprint::sWordNum * sizeof(uint64_t));
+            graphHashes = align(popCounts + _count * sizeof(uint32_t));
+            hashOrder = align(graphHashes + _count * sizeof(uint64_t));
+            textOffsets = align(hashOrder + _count * sizeof(uint32_t));
+            text = align(textOffsets + (_count + 1) * sizeof(uint64_t));
+            total = text + _textSize;
+        }
+    };
+
+    const char sMagic[8] = "ELSFPDB";
+    const uint32_t sVersion = 1;
+    // 每块的分子数，块内串行扫描并维护自己的前 k 个
+    const size_t sBlockSize = 16384;
+}
+
+/**
+ * 排在前面的更好：相似度高，相同时下标小
+ */
+static bool IsBetter(const FingerprintDB::Hit &_a, const FingerprintDB::Hit &_b) {
+    return _a.similarity > _b.similarity || (_a.similarity == _b.similarity && _a.index < _b.index);
+}
+
+static void WritePadding(std::ostream &_out, const size_t &_offset) {
+    static const char zeros[64] = {};
+    const auto pos = static_cast<size_t>(_out.tellp());
+    _out.write(zeros, _offset - pos);
+}
+
+size_t FingerprintDB::Build(std::istream &_in, const std::string &_path, const FingerprintType &_type) {
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(_in, line)) {
+        while (!line.empty() && ('\r' == line.back() || ' ' == line.back() || '\t' == line.back())) {
+            line.pop_back();
+        }
+        if (!line.empty()) { lines.push_back(std::move(line)); }
+    }
+    MolUtil::InitOpenBabel();
+    // obErrorLog 是进程内共享的，多线程写它不安全，失败原因在下面逐行记录
+    OpenBabel::obErrorLog.StopLogging();
+    const long long lineNum = lines.size();
+    std::vector<Fingerprint> fps(lineNum);
+    std::vector<std::string> errors(lineNum);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (long long i = 0; i < lineNum; i++) {
+        try {
+            GuiMol mol;
+            mol.readAs(lines[i].substr(0, lines[i].find_first_of(" \t")), "smi");
+            auto graph = mol.getGraph();
+            if (0 == graph->getAtomNum()) {
+                errors[i] = "empty molecule";
+            } else {
+                fps[i] = Fingerprint::FromGraph(*graph, _type);
+            }
+        } catch (std::exception &e) {
+            errors[i] = e.what();
+        }
+    }
+    std::vector<uint32_t> kept;
+    kept.reserve(lineNum);
+    uint64_t textSize = 0;
+    for (long long i = 0; i < lineNum; i++) {
+        if (!errors[i].empty()) {
+            LOG_WARN << "skip line" << i + 1 << lines[i] << ":" << errors[i];
+            continue;
+        }
+        kept.push_back(i);
+        textSize += lines[i].size();
+    }
+    const size_t count = kept.size();
+    if (count > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("too many molecules for one fingerprint database");
+    }
+    std::ofstream out(_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("failed to create " + _path);
+    }
+    const FileLayout layout(count, textSize);
+    FileHeader header{};
+    std::memcpy(header.magic, sMagic, sizeof(sMagic));
+    header.version = sVersion;
+    header.type = static_cast<uint32_t>(_type);
+    header.wordNum = Fingerprint::sWordNum;
+    header.count = count;
+    header.textSize = textSize;
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    WritePadding(out, layout.words);
+    for (auto &i: kept) {
+        out.write(reinterpret_cast<const char *>(fps[i].data()), Fingerprint::sWordNum * sizeof(uint64_t));
+    }
+    WritePadding(out, layout.popCounts);
+    for (auto &i: kept) {
+        const uint32_t popCount = fps[i].count();
+        out.write(reinterpret_cast<const char *>(&popCount), sizeof(popCount));
+    }
+    WritePadding(out, layout.graphHashes);
+    for (auto &i: kept) {
+        out.write(reinterpret_cast<const char *>(&fps[i].getGraphHash()), sizeof(uint64_t));
+    }
+    WritePadding(out, layout.hashOrder);
+    std::vector<uint32_t> order(count);
+    for (uint32_t k = 0; k < count; k++) { order[k] = k; }
+    std::sort(order.begin(), order.end(), [&](const uint32_t &_a, const uint32_t &_b) {
+        const auto &ha = fps[kept[_a]].getGraphHash(), &hb = fps[kept[_b]].getGraphHash();
+        return ha < hb || (ha == hb && _a < _b);
+    });
+    out.write(reinterpret_cast<const char *>(order.data()), count * sizeof(uint32_t));
+    WritePadding(out, layout.textOffsets);
+    uint64_t offset = 0;
+    out.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    for (auto &i: kept) {
+        offset += lines[i].size();
+        out.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    }
+    WritePadding(out, layout.text);
+    for (auto &i: kept) {
+        out.write(lines[i].data(), lines[i].size());
+    }
+    if (!out) {
+        throw std::runtime_error("failed to write " + _path);
+    }
+    return count;
+}
+
+void FingerprintDB::open(const std::string &_path) {
+    count = 0;
+    file.open(_path);
+    FileHeader header{};
+    if (file.size() < sizeof(header)) {
+        file.close();
+        throw std::runtime_error(_path + " is not a fingerprint database");
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (0 != std::memcmp(header.magic, sMagic, sizeof(sMagic)) || sVersion != header.version ||
+        Fingerprint::sWordNum != header.wordNum ||
+        header.type > static_cast<uint32_t>(FingerprintType::Circular)) {
+        file.close();
+        throw std::runtime_error(_path + " is not a compatible fingerprint database");
+    }
+    const FileLayout layout(header.count, header.textSize);
+    if (file.size() < layout.total) {
+        file.close();
+        throw std::runtime_error(_path + " is truncated");
+    }
+    const char *base = file.data();
+    type = static_cast<FingerprintType>(header.type);
+    count = header.count;
+    words = reinterpret_cast<const uint64_t *>(base + layout.words);
+    popCounts = reinterpret_cast<const uint32_t *>(base + layout.popCounts);
+    graphHashes = reinterpret_cast<const uint64_t *>(base + layout.graphHashes);
+    hashOrder = reinterpret_cast<const uint32_t *>(base + layout.hashOrder);
+    textOffsets = reinterpret_cast<const uint64_t *>(base + layout.textOffsets);
+    text = base + layout.text;
+}
+
+size_t FingerprintDB::size() const {
+    return count;
+}
+
+const FingerprintType &FingerprintDB::getType() const {
+    return type;
+}
+
+std::string_view FingerprintDB::getRecord(const size_t &_index) const {
+    return {text + textOffsets[_index], textOffsets[_index + 1] - textOffsets[_index]};
+}
+
+std::string_view FingerprintDB::getSmiles(const size_t &_index) const {
+    const auto record = getRecord(_index);
+    return record.substr(0, record.find_first_of(" \t"));
+}
+
+std::vector<FingerprintDB::Hit> FingerprintDB::search(const Fingerprint &_query, const size_t &_k) const {
+    if (0 == _k || 0 == count) { return {}; }
+    const size_t queryCount = _query.count();
+    const long long blockNum = (count + sBlockSize - 1) / sBlockSize;
+    std::vector<std::vector<Hit>> partial(blockNum);
+#pragma omp parallel for schedule(dynamic) if(blockNum > 1)
+    for (long long b = 0; b < blockNum; b++) {
+        auto &heap = partial[b];
+        heap.reserve(_k);
+        const size_t begin = b * sBlockSize, end = (std::min)(count, begin + sBlockSize);
+        for (size_t i = begin; i < end; i++) {
+            const size_t popCount = popCounts[i];
+            // 相似度不超过 min/max，块内下标递增，持平也不可能挤进前 k 个
+            if (heap.size() == _k) {
+                const size_t lo = (std::min)(popCount, queryCount), hi = (std::max)(popCount, queryCount);
+                if (hi > 0 && static_cast<float>(lo) / hi <= heap.front().similarity) { continue; }
+            }
+            const size_t both = Fingerprint::PopCountAnd(_query.data(), words + i * Fingerprint::sWordNum);
+            const size_t either = popCount + queryCount - both;
+            const Hit hit{i, either ? static_cast<float>(both) / either : 1.0f};
+            if (heap.size() < _k) {
+                heap.push_back(hit);
+                std::push_heap(heap.begin(), heap.end(), IsBetter);
+            } else if (hit.similarity > heap.front().similarity) {
+                std::pop_heap(heap.begin(), heap.end(), IsBetter);
+                heap.back() = hit;
+                std::push_heap(heap.begin(), heap.end(), IsBetter);
+            }
+        }
+    }
+    std::vector<Hit> hits;
+    for (auto &heap: partial) {
+        hits.insert(hits.end(), heap.begin(), heap.end());
+    }
+    std::sort(hits.begin(), hits.end(), IsBetter);
+    if (hits.size() > _k) { hits.resize(_k); }
+    return hits;
+}
+
+std::vector<size_t> FingerprintDB::findExact(const Fingerprint &_query) const {
+    const auto &hash = _query.getGraphHash();
+    auto first = std::lower_bound(hashOrder, hashOrder + count, hash, [&](const uint32_t &_i, const uint64_t &_h) {
+        return graphHashes[_i] < _h;
+    });
+    std::vector<size_t> result;
+    for (auto it = first; it != hashOrder + count && graphHashes[*it] == hash; ++it) {
+        if (0 == std::memcmp(words + *it * Fingerprint::sWordNum, _query.data(),
+                             Fingerprint::sWordNum * sizeof(uint64_t))) {
+            result.push_back(*it);
+        }
+    }
+    return result;
+}
+
+std::vector<FingerprintDB::Hit> FingerprintDB::search(const MolGraph &_graph, const size_t &_k) const {
+    const auto query = Fingerprint::FromGraph(_graph, type);
+    const auto exact = findExact(query);
+    if (exact.size() >= _k) {
+        std::vector<Hit> hits;
+        for (size_t k = 0; k < _k; k++) { hits.push_back({exact[k], 1.0f}); }
+        return hits;
+    }
+    return search(query, _k);
+}
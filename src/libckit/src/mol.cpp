@@ -1,14 +1,21 @@
 #include "ckit/mol.h"
+#include "ckit/smiles_writer.h"
+#include "ckit/ring_finder.h"
 #include "deprecated/jmol_adapter.h"
 #include <memory>
 
-GuiMol::GuiMol() : m(std::make_shared<ckit_deprecated::JMolAdapter>()) {
+GuiMol::GuiMol() : m(std::make_shared<ckit_deprecated::JMolAdapter>()),
+                   graphTopologyVersion(0), graphCoordVersion(0), graphRecordVersion(0) {
 }
 
-GuiMol::GuiMol(GuiMol &&mol) noexcept: m(std::move(mol.m)) {
+GuiMol::GuiMol(GuiMol &&mol) noexcept: m(std::move(mol.m)), graph(std::move(mol.graph)),
+                                        graphTopologyVersion(mol.graphTopologyVersion),
+                                        graphCoordVersion(mol.graphCoordVersion),
+                                        graphRecordVersion(mol.graphRecordVersion) {
 }
 
-GuiMol::GuiMol(const GuiMol &mol) : m(mol.m->deepClone()) {
+GuiMol::GuiMol(const GuiMol &mol) : m(mol.m->deepClone()),
+                                     graphTopologyVersion(0), graphCoordVersion(0), graphRecordVersion(0) {
 }
 
 
@@ -18,6 +25,24 @@ gui_mol GuiMol::deepClone() const {
     return m2;
 }
 
+gui_mol GuiMol::snapshot() const {
+    auto m2 = std::make_shared<GuiMol>();
+    m2->m = this->m->snapshot();
+    return m2;
+}
+
+std::vector<gui_mol> GuiMol::split() const {
+    auto fragments = m->split();
+    std::vector<gui_mol> result;
+    result.reserve(fragments.size());
+    for (auto &fragment: fragments) {
+        auto m2 = std::make_shared<GuiMol>();
+        m2->m = std::move(fragment);
+        result.push_back(std::move(m2));
+    }
+    return result;
+}
+
 void GuiMol::addAllHydrogens() {
     m->addAllHydrogens();
 }
@@ -43,23 +68,95 @@ void GuiMol::norm3D(
     m->norm3D(xx, yy, zz, x, y, z, keepRatio);
 }
 
+bool GuiMol::generate2D() {
+    return m->generate2D();
+}
+
+bool GuiMol::generate3D(const Coord3DQuality &quality, const Coord3DMonitor &monitor) {
+    return m->generate3D(quality, monitor);
+}
+
 float GuiMol::getAvgBondLength() {
     return m->getAvgBondLength();
 }
 
 void GuiMol::loopAtomVec(std::function<void(Atom &)> func) {
+    m->exposeRecords();
     m->loopAtomVec(std::move(func));
 }
 
+void GuiMol::loopAtomVec(std::function<void(const Atom &)> func) const {
+    m->forEachAtom(func);
+}
+
 void GuiMol::loopBondVec(std::function<void(Bond &)> func) {
+    m->exposeRecords();
     m->loopBondVec(std::move(func));
 }
 
+void GuiMol::loopBondVec(std::function<void(const Bond &)> func) const {
+    m->forEachBond(func);
+}
+
+MolGraph::RecordRange<Atom> GuiMol::atoms() {
+    m->detachRecords();
+    // 区间只用到记录指针，拓扑没变时不必先刷新快照；改写发生在这之后，下一次 getGraph 再重新读取记录
+    auto range = (graph && graphTopologyVersion == m->getTopologyVersion()) ? graph->atoms() : getGraph()->atoms();
+    m->exposeRecords();
+    return range;
+}
+
+MolGraph::RecordRange<const Atom> GuiMol::atoms() const {
+    return getGraph()->atoms();
+}
+
+MolGraph::RecordRange<Bond> GuiMol::bonds() {
+    m->detachRecords();
+    // 区间只用到记录指针，拓扑没变时不必先刷新快照；改写发生在这之后，下一次 getGraph 再重新读取记录
+    auto range = (graph && graphTopologyVersion == m->getTopologyVersion()) ? graph->bonds() : getGraph()->bonds();
+    m->exposeRecords();
+    return range;
+}
+
+MolGraph::RecordRange<const Bond> GuiMol::bonds() const {
+    return getGraph()->bonds();
+}
+
+std::shared_ptr<const MolGraph> GuiMol::getGraph() const {
+    if (!graph || graphTopologyVersion != m->getTopologyVersion()) {
+        graph = std::make_shared<MolGraph>(*m);
+    } else if (graphRecordVersion != m->getRecordVersion() || graphCoordVersion != m->getCoordVersion()) {
+        // 已经交出去的快照不原地改写
+        if (graph.use_count() > 1) {
+            graph = std::make_shared<MolGraph>(*graph);
+        }
+        if (graphRecordVersion == m->getRecordVersion()) {
+            graph->updateCoords();
+        } else if (!graph->updateRecords()) {
+            graph = std::make_shared<MolGraph>(*m);
+        }
+    }
+    graphTopologyVersion = m->getTopologyVersion();
+    graphCoordVersion = m->getCoordVersion();
+    graphRecordVersion = m->getRecordVersion();
+    return graph;
+}
+
 std::shared_ptr<Atom> GuiMol::getAtom(const id_type &aid) {
+    m->exposeRecords();
+    return m->getAtom(aid);
+}
+
+std::shared_ptr<const Atom> GuiMol::getAtom(const id_type &aid) const {
     return m->getAtom(aid);
 }
 
 std::shared_ptr<Bond> GuiMol::getBond(const id_type &bid) {
+    m->exposeRecords();
+    return m->getBond(bid);
+}
+
+std::shared_ptr<const Bond> GuiMol::getBond(const id_type &bid) const {
     return m->getBond(bid);
 }
 
@@ -75,8 +172,24 @@ std::shared_ptr<Bond> GuiMol::addBond(
     return m->addBond(a1, a2, type, offset1, offset2);
 }
 
-std::string GuiMol::writeAs(const std::string &suffix) {
-    return m->writeAs(suffix);
+std::shared_ptr<Atom> GuiMol::removeAtom(const id_type &aid) {
+    return m->removeAtom(aid);
+}
+
+std::shared_ptr<Bond> GuiMol::removeBond(const id_type &bid) {
+    return m->removeBond(bid);
+}
+
+std::string GuiMol::writeAs(const std::string &suffix, const Coord3DQuality &quality) {
+    // SMILES 在图快照上直接生成，不构建 OBMol
+    if ("can" == suffix || "smi" == suffix || "smiles" == suffix) {
+        return SmilesWriter::Write(*getGraph());
+    }
+    return m->writeAs(suffix, quality);
+}
+
+void GuiMol::readAs(const std::string &buffer, const std::string &suffix) {
+    m->readAs(buffer, suffix);
 }
 
 std::shared_ptr<Atom> GuiMol::addSuperAtom(
@@ -87,6 +200,19 @@ std::shared_ptr<Atom> GuiMol::addSuperAtom(
 }
 
 std::vector<std::vector<id_type>> GuiMol::getSSSR() {
+    auto g = getGraph();
+    RingFinder finder;
+    auto &rings = finder.findSSSR(*g);
+    std::vector<std::vector<id_type>> result(rings.size());
+    for (size_t i = 0; i < rings.size(); i++) {
+        for (auto &idx: rings[i]) {
+            result[i].push_back(g->getAtomId(idx));
+        }
+    }
+    return result;
+}
+
+std::vector<std::vector<id_type>> GuiMol::getOpenBabelSSSR() {
     return m->getSSSR();
 }
 
@@ -0,0 +1,172 @@
+#include "ckit/mol_converter.h"
+#include "ckit/mol.h"
+#include "base/log.h"
+#include <openbabel/oberror.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    /**
+     * 一块输入和它的转换结果，message 非空表示这个分子转换失败
+     */
+    struct Chunk {
+        size_t firstIndex = 0;
+        std::vector<std::string> inputs, outputs, messages;
+    };
+
+    /**
+     * 常驻的工作线程，每次提交一块，线程从原子计数器上领取分子
+     */
+    class WorkerPool {
+        const MolConverter::Options &options;
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable workCond, doneCond;
+        Chunk *chunk = nullptr;
+        std::atomic<size_t> next{0};
+        size_t generation = 0, runningNum = 0;
+        bool isStopped = false;
+
+        void work() {
+            size_t seen = 0;
+            while (true) {
+                Chunk *cur;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    workCond.wait(lock, [&] { return isStopped || generation != seen; });
+                    if (isStopped) { return; }
+                    seen = generation;
+                    cur = chunk;
+                }
+                for (size_t i = next++; i < cur->inputs.size(); i = next++) {
+                    try {
+                        cur->outputs[i] = MolConverter::ConvertOne(cur->inputs[i], options);
+                    } catch (std::exception &e) {
+                        cur->messages[i] = e.what();
+                    } catch (...) {
+                        cur->messages[i] = "unknown error";
+                    }
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                if (0 == --runningNum) { doneCond.notify_one(); }
+            }
+        }
+
+    public:
+        WorkerPool(const MolConverter::Options &_options, const size_t &_threadNum) : options(_options) {
+            for (size_t i = 0; i < _threadNum; i++) {
+                threads.emplace_back([this] { work(); });
+            }
+        }
+
+        ~WorkerPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                isStopped = true;
+            }
+            workCond.notify_all();
+            for (auto &thread: threads) { thread.join(); }
+        }
+
+        void submit(Chunk &_chunk) {
+            _chunk.outputs.assign(_chunk.inputs.size(), std::string());
+            _chunk.messages.assign(_chunk.inputs.size(), std::string());
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                chunk = &_chunk;
+                next = 0;
+                runningNum = threads.size();
+                ++generation;
+            }
+            workCond.notify_all();
+        }
+
+        void wait() {
+            std::unique_lock<std::mutex> lock(mutex);
+            doneCond.wait(lock, [&] { return 0 == runningNum; });
+        }
+    };
+}
+
+/**
+ * 读入至多 _num 个非空行，返回是否读到了分子
+ */
+static bool ReadChunk(std::istream &_in, Chunk &_chunk, const size_t &_firstIndex, const size_t &_num) {
+    _chunk.firstIndex = _firstIndex;
+    _chunk.inputs.clear();
+    std::string line;
+    while (_chunk.inputs.size() < _num && std::getline(_in, line)) {
+        while (!line.empty() && ('\r' == line.back() || ' ' == line.back() || '\t' == line.back())) {
+            line.pop_back();
+        }
+        if (line.empty()) { continue; }
+        _chunk.inputs.push_back(std::move(line));
+    }
+    return !_chunk.inputs.empty();
+}
+
+double MolConverter::Report::getMolsPerSecond() const {
+    return seconds > 0 ? total / seconds : 0;
+}
+
+MolConverter::MolConverter(const Options &_options) : options(_options) {
+    if (0 == options.threadNum) {
+        options.threadNum = (std::max)(1u, std::thread::hardware_concurrency());
+    }
+    options.chunkSize = (std::max)(options.chunkSize, options.threadNum);
+}
+
+std::string MolConverter::ConvertOne(const std::string &_input, const Options &_options) {
+    GuiMol mol;
+    mol.readAs(_input, _options.inputFormat);
+    if (0 == mol.getGraph()->getAtomNum()) {
+        throw std::runtime_error("empty molecule");
+    }
+    if (_options.addHydrogens) { mol.addAllHydrogens(); }
+    auto output = mol.writeAs(_options.outputFormat, _options.quality);
+    if (output.empty()) {
+        throw std::runtime_error("empty output");
+    }
+    if ('\n' != output.back()) { output.push_back('\n'); }
+    return output;
+}
+
+MolConverter::Report MolConverter::convert(std::istream &_in, std::ostream &_out) {
+    MolUtil::InitOpenBabel();
+    // obErrorLog 是进程内共享的，多线程写它不安全，失败原因改由 Report 给出
+    if (options.threadNum > 1) {
+        OpenBabel::obErrorLog.StopLogging();
+    }
+    Report report;
+    const auto start = std::chrono::steady_clock::now();
+    WorkerPool pool(options, options.threadNum);
+    // 两块轮换：工作线程转换一块时，主线程读下一块
+    Chunk chunks[2];
+    size_t cur = 0;
+    bool hasCur = ReadChunk(_in, chunks[cur], 0, options.chunkSize);
+    while (hasCur) {
+        auto &chunk = chunks[cur];
+        pool.submit(chunk);
+        const bool hasNext = ReadChunk(_in, chunks[1 - cur], chunk.firstIndex + chunk.inputs.size(),
+                                       options.chunkSize);
+        pool.wait();
+        for (size_t i = 0; i < chunk.inputs.size(); i++) {
+            if (chunk.messages[i].empty()) {
+                _out << chunk.outputs[i];
+            } else {
+                LOG_DEBUG << "molecule" << chunk.firstIndex + i << "failed:" << chunk.messages[i];
+                report.failures.push_back({chunk.firstIndex + i, chunk.inputs[i], chunk.messages[i]});
+            }
+        }
+        report.total += chunk.inputs.size();
+        cur = 1 - cur;
+        hasCur = hasNext;
+    }
+    _out.flush();
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
@@ -0,0 +1,227 @@
+#include "ckit/mol_graph.h"
+#include "ckit/atom.h"
+#include "ckit/bond.h"
+#include "deprecated/jmol.h"
+
+#include <algorithm>
+
+
+MolGraph::MolGraph(ckit_deprecated::JMol &_mol) {
+    const size_t atomNum = _mol.getAtomNum(), bondNum = _mol.getBondNum();
+    atomIds.reserve(atomNum);
+    elements.reserve(atomNum);
+    charges.reserve(atomNum);
+    atomRecords.reserve(atomNum);
+    // 原子按 id 升序编号，与插入顺序一致，不依赖哈希表的遍历顺序
+    _mol.forEachAtom([&](Atom &_atom) { atomRecords.push_back(&_atom); });
+    std::sort(atomRecords.begin(), atomRecords.end(), [](Atom *_a, Atom *_b) {
+        return _a->getId() < _b->getId();
+    });
+    id_type maxId = 0;
+    for (auto &atom: atomRecords) {
+        atomIds.push_back(atom->getId());
+        elements.push_back(atom->getType());
+        charges.push_back(atom->getCharge());
+        maxId = (std::max)(maxId, atom->getId());
+    }
+    atomIndexOf.assign(atomRecords.empty() ? 0 : maxId + 1, npos);
+    for (index_type i = 0; i < atomIds.size(); i++) {
+        atomIndexOf[atomIds[i]] = i;
+    }
+    bondRecords.reserve(bondNum);
+    _mol.forEachBond([&](Bond &_bond) {
+        if (_bond.getFrom() && _bond.getTo()) { bondRecords.push_back(&_bond); }
+    });
+    std::sort(bondRecords.begin(), bondRecords.end(), [](Bond *_a, Bond *_b) {
+        return _a->getId() < _b->getId();
+    });
+    maxId = 0;
+    bondIds.reserve(bondRecords.size());
+    bondFroms.reserve(bondRecords.size());
+    bondTos.reserve(bondRecords.size());
+    bondTypes.reserve(bondRecords.size());
+    adjStart.assign(atomIds.size() + 1, 0);
+    // 端点已被删除的悬空键不进快照
+    size_t validBondNum = 0;
+    for (auto &bond: bondRecords) {
+        index_type from = getAtomIndex(bond->getFrom()->getId()), to = getAtomIndex(bond->getTo()->getId());
+        if (npos == from || npos == to) { continue; }
+        bondRecords[validBondNum++] = bond;
+        bondIds.push_back(bond->getId());
+        bondFroms.push_back(from);
+        bondTos.push_back(to);
+        bondTypes.push_back(bond->getType());
+        maxId = (std::max)(maxId, bond->getId());
+        ++adjStart[from + 1];
+        ++adjStart[to + 1];
+    }
+    bondRecords.resize(validBondNum);
+    bondIndexOf.assign(bondRecords.empty() ? 0 : maxId + 1, npos);
+    for (index_type i = 0; i < bondIds.size(); i++) {
+        bondIndexOf[bondIds[i]] = i;
+    }
+    for (size_t i = 1; i < adjStart.size(); i++) {
+        adjStart[i] += adjStart[i - 1];
+    }
+    adjAtoms.resize(adjStart.back());
+    adjBonds.resize(adjStart.back());
+    std::vector<index_type> cursor(adjStart.begin(), adjStart.end() - 1);
+    for (index_type i = 0; i < bondIds.size(); i++) {
+        auto &k1 = cursor[bondFroms[i]], &k2 = cursor[bondTos[i]];
+        adjAtoms[k1] = bondTos[i];
+        adjBonds[k1++] = i;
+        adjAtoms[k2] = bondFroms[i];
+        adjBonds[k2++] = i;
+    }
+    computeTopologyHash();
+    updateCoords();
+}
+
+void MolGraph::computeTopologyHash() {
+    // FNV-1a
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&h](const uint64_t &_v) {
+        for (int i = 0; i < 64; i += 8) {
+            h ^= (_v >> i) & 0xff;
+            h *= 1099511628211ull;
+        }
+    };
+    mix(atomIds.size());
+    for (size_t i = 0; i < atomIds.size(); i++) {
+        mix(atomIds[i]);
+        mix(static_cast<uint64_t>(elements[i]));
+        mix(static_cast<uint64_t>(charges[i]));
+    }
+    mix(bondIds.size());
+    for (size_t i = 0; i < bondIds.size(); i++) {
+        mix(bondIds[i]);
+        mix(atomIds[bondFroms[i]]);
+        mix(atomIds[bondTos[i]]);
+        mix(static_cast<uint64_t>(bondTypes[i]));
+    }
+    topologyHash = h;
+}
+
+void MolGraph::updateCoords() {
+    const size_t n = atomRecords.size();
+    xs.resize(n);
+    ys.resize(n);
+    xxs.resize(n);
+    yys.resize(n);
+    zzs.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        auto &atom = *atomRecords[i];
+        xs[i] = atom.x;
+        ys[i] = atom.y;
+        xxs[i] = atom.xx;
+        yys[i] = atom.yy;
+        zzs[i] = atom.zz;
+    }
+}
+
+bool MolGraph::updateRecords() {
+    // 多数情况下只改了坐标，拓扑哈希只在元素、电荷、键型变了时重算
+    bool isChanged = false;
+    for (index_type i = 0; i < atomRecords.size(); i++) {
+        auto &atom = *atomRecords[i];
+        if (atom.getId() != atomIds[i]) { return false; }
+        if (elements[i] != atom.getType() || charges[i] != atom.getCharge()) {
+            elements[i] = atom.getType();
+            charges[i] = atom.getCharge();
+            isChanged = true;
+        }
+    }
+    for (index_type i = 0; i < bondRecords.size(); i++) {
+        auto &bond = *bondRecords[i];
+        auto from = bond.getFrom(), to = bond.getTo();
+        if (bond.getId() != bondIds[i] || !from || !to ||
+            from->getId() != atomIds[bondFroms[i]] || to->getId() != atomIds[bondTos[i]]) {
+            return false;
+        }
+        if (bondTypes[i] != bond.getType()) {
+            bondTypes[i] = bond.getType();
+            isChanged = true;
+        }
+    }
+    if (isChanged) { computeTopologyHash(); }
+    updateCoords();
+    return true;
+}
+
+size_t MolGraph::getAtomNum() const {
+    return atomIds.size();
+}
+
+uint64_t MolGraph::getTopologyHash() const {
+    return topologyHash;
+}
+
+size_t MolGraph::getBondNum() const {
+    return bondIds.size();
+}
+
+MolGraph::index_type MolGraph::getAtomIndex(const id_type &_aid) const {
+    return _aid < atomIndexOf.size() ? atomIndexOf[_aid] : npos;
+}
+
+MolGraph::index_type MolGraph::getBondIndex(const id_type &_bid) const {
+    return _bid < bondIndexOf.size() ? bondIndexOf[_bid] : npos;
+}
+
+const id_type &MolGraph::getAtomId(const index_type &_i) const {
+    return atomIds[_i];
+}
+
+const ElementType &MolGraph::getElement(const index_type &_i) const {
+    return elements[_i];
+}
+
+const int &MolGraph::getCharge(const index_type &_i) const {
+    return charges[_i];
+}
+
+point2f MolGraph::getPos2D(const index_type &_i) const {
+    return {xs[_i], ys[_i]};
+}
+
+point3f MolGraph::getPos3D(const index_type &_i) const {
+    return {xxs[_i], yys[_i], zzs[_i]};
+}
+
+Atom &MolGraph::getAtom(const index_type &_i) const {
+    return *atomRecords[_i];
+}
+
+const id_type &MolGraph::getBondId(const index_type &_i) const {
+    return bondIds[_i];
+}
+
+const MolGraph::index_type &MolGraph::getBondFrom(const index_type &_i) const {
+    return bondFroms[_i];
+}
+
+const MolGraph::index_type &MolGraph::getBondTo(const index_type &_i) const {
+    return bondTos[_i];
+}
+
+const BondType &MolGraph::getBondType(const index_type &_i) const {
+    return bondTypes[_i];
+}
+
+Bond &MolGraph::getBond(const index_type &_i) const {
+    return *bondRecords[_i];
+}
+
+MolGraph::index_type MolGraph::getDegree(const index_type &_i) const {
+    return adjStart[_i + 1] - adjStart[_i];
+}
+
+MolGraph::index_type MolGraph::findBond(const index_type &_a1, const index_type &_a2) const {
+    // 从度数小的一端找
+    index_type a = _a1, b = _a2;
+    if (getDegree(a) > getDegree(b)) { std::swap(a, b); }
+    for (index_type k = adjStart[a]; k < adjStart[a + 1]; k++) {
+        if (adjAtoms[k] == b) { return adjBonds[k]; }
+    }
+    return npos;
+}
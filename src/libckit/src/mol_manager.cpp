@@ -1,5 +1,6 @@
 #include "ckit/mol_manager.h"
 #include "ckit/mol.h"
+#include "ckit/mol_view_cache.h"
 
 MolManager::MolManager(gui_mol mol)
         : inputMol(mol), currentMol(mol), expandedMol(nullptr),
@@ -26,8 +27,7 @@ gui_mol MolManager::getCurrentMol() {
 
 gui_mol MolManager::getFullHydrogenInputMol() {
     if (!fullHydrogenInputMol) {
-        fullHydrogenInputMol = getInputMol()->deepClone();
-        fullHydrogenInputMol->addAllHydrogens();
+        fullHydrogenInputMol = MolViewCache::GetInstance().get(getInputMol(), MolViewType::FullHydrogen);
     }
     currentMol = fullHydrogenInputMol;
     return fullHydrogenInputMol;
@@ -35,8 +35,7 @@ gui_mol MolManager::getFullHydrogenInputMol() {
 
 gui_mol MolManager::getExpandedMol() {
     if (!expandedMol) {
-        expandedMol = inputMol->deepClone();
-        expandedMol->tryExpand();
+        expandedMol = MolViewCache::GetInstance().get(inputMol, MolViewType::Expanded);
     }
     currentMol = expandedMol;
     return expandedMol;
@@ -44,8 +43,7 @@ gui_mol MolManager::getExpandedMol() {
 
 gui_mol MolManager::getFullHydrogenExpandedMol(bool setCurrent) {
     if (!fullHydrogenExpandedMol) {
-        fullHydrogenExpandedMol = getExpandedMol()->deepClone();
-        fullHydrogenExpandedMol->addAllHydrogens();
+        fullHydrogenExpandedMol = MolViewCache::GetInstance().get(inputMol, MolViewType::FullHydrogenExpanded);
     }
     if (setCurrent) {
         currentMol = fullHydrogenExpandedMol;
@@ -1,6 +1,13 @@
 #include "ckit/mol_util.h"
+#include "ckit/mol_graph.h"
+#include "ckit/bond.h"
 #include <openbabel/plugin.h>
+#include <openbabel/builder.h>
 #include <unordered_set>
+#include <unordered_map>
+#include <cmath>
+#include <algorithm>
+#include <mutex>
 
 // 禁用了一些显示不了 c1ccccc1 的格式
 static std::unordered_set<std::string> FORMAT_WRITE_WHITE_LIST = {
@@ -42,13 +49,102 @@ static std::unordered_set<std::string> FORMAT_WRITE_WHITE_LIST = {
         "zin"
 };
 
+// 线性记法和指纹不带坐标，MDL 等连接表格式用二维坐标即可
+static std::unordered_map<std::string, CoordRequirement> FORMAT_COORD_TABLE = {
+        {"can",       CoordRequirement::None},
+        {"smi",       CoordRequirement::None},
+        {"smiles",    CoordRequirement::None},
+        {"inchi",     CoordRequirement::None},
+        {"inchikey",  CoordRequirement::None},
+        {"mcdl",      CoordRequirement::None},
+        {"mna",       CoordRequirement::None},
+        {"fps",       CoordRequirement::None},
+        {"fpt",       CoordRequirement::None},
+        {"molreport", CoordRequirement::None},
+        {"mol",       CoordRequirement::Coord2D},
+        {"mdl",       CoordRequirement::Coord2D},
+        {"sd",        CoordRequirement::Coord2D},
+        {"sdf",       CoordRequirement::Coord2D},
+        {"ct",        CoordRequirement::Coord2D},
+        {"cht",       CoordRequirement::Coord2D},
+        {"crk2d",     CoordRequirement::Coord2D},
+        {"cdjson",    CoordRequirement::Coord2D},
+        {"svg",       CoordRequirement::Coord2D},
+};
+
+CoordRequirement MolUtil::GetCoordRequirement(const std::string &suffix) {
+    auto it = FORMAT_COORD_TABLE.find(suffix);
+    return FORMAT_COORD_TABLE.end() == it ? CoordRequirement::Coord3D : it->second;
+}
 
 bool MolUtil::IsValidWritableFormat(const std::string &suffix) {
     return FORMAT_WRITE_WHITE_LIST.end() != FORMAT_WRITE_WHITE_LIST.find(suffix);
 }
 
 std::vector<std::string> MolUtil::GetWritableFormats() {
+    InitOpenBabel();
     std::vector<std::string> result;
     OpenBabel::OBPlugin::ListAsVector("formats", nullptr, result);
     return result;
 }
+
+void MolUtil::InitOpenBabel() {
+    static std::once_flag flag;
+    std::call_once(flag, [] {
+        OpenBabel::OBPlugin::LoadAllPlugins();
+        // 片段库在第一次 Build 时才读，提前读好，避免多个线程同时填充
+        OpenBabel::OBBuilder builder;
+        builder.LoadFragments();
+    });
+}
+
+int MolUtil::GetHydrogenNum(const ElementType &_element, const int &_charge, const int &_bondOrderSum) {
+    auto result = ElementUtil::GetElementNebNum(_element);
+    if (!result) { return 0; }
+    int numHs = result.value() - _bondOrderSum;
+    // 对电荷的特别处理
+    if (0 != _charge) {
+        switch (_element) {
+            case ElementType::C: {
+                if (_charge == 1) {// 碳正离子
+                    numHs -= 1;
+                } else if (_charge == -1) {// 碳负离子
+                    numHs -= 1;
+                }
+                break;
+            }
+            case ElementType::N: {
+                if (_charge == 1) {// 铵正离子
+                    numHs += 1;
+                } else {
+                    numHs -= std::floor(_charge / 2.0);
+                }
+                break;
+            }
+            case ElementType::O: {
+                if (_charge == -1) {
+                    numHs -= 1;
+                }
+                break;
+            }
+            default: {
+                numHs -= std::floor(_charge / 2.0);
+                break;
+            }
+        }
+    }
+    return numHs;
+}
+
+void MolUtil::GetHydrogenNums(const MolGraph &_graph, std::vector<int> &_numHs) {
+    const size_t atomNum = _graph.getAtomNum();
+    _numHs.assign(atomNum, 0);
+    for (MolGraph::index_type b = 0; b < _graph.getBondNum(); b++) {
+        const int order = Bond::GetBondOrder(_graph.getBondType(b));
+        _numHs[_graph.getBondFrom(b)] += order;
+        _numHs[_graph.getBondTo(b)] += order;
+    }
+    for (MolGraph::index_type i = 0; i < atomNum; i++) {
+        _numHs[i] = (std::max)(0, GetHydrogenNum(_graph.getElement(i), _graph.getCharge(i), _numHs[i]));
+    }
+}
@@ -0,0 +1,226 @@
+#include "ckit/mol_view_cache.h"
+#include "ckit/mol.h"
+#include "ckit/atom.h"
+#include "ckit/bond.h"
+#include "ckit/smiles_writer.h"
+#include "base/log.h"
+#include <openbabel/atom.h>
+#include <openbabel/bond.h>
+#include <functional>
+#include <stdexcept>
+
+/**
+ * 粗略估算一个视图占的内存：JMol 的记录、OBMol 里对应的对象，再加上哈希表节点和引用计数块
+ */
+static size_t EstimateBytes(GuiMol &_mol) {
+    const size_t overhead = 64;
+    auto graph = _mol.getGraph();
+    return sizeof(GuiMol) + graph->getAtomNum() * (sizeof(Atom) + sizeof(OpenBabel::OBAtom) + overhead) +
+           graph->getBondNum() * (sizeof(Bond) + sizeof(OpenBabel::OBBond) + overhead);
+}
+
+MolViewCache::MolViewCache(const size_t &_capacity) : capacity(_capacity), nextGeneration(0) {
+}
+
+/**
+ * 规范键和画法键拼在一起，画法键是定长的二进制记录，不会和规范键混淆
+ */
+static std::string GetInputKey(GuiMol &_mol) {
+    return MolViewCache::GetCanonicalKey(_mol) + '\n' + MolViewCache::GetDrawingKey(_mol);
+}
+
+std::string MolViewCache::GetCanonicalKey(GuiMol &_mol) {
+    // 名字写在各自的原子上，同一骨架上交换两个字符串原子得到的是不同的键
+    return SmilesWriter::Write(*_mol.getGraph(), true);
+}
+
+std::string MolViewCache::GetDrawingKey(GuiMol &_mol) {
+    using index_type = MolGraph::index_type;
+    auto graph = _mol.getGraph();
+    std::string key;
+    auto append = [&](const auto &_value) {
+        key.append(reinterpret_cast<const char *>(&_value), sizeof(_value));
+    };
+    // 图快照的原子、键已按 id 升序
+    for (index_type i = 0; i < graph->getAtomNum(); i++) {
+        auto &&[x, y] = graph->getPos2D(i);
+        append(graph->getAtomId(i));
+        append(x);
+        append(y);
+    }
+    for (index_type b = 0; b < graph->getBondNum(); b++) {
+        append(graph->getBondId(b));
+        append(graph->getAtomId(graph->getBondFrom(b)));
+        append(graph->getAtomId(graph->getBondTo(b)));
+    }
+    return key;
+}
+
+uint64_t MolViewCache::GetKey(GuiMol &_mol) {
+    return std::hash<std::string>()(GetInputKey(_mol));
+}
+
+MolViewCache::Entry &MolViewCache::touch(const uint64_t &_key, const std::string &_inputKey) {
+    auto it = entries.find(_key);
+    if (entries.end() != it && it->second.inputKey != _inputKey) {
+        LOG_WARN << "mol view cache key collides";
+        eraseLocked(_key);
+        it = entries.end();
+    }
+    if (entries.end() == it) {
+        lru.push_front(_key);
+        it = entries.emplace(_key, Entry()).first;
+        it->second.inputKey = _inputKey;
+        it->second.generation = nextGeneration++;
+        it->second.lruIt = lru.begin();
+        ++stats.entryNum;
+    } else {
+        lru.splice(lru.begin(), lru, it->second.lruIt);
+    }
+    return it->second;
+}
+
+void MolViewCache::eraseLocked(const uint64_t &_key) {
+    auto it = entries.find(_key);
+    if (entries.end() == it) { return; }
+    auto &entry = it->second;
+    for (size_t t = 0; t < sViewTypeNum; t++) {
+        if (entry.viewBytes[t] > 0) {
+            stats.bytes -= entry.viewBytes[t];
+            --stats.viewNum;
+        }
+    }
+    lru.erase(entry.lruIt);
+    entries.erase(it);
+    --stats.entryNum;
+}
+
+void MolViewCache::evictLocked() {
+    // 最近用过的那个即使单独超出容量也留着
+    while (stats.bytes > capacity && lru.size() > 1) {
+        const uint64_t key = lru.back();
+        eraseLocked(key);
+        ++stats.evictionNum;
+    }
+}
+
+gui_mol MolViewCache::compute(const gui_mol &_input, const MolViewType &_type) {
+    gui_mol view;
+    switch (_type) {
+        case MolViewType::Expanded:
+            // 展开只复制字符串原子和它们的键，其余记录和输入共享
+            view = _input->snapshot();
+            view->tryExpand();
+            break;
+        case MolViewType::FullHydrogen:
+            view = _input->snapshot();
+            view->addAllHydrogens();
+            break;
+        case MolViewType::FullHydrogenExpanded:
+            view = get(_input, MolViewType::Expanded);
+            view->addAllHydrogens();
+            break;
+        case MolViewType::Coord2D:
+            view = get(_input, MolViewType::Expanded);
+            view->set2DInfoLatest(false);
+            if (!view->generate2D()) {
+                throw std::runtime_error("fail to generate 2d");
+            }
+            break;
+        case MolViewType::Coord3D:
+            view = get(_input, MolViewType::FullHydrogenExpanded);
+            if (!view->generate3D(Coord3DQuality::Refined)) {
+                throw std::runtime_error("fail to generate 3d");
+            }
+            break;
+    }
+    return view;
+}
+
+gui_mol MolViewCache::get(const gui_mol &_input, const MolViewType &_type) {
+    const std::string inputKey = GetInputKey(*_input);
+    const uint64_t key = std::hash<std::string>()(inputKey);
+    const auto t = static_cast<size_t>(_type);
+    std::shared_future<gui_mol> future;
+    std::promise<gui_mol> promise;
+    uint64_t generation = 0;
+    bool isOwner = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &entry = touch(key, inputKey);
+        if (entry.views[t].valid()) {
+            future = entry.views[t];
+            ++stats.hitNum;
+        } else {
+            future = promise.get_future().share();
+            entry.views[t] = future;
+            generation = entry.generation;
+            isOwner = true;
+            ++stats.missNum;
+        }
+    }
+    if (isOwner) {
+        gui_mol view;
+        try {
+            view = compute(_input, _type);
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = entries.find(key);
+                if (entries.end() != it && generation == it->second.generation) {
+                    it->second.views[t] = std::shared_future<gui_mol>();
+                }
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        const size_t bytes = EstimateBytes(*view);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(key);
+            if (entries.end() != it && generation == it->second.generation) {
+                it->second.viewBytes[t] = bytes;
+                stats.bytes += bytes;
+                ++stats.viewNum;
+                evictLocked();
+            }
+        }
+        promise.set_value(view);
+    }
+    auto master = future.get();
+    // 缓存里的那份不交给调用方，只给出共享记录的快照，调用方改写时自己复制
+    std::lock_guard<std::mutex> lock(mutex);
+    return master->snapshot();
+}
+
+void MolViewCache::invalidate(const uint64_t &_key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    eraseLocked(_key);
+}
+
+void MolViewCache::invalidate(GuiMol &_mol) {
+    invalidate(GetKey(_mol));
+}
+
+void MolViewCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    lru.clear();
+    stats.entryNum = stats.viewNum = stats.bytes = 0;
+}
+
+void MolViewCache::setCapacity(const size_t &_capacity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = _capacity;
+    evictLocked();
+}
+
+MolViewCache::Stats MolViewCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+MolViewCache &MolViewCache::GetInstance() {
+    static MolViewCache cache;
+    return cache;
+}
@@ -0,0 +1,274 @@
+#include "ckit/ring_finder.h"
+
+#include <algorithm>
+
+void RingSet::clear() {
+    atoms.clear();
+    offsets.assign(1, 0);
+}
+
+size_t RingSet::size() const {
+    return offsets.size() - 1;
+}
+
+bool RingSet::empty() const {
+    return offsets.size() <= 1;
+}
+
+RingSet::Span RingSet::operator[](const size_t &_i) const {
+    return {atoms.data() + offsets[_i], atoms.data() + offsets[_i + 1]};
+}
+
+RingFinder::RingFinder() : atomNum(0), bondNum(0), wordNum(0) {
+}
+
+void RingFinder::buildAdjacency(const MolGraph &_graph) {
+    atomNum = _graph.getAtomNum();
+    bondNum = _graph.getBondNum();
+    wordNum = (bondNum + 63) / 64;
+    adjStart.assign(atomNum + 1, 0);
+    adjAtoms.clear();
+    adjBonds.clear();
+    for (index_type i = 0; i < atomNum; i++) {
+        _graph.forEachNeighbor(i, [&](const index_type &_nb, const index_type &_b) {
+            adjAtoms.push_back(_nb);
+            adjBonds.push_back(_b);
+        });
+        adjStart[i + 1] = static_cast<index_type>(adjAtoms.size());
+    }
+}
+
+size_t RingFinder::findRingBonds() {
+    constexpr uint32_t unvisited = UINT32_MAX;
+    isRingBond.assign(bondNum, false);
+    disc.assign(atomNum, unvisited);
+    low.assign(atomNum, 0);
+    parentBonds.assign(atomNum, MolGraph::npos);
+    uint32_t timer = 0;
+    // 迭代版 Tarjan：树边两端满足 low[v] <= disc[u] 时在环上，非树边总在环上
+    for (index_type s = 0; s < atomNum; s++) {
+        if (unvisited != disc[s]) { continue; }
+        disc[s] = low[s] = timer++;
+        stackAtoms.assign(1, s);
+        stackPos.assign(1, adjStart[s]);
+        while (!stackAtoms.empty()) {
+            const index_type u = stackAtoms.back();
+            index_type &k = stackPos.back();
+            if (k < adjStart[u + 1]) {
+                const index_type v = adjAtoms[k], b = adjBonds[k];
+                ++k;
+                if (b == parentBonds[u]) { continue; }
+                if (unvisited == disc[v]) {
+                    disc[v] = low[v] = timer++;
+                    parentBonds[v] = b;
+                    stackAtoms.push_back(v);
+                    stackPos.push_back(adjStart[v]);
+                } else {
+                    low[u] = (std::min)(low[u], disc[v]);
+                    if (disc[v] < disc[u]) { isRingBond[b] = true; }
+                }
+                continue;
+            }
+            stackAtoms.pop_back();
+            stackPos.pop_back();
+            if (stackAtoms.empty()) { continue; }
+            const index_type p = stackAtoms.back();
+            low[p] = (std::min)(low[p], low[u]);
+            if (low[u] <= disc[p]) { isRingBond[parentBonds[u]] = true; }
+        }
+    }
+    // 圈秩只在环键构成的子图上数
+    size_t edgeNum = 0, vertexNum = 0, componentNum = 0;
+    for (size_t b = 0; b < bondNum; b++) {
+        if (isRingBond[b]) { ++edgeNum; }
+    }
+    if (0 == edgeNum) { return 0; }
+    dist.assign(atomNum, UINT32_MAX);
+    for (index_type s = 0; s < atomNum; s++) {
+        if (UINT32_MAX != dist[s]) { continue; }
+        bool hasRingBond = false;
+        for (index_type k = adjStart[s]; k < adjStart[s + 1]; k++) {
+            if (isRingBond[adjBonds[k]]) { hasRingBond = true; }
+        }
+        if (!hasRingBond) { continue; }
+        ++componentNum;
+        queue.assign(1, s);
+        dist[s] = 0;
+        for (size_t head = 0; head < queue.size(); head++) {
+            const index_type u = queue[head];
+            ++vertexNum;
+            for (index_type k = adjStart[u]; k < adjStart[u + 1]; k++) {
+                if (!isRingBond[adjBonds[k]] || UINT32_MAX != dist[adjAtoms[k]]) { continue; }
+                dist[adjAtoms[k]] = 0;
+                queue.push_back(adjAtoms[k]);
+            }
+        }
+    }
+    return edgeNum - vertexNum + componentNum;
+}
+
+void RingFinder::collectCandidates() {
+    candidates.clear();
+    candidateAtoms.clear();
+    candidateWords.clear();
+    std::vector<char> isRingAtom(atomNum, false);
+    for (index_type u = 0; u < atomNum; u++) {
+        for (index_type k = adjStart[u]; k < adjStart[u + 1]; k++) {
+            if (isRingBond[adjBonds[k]]) { isRingAtom[u] = true; }
+        }
+    }
+    dist.assign(atomNum, UINT32_MAX);
+    parentAtoms.assign(atomNum, MolGraph::npos);
+    parentBonds.assign(atomNum, MolGraph::npos);
+    for (index_type r = 0; r < atomNum; r++) {
+        if (!isRingAtom[r]) { continue; }
+        // 以 r 为根在环键上做 BFS
+        queue.assign(1, r);
+        dist[r] = 0;
+        for (size_t head = 0; head < queue.size(); head++) {
+            const index_type u = queue[head];
+            for (index_type k = adjStart[u]; k < adjStart[u + 1]; k++) {
+                const index_type v = adjAtoms[k];
+                if (!isRingBond[adjBonds[k]] || UINT32_MAX != dist[v]) { continue; }
+                dist[v] = dist[u] + 1;
+                parentAtoms[v] = u;
+                parentBonds[v] = adjBonds[k];
+                queue.push_back(v);
+            }
+        }
+        // 每根非树边 (x,y) 和两条树上路径围成候选环，要求两条路径只在 r 相交
+        for (auto &x: queue) {
+            for (index_type k = adjStart[x]; k < adjStart[x + 1]; k++) {
+                const index_type y = adjAtoms[k], b = adjBonds[k];
+                if (!isRingBond[b] || x > y || parentBonds[x] == b || parentBonds[y] == b) { continue; }
+                index_type a1 = x, a2 = y;
+                while (dist[a1] > dist[a2]) { a1 = parentAtoms[a1]; }
+                while (dist[a2] > dist[a1]) { a2 = parentAtoms[a2]; }
+                while (a1 != a2) {
+                    a1 = parentAtoms[a1];
+                    a2 = parentAtoms[a2];
+                }
+                if (a1 != r) { continue; }
+                Candidate candidate{dist[x] + dist[y] + 1, static_cast<uint32_t>(candidateAtoms.size()),
+                                    static_cast<uint32_t>(candidateWords.size())};
+                candidateWords.resize(candidateWords.size() + wordNum, 0);
+                uint64_t *words = candidateWords.data() + candidate.wordOffset;
+                words[b / 64] |= uint64_t(1) << (b % 64);
+                // 原子序列 x -> r -> y，最后一个原子和第一个原子由 b 相连
+                for (index_type a = x; a != r; a = parentAtoms[a]) {
+                    candidateAtoms.push_back(a);
+                    words[parentBonds[a] / 64] |= uint64_t(1) << (parentBonds[a] % 64);
+                }
+                candidateAtoms.push_back(r);
+                const size_t tail = candidateAtoms.size();
+                for (index_type a = y; a != r; a = parentAtoms[a]) {
+                    candidateAtoms.push_back(a);
+                    words[parentBonds[a] / 64] |= uint64_t(1) << (parentBonds[a] % 64);
+                }
+                std::reverse(candidateAtoms.begin() + tail, candidateAtoms.end());
+                candidates.push_back(candidate);
+            }
+        }
+        for (auto &u: queue) {
+            dist[u] = UINT32_MAX;
+            parentAtoms[u] = parentBonds[u] = MolGraph::npos;
+        }
+    }
+    // 按长度、再按边集排序，边集相同的候选只留一个
+    candidateOrder.resize(candidates.size());
+    for (uint32_t i = 0; i < candidateOrder.size(); i++) { candidateOrder[i] = i; }
+    auto words_of = [&](const uint32_t &_i) { return candidateWords.data() + candidates[_i].wordOffset; };
+    std::sort(candidateOrder.begin(), candidateOrder.end(), [&](const uint32_t &_a, const uint32_t &_b) {
+        if (candidates[_a].length != candidates[_b].length) {
+            return candidates[_a].length < candidates[_b].length;
+        }
+        return std::lexicographical_compare(words_of(_a), words_of(_a) + wordNum, words_of(_b), words_of(_b) + wordNum);
+    });
+    candidateOrder.erase(std::unique(candidateOrder.begin(), candidateOrder.end(),
+                                     [&](const uint32_t &_a, const uint32_t &_b) {
+                                         return std::equal(words_of(_a), words_of(_a) + wordNum, words_of(_b));
+                                     }), candidateOrder.end());
+}
+
+bool RingFinder::reduce(const size_t &_rowNum) {
+    for (size_t i = 0; i < _rowNum; i++) {
+        const uint32_t pivot = pivots[i];
+        if (!(work[pivot / 64] >> (pivot % 64) & 1)) { continue; }
+        const uint64_t *row = basisWords.data() + i * wordNum;
+        for (size_t w = 0; w < wordNum; w++) { work[w] ^= row[w]; }
+    }
+    return std::any_of(work.begin(), work.end(), [](const uint64_t &_w) { return 0 != _w; });
+}
+
+void RingFinder::appendBasisRow() {
+    for (uint32_t w = 0; w < wordNum; w++) {
+        if (work[w]) {
+            uint32_t bit = 0;
+            while (!(work[w] >> bit & 1)) { ++bit; }
+            pivots.push_back(w * 64 + bit);
+            break;
+        }
+    }
+    basisWords.insert(basisWords.end(), work.begin(), work.end());
+}
+
+void RingFinder::appendRing(RingSet &_rings, const Candidate &_candidate) {
+    const index_type *first = candidateAtoms.data() + _candidate.atomOffset;
+    const size_t length = _candidate.length;
+    const size_t start = std::min_element(first, first + length) - first;
+    const index_type next = first[(start + 1) % length], prev = first[(start + length - 1) % length];
+    const bool forward = next < prev;
+    for (size_t k = 0; k < length; k++) {
+        _rings.atoms.push_back(first[forward ? (start + k) % length : (start + length - k) % length]);
+    }
+    _rings.offsets.push_back(static_cast<uint32_t>(_rings.atoms.size()));
+}
+
+const RingSet &RingFinder::findSSSR(const MolGraph &_graph) {
+    sssr.clear();
+    buildAdjacency(_graph);
+    const size_t rank = findRingBonds();
+    if (0 == rank) { return sssr; }
+    collectCandidates();
+    basisWords.clear();
+    pivots.clear();
+    for (auto &i: candidateOrder) {
+        auto &candidate = candidates[i];
+        work.assign(candidateWords.begin() + candidate.wordOffset,
+                    candidateWords.begin() + candidate.wordOffset + wordNum);
+        if (!reduce(pivots.size())) { continue; }
+        appendBasisRow();
+        appendRing(sssr, candidate);
+        if (pivots.size() == rank) { break; }
+    }
+    return sssr;
+}
+
+const RingSet &RingFinder::findRelevantCycles(const MolGraph &_graph) {
+    relevantCycles.clear();
+    buildAdjacency(_graph);
+    const size_t rank = findRingBonds();
+    if (0 == rank) { return relevantCycles; }
+    collectCandidates();
+    basisWords.clear();
+    pivots.clear();
+    // 同一长度的候选只和更短的环比较，基满了之后不会再有更长的相关环
+    for (size_t groupBegin = 0; groupBegin < candidateOrder.size() && pivots.size() < rank;) {
+        const uint32_t length = candidates[candidateOrder[groupBegin]].length;
+        size_t groupEnd = groupBegin;
+        while (groupEnd < candidateOrder.size() && candidates[candidateOrder[groupEnd]].length == length) {
+            ++groupEnd;
+        }
+        const size_t shorterNum = pivots.size();
+        for (size_t k = groupBegin; k < groupEnd; k++) {
+            auto &candidate = candidates[candidateOrder[k]];
+            work.assign(candidateWords.begin() + candidate.wordOffset,
+                        candidateWords.begin() + candidate.wordOffset + wordNum);
+            if (!reduce(shorterNum)) { continue; }
+            appendRing(relevantCycles, candidate);
+            if (reduce(pivots.size())) { appendBasisRow(); }
+        }
+        groupBegin = groupEnd;
+    }
+    return relevantCycles;
+}
@@ -0,0 +1,466 @@
+#include "ckit/smiles_writer.h"
+#include "ckit/mol_graph.h"
+#include "ckit/mol_util.h"
+#include "ckit/atom.h"
+#include "base/element_type.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+using index_type = MolGraph::index_type;
+
+/**
+ * 键在排序和价态计算里的编码：单键类 1，双键 2，三键 3，离域键 4
+ */
+static int GetBondCode(const BondType &_type) {
+    switch (_type) {
+        case BondType::DoubleBond:
+            return 2;
+        case BondType::TripleBond:
+            return 3;
+        case BondType::DelocalizedBond:
+            return 4;
+        default:
+            return 1;
+    }
+}
+
+/**
+ * 有机子集元素允许的价态，不在表里的元素一律写成方括号原子
+ */
+static const std::vector<int> *GetSmilesValences(const ElementType &_element) {
+    static const std::unordered_map<ElementType, std::vector<int>> sValenceMap = {
+            {ElementType::B,  {3}},
+            {ElementType::C,  {4}},
+            {ElementType::N,  {3, 5}},
+            {ElementType::O,  {2}},
+            {ElementType::P,  {3, 5}},
+            {ElementType::S,  {2, 4, 6}},
+            {ElementType::F,  {1}},
+            {ElementType::Cl, {1}},
+            {ElementType::Br, {1}},
+            {ElementType::I,  {1}}
+    };
+    auto it = sValenceMap.find(_element);
+    return sValenceMap.end() == it ? nullptr : &it->second;
+}
+
+static bool HasAromaticSymbol(const ElementType &_element) {
+    switch (_element) {
+        case ElementType::B:
+        case ElementType::C:
+        case ElementType::N:
+        case ElementType::O:
+        case ElementType::P:
+        case ElementType::S:
+        case ElementType::As:
+        case ElementType::Se:
+        case ElementType::Te:
+            return true;
+        default:
+            return false;
+    }
+}
+
+namespace {
+    class SmilesBuilder {
+        struct Closure {
+            index_type open, close, bond;
+            int digit;
+        };
+        struct Frame {
+            index_type atom;
+            size_t next;
+            bool isBranch;
+        };
+        const MolGraph &g;
+        const size_t n;
+        const bool withSuperAtomNames;
+        // 没有被折叠成氢计数的原子
+        std::vector<char> kept;
+        std::vector<int> hCounts;
+        // 被折叠的氢原子之一，判断手性时用它的坐标
+        std::vector<index_type> foldedH;
+        std::vector<char> aromatic;
+        // 对称类（细化后、打破平局前）和最终的规范序
+        std::vector<uint32_t> symClasses, ranks;
+        std::vector<index_type> parents, parentBonds;
+        std::vector<std::vector<index_type>> children;
+        std::vector<Closure> closures;
+        std::vector<std::vector<size_t>> atomClosures;
+        std::string out;
+        // 细化时复用的缓冲
+        std::vector<std::vector<uint64_t>> keys;
+        std::vector<index_type> order;
+
+        void foldHydrogens() {
+            for (index_type i = 0; i < n; i++) {
+                if (ElementType::H != g.getElement(i) || 0 != g.getCharge(i) || 1 != g.getDegree(i)) { continue; }
+                g.forEachNeighbor(i, [&](const index_type &_nb, const index_type &) {
+                    if (ElementType::H == g.getElement(_nb)) { return; }
+                    kept[i] = false;
+                    ++hCounts[_nb];
+                    if (MolGraph::npos == foldedH[_nb]) { foldedH[_nb] = i; }
+                });
+            }
+            g.forEachBond([&](const index_type &_b) {
+                if (BondType::DelocalizedBond != g.getBondType(_b)) { return; }
+                aromatic[g.getBondFrom(_b)] = aromatic[g.getBondTo(_b)] = true;
+            });
+            // 没有补氢的分子按常用价态补上隐式氢，已连着的显式氢计入键级和，不会重复
+            std::vector<int> implicitHs;
+            MolUtil::GetHydrogenNums(g, implicitHs);
+            for (index_type i = 0; i < n; i++) {
+                if (!kept[i]) { continue; }
+                // 离域键按单键计入，芳香原子再让出一价
+                hCounts[i] += (std::max)(0, implicitHs[i] - (aromatic[i] ? 1 : 0));
+            }
+        }
+
+        template<typename Func>
+        void forEachKeptNeighbor(const index_type &_i, Func &&_func) const {
+            g.forEachNeighbor(_i, [&](const index_type &_nb, const index_type &_b) {
+                if (kept[_nb]) { _func(_nb, _b); }
+            });
+        }
+
+        /**
+         * 按邻居的秩迭代细化，直到类数不再增加
+         * @return 类数
+         */
+        size_t refine() {
+            size_t classNum = 0;
+            while (true) {
+                for (auto &i: order) {
+                    auto &key = keys[i];
+                    key.clear();
+                    forEachKeptNeighbor(i, [&](const index_type &_nb, const index_type &_b) {
+                        key.push_back(static_cast<uint64_t>(ranks[_nb]) * 8 + GetBondCode(g.getBondType(_b)));
+                    });
+                    std::sort(key.begin(), key.end());
+                    key.insert(key.begin(), ranks[i]);
+                }
+                std::sort(order.begin(), order.end(), [&](const index_type &_a, const index_type &_b) {
+                    return keys[_a] < keys[_b];
+                });
+                size_t newClassNum = 0;
+                for (size_t k = 0; k < order.size(); k++) {
+                    if (k > 0 && keys[order[k]] != keys[order[k - 1]]) { ++newClassNum; }
+                    ranks[order[k]] = static_cast<uint32_t>(newClassNum);
+                }
+                if (!order.empty()) { ++newClassNum; }
+                if (newClassNum == classNum) { break; }
+                classNum = newClassNum;
+            }
+            return classNum;
+        }
+
+        void rankAtoms() {
+            for (index_type i = 0; i < n; i++) {
+                if (kept[i]) { order.push_back(i); }
+            }
+            // 初始不变量：连接数、原子序数、电荷、氢计数、芳香性、键级和
+            for (auto &i: order) {
+                int degree = 0, bondSum = 0;
+                forEachKeptNeighbor(i, [&](const index_type &, const index_type &_b) {
+                    ++degree;
+                    bondSum += GetBondCode(g.getBondType(_b));
+                });
+                keys[i] = {static_cast<uint64_t>(degree), static_cast<uint64_t>(g.getElement(i)),
+                           static_cast<uint64_t>(static_cast<int64_t>(g.getCharge(i)) + 128),
+                           static_cast<uint64_t>(hCounts[i]), static_cast<uint64_t>(aromatic[i]),
+                           static_cast<uint64_t>(bondSum), 0};
+                if (withSuperAtomNames && ElementType::SA == g.getElement(i)) {
+                    keys[i].back() = std::hash<std::string>()(g.getAtom(i).getName());
+                }
+            }
+            std::sort(order.begin(), order.end(), [&](const index_type &_a, const index_type &_b) {
+                return keys[_a] < keys[_b];
+            });
+            uint32_t rank = 0;
+            for (size_t k = 0; k < order.size(); k++) {
+                if (k > 0 && keys[order[k]] != keys[order[k - 1]]) { ++rank; }
+                ranks[order[k]] = rank;
+            }
+            size_t classNum = refine();
+            symClasses = ranks;
+            // 对称的原子任取一个提前，再细化，直到每个原子的秩都不同
+            while (classNum < order.size()) {
+                index_type chosen = MolGraph::npos;
+                for (size_t k = 1; k < order.size(); k++) {
+                    if (ranks[order[k]] == ranks[order[k - 1]]) {
+                        chosen = order[k - 1];
+                        break;
+                    }
+                }
+                const uint32_t tied = ranks[chosen];
+                for (auto &i: order) {
+                    ranks[i] = ranks[i] * 2 + (ranks[i] == tied && i != chosen ? 1 : 0);
+                }
+                classNum = refine();
+            }
+        }
+
+        void sortedKeptNeighbors(const index_type &_i, std::vector<std::pair<index_type, index_type>> &_nbs) {
+            _nbs.clear();
+            forEachKeptNeighbor(_i, [&](const index_type &_nb, const index_type &_b) { _nbs.emplace_back(_nb, _b); });
+            std::sort(_nbs.begin(), _nbs.end(), [&](const auto &_a, const auto &_b) {
+                return ranks[_a.first] < ranks[_b.first];
+            });
+        }
+
+        /**
+         * 第一遍深度优先：定下生成树的孩子顺序和闭环键
+         */
+        void traverse(const index_type &_start, std::vector<char> &_visited, std::vector<char> &_usedBonds) {
+            std::vector<std::vector<std::pair<index_type, index_type>>> nbCache;
+            std::vector<std::pair<index_type, size_t>> stack;
+            std::vector<std::pair<index_type, index_type>> nbs;
+            auto visit = [&](const index_type &_i) {
+                _visited[_i] = true;
+                sortedKeptNeighbors(_i, nbs);
+                nbCache.push_back(nbs);
+                stack.emplace_back(_i, 0);
+            };
+            visit(_start);
+            while (!stack.empty()) {
+                auto[u, k] = stack.back();
+                auto &uNbs = nbCache.back();
+                if (k == uNbs.size()) {
+                    stack.pop_back();
+                    nbCache.pop_back();
+                    continue;
+                }
+                ++stack.back().second;
+                auto[v, b] = uNbs[k];
+                if (_usedBonds[b]) { continue; }
+                _usedBonds[b] = true;
+                if (!_visited[v]) {
+                    parents[v] = u;
+                    parentBonds[v] = b;
+                    children[u].push_back(v);
+                    visit(v);
+                } else {
+                    atomClosures[v].push_back(closures.size());
+                    atomClosures[u].push_back(closures.size());
+                    closures.push_back({v, u, b, -1});
+                }
+            }
+        }
+
+        std::string getBondSymbol(const index_type &_bond, const index_type &_a1, const index_type &_a2) const {
+            switch (GetBondCode(g.getBondType(_bond))) {
+                case 2:
+                    return "=";
+                case 3:
+                    return "#";
+                case 4:
+                    return "";
+                default:
+                    return aromatic[_a1] && aromatic[_a2] ? "-" : "";
+            }
+        }
+
+        /**
+         * 手性中心必须是某根楔形键的起点，连接数加氢计数为 4（或 3 且不带氢），且邻居两两不对称
+         * @return "@"、"@@" 或空串
+         */
+        std::string getChirality(const index_type &_i) const {
+            std::vector<index_type> nbs;
+            if (MolGraph::npos != parents[_i]) { nbs.push_back(parents[_i]); }
+            const size_t hPos = nbs.size();
+            for (auto &c: atomClosures[_i]) {
+                nbs.push_back(closures[c].open == _i ? closures[c].close : closures[c].open);
+            }
+            nbs.insert(nbs.end(), children[_i].begin(), children[_i].end());
+            const size_t total = nbs.size() + hCounts[_i];
+            if (hCounts[_i] > 1 || (4 != total && !(3 == total && 0 == hCounts[_i]))) { return ""; }
+            bool hasWedge = false;
+            g.forEachNeighbor(_i, [&](const index_type &, const index_type &_b) {
+                auto type = g.getBondType(_b);
+                if ((BondType::SolidWedgeBond == type || BondType::DashWedgeBond == type) && g.getBondFrom(_b) == _i) {
+                    hasWedge = true;
+                }
+            });
+            if (!hasWedge) { return ""; }
+            for (size_t a = 0; a < nbs.size(); a++) {
+                for (size_t b = a + 1; b < nbs.size(); b++) {
+                    if (symClasses[nbs[a]] == symClasses[nbs[b]]) { return ""; }
+                }
+            }
+            // 图像坐标 y 轴朝下，翻转后实楔形朝向观察者
+            auto &&[x0, y0] = g.getPos2D(_i);
+            auto toVec = [&](const index_type &_nb) -> std::vector<double> {
+                auto &&[x, y] = g.getPos2D(_nb);
+                double dx = x - x0, dy = y0 - y, len = std::sqrt(dx * dx + dy * dy), dz = 0;
+                if (len > 1e-6) {
+                    dx /= len;
+                    dy /= len;
+                }
+                auto b = g.findBond(_i, _nb);
+                if (MolGraph::npos != b && g.getBondFrom(b) == _i) {
+                    if (BondType::SolidWedgeBond == g.getBondType(b)) { dz = 1; }
+                    else if (BondType::DashWedgeBond == g.getBondType(b)) { dz = -1; }
+                }
+                return {dx, dy, dz};
+            };
+            std::vector<std::vector<double>> vecs;
+            for (auto &nb: nbs) { vecs.push_back(toVec(nb)); }
+            if (1 == hCounts[_i] && MolGraph::npos != foldedH[_i]) {
+                vecs.insert(vecs.begin() + hPos, toVec(foldedH[_i]));
+            } else if (3 == vecs.size()) {
+                // 孤对电子或隐式氢放在三个邻居的反方向
+                std::vector<double> lonePair(3, 0);
+                for (auto &vec: vecs) {
+                    for (int d = 0; d < 3; d++) { lonePair[d] -= vec[d]; }
+                }
+                vecs.insert(vecs.begin() + hPos, lonePair);
+            }
+            double a[3], b[3], c[3];
+            for (int d = 0; d < 3; d++) {
+                a[d] = vecs[1][d] - vecs[0][d];
+                b[d] = vecs[2][d] - vecs[0][d];
+                c[d] = vecs[3][d] - vecs[0][d];
+            }
+            // 从第一个邻居看过去，其余三个逆时针时体积为负
+            const double volume = a[0] * (b[1] * c[2] - b[2] * c[1])
+                                  + a[1] * (b[2] * c[0] - b[0] * c[2])
+                                  + a[2] * (b[0] * c[1] - b[1] * c[0]);
+            if (std::fabs(volume) < 1e-3) { return ""; }
+            return volume < 0 ? "@" : "@@";
+        }
+
+        bool needBracket(const index_type &_i, const ElementType &_element) const {
+            auto valences = GetSmilesValences(_element);
+            if (!valences || 0 != g.getCharge(_i)) { return true; }
+            int bondSum = 0;
+            forEachKeptNeighbor(_i, [&](const index_type &, const index_type &_b) {
+                int code = GetBondCode(g.getBondType(_b));
+                bondSum += 4 == code ? 1 : code;
+            });
+            int defaultHCount = 0;
+            if (aromatic[_i]) {
+                // 芳香的 O、S 不带氢，其余元素的芳香键额外贡献一价
+                if (ElementType::O != _element && ElementType::S != _element) {
+                    defaultHCount = (std::max)(0, valences->front() - bondSum - 1);
+                }
+            } else {
+                auto it = std::find_if(valences->begin(), valences->end(), [&](const int &_v) {
+                    return _v >= bondSum;
+                });
+                if (valences->end() == it) { return true; }
+                defaultHCount = *it - bondSum;
+            }
+            return defaultHCount != hCounts[_i];
+        }
+
+        void writeAtom(const index_type &_i, std::vector<int> &_digits) {
+            const ElementType element = g.getElement(_i);
+            const std::string &symbol = ElementType::SA == element
+                                        ? ElementUtil::convertElementTypeToString(ElementType::At)
+                                        : ElementUtil::convertElementTypeToString(element);
+            std::string name = symbol;
+            if (aromatic[_i] && HasAromaticSymbol(element)) {
+                std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            }
+            const std::string chirality = getChirality(_i);
+            if (ElementType::SA != element && chirality.empty() && !needBracket(_i, element)) {
+                out += name;
+            } else {
+                out += '[';
+                out += name;
+                if (withSuperAtomNames && ElementType::SA == element) {
+                    out += ':';
+                    out += g.getAtom(_i).getName();
+                }
+                out += chirality;
+                if (hCounts[_i] > 0) {
+                    out += 'H';
+                    if (hCounts[_i] > 1) { out += std::to_string(hCounts[_i]); }
+                }
+                const int charge = g.getCharge(_i);
+                if (0 != charge) {
+                    out += charge > 0 ? '+' : '-';
+                    if (std::abs(charge) > 1) { out += std::to_string(std::abs(charge)); }
+                }
+                out += ']';
+            }
+            // 本原子上闭合的编号在处理完所有闭环后才释放，避免同一原子上出现 11 这样的写法
+            std::vector<int> released;
+            for (auto &c: atomClosures[_i]) {
+                auto &closure = closures[c];
+                if (closure.open == _i) {
+                    int digit = 1;
+                    while (digit < static_cast<int>(_digits.size()) && _digits[digit]) { ++digit; }
+                    if (digit == static_cast<int>(_digits.size())) { _digits.push_back(0); }
+                    _digits[digit] = true;
+                    closure.digit = digit;
+                    out += getBondSymbol(closure.bond, closure.open, closure.close);
+                } else {
+                    released.push_back(closure.digit);
+                }
+                const int digit = closure.digit;
+                if (digit < 10) {
+                    out += static_cast<char>('0' + digit);
+                } else {
+                    out += '%';
+                    out += std::to_string(digit);
+                }
+            }
+            for (auto &digit: released) { _digits[digit] = false; }
+        }
+
+        /**
+         * 第二遍按生成树输出，除最后一个孩子外都写成分支
+         */
+        void emit(const index_type &_start) {
+            std::vector<int> digits(1, 0);
+            std::vector<Frame> stack;
+            writeAtom(_start, digits);
+            stack.push_back({_start, 0, false});
+            while (!stack.empty()) {
+                const index_type u = stack.back().atom;
+                if (stack.back().next == children[u].size()) {
+                    if (stack.back().isBranch) { out += ')'; }
+                    stack.pop_back();
+                    continue;
+                }
+                const index_type v = children[u][stack.back().next++];
+                const bool isBranch = stack.back().next < children[u].size();
+                if (isBranch) { out += '('; }
+                out += getBondSymbol(parentBonds[v], u, v);
+                writeAtom(v, digits);
+                stack.push_back({v, 0, isBranch});
+            }
+        }
+
+    public:
+        SmilesBuilder(const MolGraph &_graph, const bool &_withSuperAtomNames)
+                : g(_graph), n(_graph.getAtomNum()), withSuperAtomNames(_withSuperAtomNames), kept(n, true), hCounts(n, 0), foldedH(n, MolGraph::npos),
+                  aromatic(n, false), ranks(n, 0), parents(n, MolGraph::npos), parentBonds(n, MolGraph::npos),
+                  children(n), atomClosures(n), keys(n) {
+        }
+
+        std::string build() {
+            foldHydrogens();
+            rankAtoms();
+            std::vector<char> visited(n, false), usedBonds(g.getBondNum(), false);
+            // order 已按最终秩升序，每个连通片从秩最小的原子开始
+            for (auto &start: order) {
+                if (visited[start]) { continue; }
+                traverse(start, visited, usedBonds);
+                if (!out.empty()) { out += '.'; }
+                emit(start);
+            }
+            return std::move(out);
+        }
+    };
+}
+
+std::string SmilesWriter::Write(const MolGraph &_graph, const bool &_withSuperAtomNames) {
+    return SmilesBuilder(_graph, _withSuperAtomNames).build();
+}
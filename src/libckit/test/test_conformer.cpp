@@ -0,0 +1,88 @@
+#include <catch2/catch.hpp>
+#include "ckit/conformer_service.h"
+#include "ckit/mol.h"
+#include "ckit/atom.h"
+#include <atomic>
+#include <future>
+#include <map>
+#include <thread>
+#include <tuple>
+
+TEST_CASE("background conformer lands in the shared geometry cache", "[conformer]") {
+    auto mol = std::make_shared<GuiMol>();
+    mol->readAs("CC(=O)Oc1ccccc1C(O)=O", "smi");
+    mol->addAllHydrogens();
+    ConformerService service(2);
+    std::atomic<int> progressNum{0};
+    ConformerService::Options options;
+    options.quality = Coord3DQuality::Fast;
+    options.timeBudget = std::chrono::milliseconds(0);
+    options.onProgress = [&](const float &_progress) {
+        CHECK(_progress >= 0);
+        CHECK(_progress <= 1);
+        ++progressNum;
+    };
+    auto task = service.submit(mol, options);
+    REQUIRE(task->wait() == ConformerState::Done);
+    REQUIRE(task->getProgress() == 1);
+    REQUIRE(progressNum > 0);
+    // 原分子直接取缓存里的坐标
+    REQUIRE(mol->writeAs("xyz", Coord3DQuality::Fast) == task->getMol()->writeAs("xyz", Coord3DQuality::Fast));
+}
+
+/**
+ * 按原子 id 记下三维坐标
+ */
+static std::map<id_type, std::tuple<float, float, float>> getCoords3D(GuiMol &_mol) {
+    std::map<id_type, std::tuple<float, float, float>> coords;
+    for (Atom &atom: _mol.atoms()) {
+        coords[atom.getId()] = {atom.xx, atom.yy, atom.zz};
+    }
+    return coords;
+}
+
+TEST_CASE("conformer tasks can be cancelled and time out", "[conformer]") {
+    auto mol = std::make_shared<GuiMol>();
+    mol->readAs("CCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCO", "smi");
+    mol->addAllHydrogens();
+    float k = 0;
+    mol->loopAtomVec([&](Atom &_atom) {
+        _atom.xx = k++;
+        _atom.yy = -k;
+        _atom.zz = 2 * k;
+    });
+    const auto coords = getCoords3D(*mol);
+    ConformerService service(1);
+    // 第一次进度回调时停住，等测试取消后再放行，力场在下一个检查点放弃
+    std::promise<void> started, cancelled;
+    auto cancelledFuture = cancelled.get_future().share();
+    std::atomic<bool> isStarted{false};
+    ConformerService::Options options;
+    options.timeBudget = std::chrono::milliseconds(0);
+    options.onProgress = [&](const float &) {
+        if (!isStarted.exchange(true)) {
+            started.set_value();
+            cancelledFuture.wait();
+        }
+    };
+    auto running = service.submit(mol, options);
+    options.onProgress = nullptr;
+    auto pending = service.submit(mol, options);
+    started.get_future().wait();
+    // 排队中的任务立即结束
+    pending->cancel();
+    REQUIRE(pending->getState() == ConformerState::Cancelled);
+    running->cancel();
+    cancelled.set_value();
+    REQUIRE(running->wait() == ConformerState::Cancelled);
+    // 取消后原子的三维坐标不动
+    REQUIRE(getCoords3D(*running->getMol()) == coords);
+    // 回调里睡过时间预算，下一个检查点一定超时
+    options.timeBudget = std::chrono::milliseconds(1);
+    options.onProgress = [](const float &) { std::this_thread::sleep_for(std::chrono::milliseconds(20)); };
+    auto timedOut = service.submit(mol, options);
+    REQUIRE(timedOut->wait() == ConformerState::TimedOut);
+    REQUIRE(getCoords3D(*timedOut->getMol()) == coords);
+    auto builder = service.submit(mol, {Coord3DQuality::Builder});
+    REQUIRE(builder->wait() == ConformerState::Done);
+}
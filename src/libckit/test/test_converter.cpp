@@ -0,0 +1,39 @@
+#include <catch2/catch.hpp>
+#include "ckit/mol_converter.h"
+#include <fstream>
+#include <sstream>
+
+TEST_CASE("converter keeps input order across chunks and threads", "[converter]") {
+    std::ifstream ifs(DEV_ASSETS_DIR + std::string("/datasets/drugbank.smi"));
+    REQUIRE(ifs.good());
+    std::vector<std::string> smiles;
+    std::string line;
+    while (smiles.size() < 9 && std::getline(ifs, line)) {
+        line = line.substr(0, line.find_first_of(" \t\r"));
+        if (!line.empty()) { smiles.push_back(line); }
+    }
+    REQUIRE(smiles.size() == 9);
+    // 第 4 个分子读不出来，空行不计入编号
+    const size_t badIndex = 4;
+    smiles.insert(smiles.begin() + badIndex, "][");
+    std::stringstream input;
+    for (size_t i = 0; i < smiles.size(); i++) {
+        input << smiles[i] << "\n";
+        if (2 == i) { input << "\n"; }
+    }
+    MolConverter::Options options;
+    options.threadNum = 3;
+    options.chunkSize = 3;
+    std::string expected;
+    for (size_t i = 0; i < smiles.size(); i++) {
+        if (badIndex != i) { expected += MolConverter::ConvertOne(smiles[i], options); }
+    }
+    REQUIRE_THROWS_AS(MolConverter::ConvertOne(smiles[badIndex], options), std::runtime_error);
+    std::stringstream output;
+    auto report = MolConverter(options).convert(input, output);
+    REQUIRE(report.total == smiles.size());
+    REQUIRE(report.failures.size() == 1);
+    REQUIRE(report.failures[0].index == badIndex);
+    REQUIRE(report.failures[0].input == smiles[badIndex]);
+    REQUIRE(output.str() == expected);
+}
@@ -0,0 +1,88 @@
+#include <catch2/catch.hpp>
+#include "ckit/fingerprint_db.h"
+#include "ckit/mol.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static Fingerprint GetFingerprint(const std::string &_smiles, const FingerprintType &_type) {
+    GuiMol mol;
+    mol.readAs(_smiles, "smi");
+    return Fingerprint::FromGraph(*mol.getGraph(), _type);
+}
+
+TEST_CASE("fingerprints ignore how a molecule is written", "[fingerprint]") {
+    const std::vector<std::pair<std::string, std::string>> pairs = {
+            {"c1ccccc1",               "C1=CC=CC=C1"},
+            {"c1ccc2[nH]ccc2c1",       "C1=CC=C2C(=C1)C=CN2"},
+            {"CC(=O)Oc1ccccc1C(O)=O",  "OC(=O)C1=CC=CC=C1OC(C)=O"},
+            {"[CH3][OH]",              "CO"}};
+    for (auto type: {FingerprintType::Path, FingerprintType::Circular}) {
+        for (auto&[a, b]: pairs) {
+            const auto fa = GetFingerprint(a, type), fb = GetFingerprint(b, type);
+            CHECK(fa == fb);
+            CHECK(fa.getGraphHash() == fb.getGraphHash());
+        }
+        CHECK(GetFingerprint("CCO", type).getGraphHash() != GetFingerprint("COC", type).getGraphHash());
+        CHECK(Fingerprint::Tanimoto(GetFingerprint("c1ccccc1", type), GetFingerprint("Cc1ccccc1", type)) < 1);
+    }
+}
+
+TEST_CASE("fingerprint database finds drugbank molecules", "[fingerprint]") {
+    const std::string dbPath = "test_fingerprint.fpdb";
+    std::ifstream ifs(DEV_ASSETS_DIR + std::string("/datasets/drugbank.smi"));
+    REQUIRE(ifs.good());
+    const size_t count = FingerprintDB::Build(ifs, dbPath);
+    {
+        FingerprintDB db;
+        db.open(dbPath);
+        REQUIRE(db.size() == count);
+        REQUIRE(count > 10000);
+        for (size_t i = 0; i < db.size(); i += 97) {
+            GuiMol mol;
+            mol.readAs(std::string(db.getSmiles(i)), "smi");
+            auto graph = mol.getGraph();
+            const auto fp = Fingerprint::FromGraph(*graph, db.getType());
+            const auto exact = db.findExact(fp);
+            CHECK(std::find(exact.begin(), exact.end(), i) != exact.end());
+            const auto hits = db.search(fp, 5);
+            REQUIRE(hits.size() == 5);
+            CHECK(hits[0].similarity == 1.0f);
+            for (size_t k = 1; k < hits.size(); k++) {
+                CHECK(hits[k - 1].similarity >= hits[k].similarity);
+            }
+            // 精确匹配够数时不扫描全库
+            CHECK(db.search(*graph, 1)[0].similarity == 1.0f);
+        }
+    }
+    std::remove(dbPath.c_str());
+}
+
+TEST_CASE("fingerprint database benchmark", "[.][benchmark][fingerprint]") {
+    const std::string dbPath = "test_fingerprint_benchmark.fpdb";
+    std::ifstream ifs(DEV_ASSETS_DIR + std::string("/datasets/drugbank.smi"));
+    REQUIRE(ifs.good());
+    auto start = std::chrono::steady_clock::now();
+    const size_t count = FingerprintDB::Build(ifs, dbPath);
+    auto buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double searchMs = 0;
+    size_t queryNum = 0;
+    {
+        FingerprintDB db;
+        db.open(dbPath);
+        for (size_t i = 0; i < db.size(); i += 97, queryNum++) {
+            GuiMol mol;
+            mol.readAs(std::string(db.getSmiles(i)), "smi");
+            const auto fp = Fingerprint::FromGraph(*mol.getGraph(), db.getType());
+            start = std::chrono::steady_clock::now();
+            db.search(fp, 5);
+            searchMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+    std::remove(dbPath.c_str());
+    std::cout << count << " molecules: build " << buildMs << " ms, top-5 search "
+              << searchMs / queryNum << " ms/query" << std::endl;
+}
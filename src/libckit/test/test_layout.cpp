@@ -0,0 +1,26 @@
+#include <catch2/catch.hpp>
+#include "ckit/mol.h"
+
+TEST_CASE("hydrogen completion keeps the existing 2d layout", "[layout]") {
+    GuiMol mol;
+    mol.readAs("c1ccccc1C(=O)O", "smi");
+    mol.norm2D(400, 300);
+    auto before = mol.getGraph();
+    const size_t heavyNum = before->getAtomNum();
+    mol.addAllHydrogens();
+    mol.norm2D(400, 300);
+    auto after = mol.getGraph();
+    REQUIRE(after->getAtomNum() > heavyNum);
+    // norm2D 会整体缩放，旧原子之间的距离只差同一个倍数
+    auto distance = [](const MolGraph &_graph, const id_type &_aid1, const id_type &_aid2) {
+        return getDistance(_graph.getPos2D(_graph.getAtomIndex(_aid1)), _graph.getPos2D(_graph.getAtomIndex(_aid2)));
+    };
+    const id_type aid0 = before->getAtomId(0), aid1 = before->getAtomId(1);
+    const float k = distance(*after, aid0, aid1) / distance(*before, aid0, aid1);
+    for (MolGraph::index_type i = 0; i < heavyNum; i++) {
+        for (MolGraph::index_type j = i + 1; j < heavyNum; j++) {
+            const id_type aid = before->getAtomId(i), bid = before->getAtomId(j);
+            REQUIRE(distance(*after, aid, bid) == Approx(k * distance(*before, aid, bid)).margin(0.5));
+        }
+    }
+}
@@ -1,5 +1,376 @@
 #include <catch2/catch.hpp>
+#include "ckit/mol.h"
+#include "ckit/atom.h"
+#include "ckit/bond.h"
+#include "ckit/mol_util.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <tuple>
+#include <utility>
 
 TEST_CASE("mol", "hello, world") {
     REQUIRE(true);
-}
\ No newline at end of file
+}
+
+TEST_CASE("mol graph snapshot", "[mol_graph]") {
+    GuiMol mol;
+    std::vector<std::shared_ptr<Atom>> ring;
+    for (int i = 0; i < 6; i++) {
+        ring.push_back(mol.addAtom(ElementType::C, i, 2 * i));
+    }
+    for (int i = 0; i < 6; i++) {
+        mol.addBond(ring[i], ring[(i + 1) % 6]);
+    }
+    auto o = mol.addAtom(ElementType::O, 10, 10);
+    mol.addBond(ring[0], o, BondType::DoubleBond);
+    auto graph = mol.getGraph();
+    REQUIRE(graph->getAtomNum() == 7);
+    REQUIRE(graph->getBondNum() == 7);
+    auto c0 = graph->getAtomIndex(ring[0]->getId());
+    REQUIRE(graph->getDegree(c0) == 3);
+    REQUIRE(graph->getPos2D(graph->getAtomIndex(ring[3]->getId())) == point2f(3, 6));
+    auto bIdx = graph->findBond(graph->getAtomIndex(o->getId()), c0);
+    REQUIRE(bIdx != MolGraph::npos);
+    REQUIRE(graph->getBondType(bIdx) == BondType::DoubleBond);
+    REQUIRE(graph->findBond(c0, graph->getAtomIndex(ring[3]->getId())) == MolGraph::npos);
+    // 拓扑不变时复用快照
+    REQUIRE(mol.getGraph() == graph);
+    mol.addAtom(ElementType::N, 0, 0);
+    REQUIRE(mol.getGraph()->getAtomNum() == 8);
+}
+
+TEST_CASE("graph snapshot rereads records handed out for writing", "[mol_graph]") {
+    GuiMol mol;
+    auto c = mol.addAtom(ElementType::C, 0, 0), o = mol.addAtom(ElementType::O, 1, 0);
+    auto bond = mol.addBond(c, o);
+    auto graph = mol.getGraph();
+    const auto hash = graph->getTopologyHash();
+    const auto io = graph->getAtomIndex(o->getId());
+    mol.getAtom(o->getId())->setCharge(-1);
+    REQUIRE(mol.getGraph()->getCharge(io) == -1);
+    REQUIRE(mol.getGraph()->getTopologyHash() != hash);
+    // 已经交出去的快照保持原样
+    REQUIRE(graph->getCharge(io) == 0);
+    REQUIRE(graph->getTopologyHash() == hash);
+    mol.getBond(bond->getId())->setType(BondType::DoubleBond);
+    REQUIRE(mol.getGraph()->getBondType(0) == BondType::DoubleBond);
+    for (Atom &atom: mol.atoms()) { atom.x += 5; }
+    REQUIRE(mol.getGraph()->getPos2D(io).first == 6);
+    mol.loopAtomVec([](Atom &_atom) { _atom.setType(ElementType::N); });
+    REQUIRE(mol.getGraph()->getElement(io) == ElementType::N);
+    // 只读访问不让快照过期
+    auto latest = mol.getGraph();
+    std::as_const(mol).getAtom(o->getId());
+    REQUIRE(mol.getGraph() == latest);
+}
+
+TEST_CASE("mol snapshot shares records until written", "[mol_graph]") {
+    GuiMol mol;
+    auto c1 = mol.addAtom(ElementType::C, 0, 0);
+    auto c2 = mol.addAtom(ElementType::C, 1, 0);
+    mol.addBond(c1, c2);
+    auto snap = mol.snapshot();
+    snap->addAllHydrogens();
+    auto graph = mol.getGraph(), snapGraph = snap->getGraph();
+    REQUIRE(graph->getAtomNum() == 2);
+    REQUIRE(snapGraph->getAtomNum() == 8);
+    auto i1 = graph->getAtomIndex(c1->getId()), j1 = snapGraph->getAtomIndex(c1->getId());
+    // 加氢只新增记录，已有的原子仍然共享
+    REQUIRE(&graph->getAtom(i1) == &snapGraph->getAtom(j1));
+    // 只读访问不复制记录
+    const GuiMol &constSnap = *snap;
+    REQUIRE(constSnap.getAtom(c1->getId()) == c1);
+    size_t sharedNum = 0;
+    for (const Atom &atom: constSnap.atoms()) {
+        if (&atom == c1.get() || &atom == c2.get()) { ++sharedNum; }
+    }
+    REQUIRE(sharedNum == 2);
+    constSnap.loopBondVec([&](const Bond &_bond) { REQUIRE(_bond.getFrom()); });
+    REQUIRE(&snap->getGraph()->getAtom(j1) == c1.get());
+    // 拿到可写记录前复制出独占的一份，原分子不受影响
+    snap->getAtom(c1->getId())->setCharge(1);
+    REQUIRE(c1->getCharge() == 0);
+    REQUIRE(snap->getAtom(c1->getId()) != c1);
+}
+
+/**
+ * 按顺序新建原子和键，作为增量同步结果的参照
+ */
+static gui_mol makeMol(const std::vector<ElementType> &_elements,
+                       const std::vector<std::tuple<int, int, BondType>> &_bonds) {
+    auto mol = std::make_shared<GuiMol>();
+    std::vector<std::shared_ptr<Atom>> atoms;
+    for (auto &element: _elements) { atoms.push_back(mol->addAtom(element, 0, 0)); }
+    for (auto&[from, to, type]: _bonds) { mol->addBond(atoms[from], atoms[to], type); }
+    return mol;
+}
+
+TEST_CASE("incremental openbabel sync matches a fresh molecule", "[mol_sync]") {
+    using E = ElementType;
+    const auto single = BondType::SingleBond;
+    GuiMol mol;
+    auto c1 = mol.addAtom(E::C, 0, 0), c2 = mol.addAtom(E::C, 1, 0);
+    auto cc = mol.addBond(c1, c2);
+    REQUIRE(mol.writeAs("inchi") == makeMol({E::C, E::C}, {{0, 1, single}})->writeAs("inchi"));
+    // 已经同步过的 OBMol 上继续增删，只重放修改
+    auto o = mol.addAtom(E::O, 2, 0);
+    auto co = mol.addBond(c2, o);
+    const auto ethanol = makeMol({E::C, E::C, E::O}, {{0, 1, single}, {1, 2, single}})->writeAs("inchi");
+    REQUIRE(mol.writeAs("inchi") == ethanol);
+    auto clone = mol.deepClone();
+    REQUIRE(clone->writeAs("inchi") == ethanol);
+    mol.removeBond(co->getId());
+    mol.removeAtom(o->getId());
+    mol.tryMarkDoubleBond(cc->getId());
+    REQUIRE(mol.writeAs("inchi") == makeMol({E::C, E::C}, {{0, 1, BondType::DoubleBond}})->writeAs("inchi"));
+    REQUIRE(clone->writeAs("inchi") == ethanol);
+}
+
+TEST_CASE("export follows records edited in place", "[mol_sync]") {
+    using E = ElementType;
+    const auto s = BondType::SingleBond, d = BondType::DoubleBond;
+    auto mol = makeMol({E::C, E::C, E::O}, {{0, 1, s}, {1, 2, s}});
+    auto graph = mol->getGraph();
+    const auto oid = graph->getAtomId(2), coid = graph->getBondId(graph->findBond(1, 2));
+    REQUIRE(mol->writeAs("can") == "CCO");
+    REQUIRE(mol->writeAs("inchi") == makeMol({E::C, E::C, E::O}, {{0, 1, s}, {1, 2, s}})->writeAs("inchi"));
+    // 通过可写记录原位改电荷、键型，不经过任何 setter
+    mol->getAtom(oid)->setCharge(-1);
+    REQUIRE(mol->writeAs("can") == "CC[O-]");
+    mol->getAtom(oid)->setCharge(0);
+    mol->getBond(coid)->setType(d);
+    REQUIRE(mol->writeAs("can") == "CC=O");
+    REQUIRE(mol->writeAs("inchi") == makeMol({E::C, E::C, E::O}, {{0, 1, s}, {1, 2, d}})->writeAs("inchi"));
+}
+
+TEST_CASE("edit-then-export benchmark", "[.][benchmark][mol_sync]") {
+    GuiMol mol;
+    std::vector<std::shared_ptr<Atom>> chain;
+    for (int i = 0; i < 1000; i++) {
+        chain.push_back(mol.addAtom(ElementType::C, i, 0));
+        if (i > 0) { mol.addBond(chain[i - 1], chain[i]); }
+    }
+    mol.writeAs("inchi");
+    const int cycles = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < cycles; i++) {
+        auto atom = mol.addAtom(ElementType::O, 0, 1);
+        auto bond = mol.addBond(chain[i], atom);
+        mol.writeAs("inchi");
+        mol.removeBond(bond->getId());
+        mol.removeAtom(atom->getId());
+        mol.writeAs("inchi");
+    }
+    auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << cycles << " edit-export cycles on " << chain.size() << " atoms: "
+              << ms << " ms, " << ms / cycles << " ms/cycle" << std::endl;
+}
+
+TEST_CASE("export reuses cached geometry", "[mol_export]") {
+    REQUIRE(CoordRequirement::None == MolUtil::GetCoordRequirement("can"));
+    REQUIRE(CoordRequirement::Coord2D == MolUtil::GetCoordRequirement("mol"));
+    REQUIRE(CoordRequirement::Coord3D == MolUtil::GetCoordRequirement("xyz"));
+    using E = ElementType;
+    auto mol = makeMol({E::C, E::C, E::O}, {{0, 1, BondType::SingleBond}, {1, 2, BondType::SingleBond}});
+    const auto xyz = mol->writeAs("xyz", Coord3DQuality::Fast);
+    // 克隆共享几何缓存，拓扑相同时不重跑力场，坐标逐字相同
+    auto clone = mol->deepClone();
+    REQUIRE(clone->writeAs("xyz", Coord3DQuality::Fast) == xyz);
+    // 二维格式覆盖了 OBMol 坐标后，三维格式从缓存恢复
+    REQUIRE(mol->writeAs("mol").find("2D") != std::string::npos);
+    REQUIRE(mol->writeAs("xyz", Coord3DQuality::Fast) == xyz);
+}
+
+TEST_CASE("native smiles does not depend on atom order", "[smiles]") {
+    using E = ElementType;
+    const auto s = BondType::SingleBond, d = BondType::DoubleBond;
+    // 环己烯甲酸，两种编号顺序
+    auto m1 = makeMol({E::C, E::C, E::C, E::C, E::C, E::C, E::C, E::O, E::O},
+                      {{0, 1, d}, {1, 2, s}, {2, 3, s}, {3, 4, s}, {4, 5, s}, {5, 0, s}, {0, 6, s}, {6, 7, d}, {6, 8, s}});
+    auto m2 = makeMol({E::O, E::C, E::O, E::C, E::C, E::C, E::C, E::C, E::C},
+                      {{8, 7, s}, {1, 0, d}, {6, 5, s}, {4, 3, d}, {2, 1, s}, {3, 1, s}, {7, 6, s}, {5, 4, s}, {8, 3, s}});
+    m1->addAllHydrogens();
+    m2->addAllHydrogens();
+    const auto smiles = m1->writeAs("can");
+    REQUIRE(smiles == m2->writeAs("can"));
+    REQUIRE(std::string::npos == smiles.find('['));
+}
+
+TEST_CASE("native smiles adds implicit hydrogens to heavy-atom molecules", "[smiles]") {
+    using E = ElementType;
+    const auto s = BondType::SingleBond, d = BondType::DoubleBond;
+    REQUIRE(makeMol({E::C, E::C, E::O}, {{0, 1, s}, {1, 2, s}})->writeAs("can") == "CCO");
+    auto acid = makeMol({E::C, E::C, E::O, E::O}, {{0, 1, s}, {1, 2, d}, {1, 3, s}});
+    const auto smiles = acid->writeAs("can");
+    REQUIRE(std::string::npos == smiles.find('['));
+    // 和补上显式氢之后的写法一致
+    acid->addAllHydrogens();
+    REQUIRE(acid->writeAs("can") == smiles);
+}
+
+TEST_CASE("native smiles reads wedge bonds as tetrahedral stereo", "[smiles]") {
+    auto make = [](const BondType &_wedge) {
+        GuiMol mol;
+        auto c = mol.addAtom(ElementType::C, 0, 0);
+        mol.addBond(c, mol.addAtom(ElementType::F, 0, -1), _wedge);
+        mol.addBond(c, mol.addAtom(ElementType::Cl, 0.87f, 0.5f));
+        mol.addBond(c, mol.addAtom(ElementType::Br, -0.87f, 0.5f));
+        mol.addBond(c, mol.addAtom(ElementType::H, 0, 1));
+        return mol.writeAs("can");
+    };
+    const auto up = make(BondType::SolidWedgeBond), down = make(BondType::DashWedgeBond);
+    REQUIRE(std::string::npos != up.find('@'));
+    REQUIRE(std::string::npos != down.find('@'));
+    REQUIRE(up != down);
+    REQUIRE(std::string::npos == make(BondType::SingleBond).find('@'));
+}
+
+TEST_CASE("native smiles round-trips drugbank through openbabel", "[smiles]") {
+    std::ifstream ifs(DEV_ASSETS_DIR + std::string("/datasets/drugbank.smi"));
+    REQUIRE(ifs.good());
+    // 原分子没有二维坐标，原生写法里没有立体信息，只比较 InChI 的连接、氢和电荷层
+    auto strip_stereo = [](const std::string &_inchi) {
+        std::string result;
+        size_t begin = 0;
+        while (begin < _inchi.size()) {
+            size_t end = _inchi.find_first_of("/\r\n", begin + 1);
+            if (std::string::npos == end) { end = _inchi.size(); }
+            const auto layer = _inchi.substr(begin, end - begin);
+            if (layer.size() < 2 || '/' != layer[0] || std::string("btms").find(layer[1]) == std::string::npos) {
+                result += layer;
+            }
+            begin = end;
+        }
+        return result;
+    };
+    std::string line;
+    while (std::getline(ifs, line)) {
+        auto smiles = line.substr(0, line.find_first_of(" \t\r"));
+        if (smiles.empty()) { continue; }
+        GuiMol mol;
+        mol.readAs(smiles, "smi");
+        mol.addAllHydrogens();
+        const auto native = mol.writeAs("can");
+        // OpenBabel 读回的是同一个分子：丢掉电荷、键级或闭环都会改变 InChI
+        GuiMol mol2;
+        mol2.readAs(native, "smi");
+        CHECK(strip_stereo(mol2.writeAs("inchi")) == strip_stereo(mol.writeAs("inchi")));
+    }
+}
+
+TEST_CASE("super atom labels expand to the molecule they abbreviate", "[expand]") {
+    using E = ElementType;
+    const auto s = BondType::SingleBond, d = BondType::DoubleBond, t = BondType::TripleBond;
+    auto expand = [](const std::string &_label) {
+        GuiMol mol;
+        auto c = mol.addAtom(E::C, 0, 0);
+        auto sa = mol.addSuperAtom(_label, 1, 0, 2, 1);
+        sa->setIsLeftToRight(true);
+        mol.addBond(c, sa);
+        REQUIRE(mol.tryExpand());
+        mol.addAllHydrogens();
+        return mol.writeAs("can");
+    };
+    auto reference = [](const std::vector<ElementType> &_elements,
+                        const std::vector<std::tuple<int, int, BondType>> &_bonds) {
+        auto mol = makeMol(_elements, _bonds);
+        mol->addAllHydrogens();
+        return mol->writeAs("can");
+    };
+    const auto propane = reference({E::C, E::C, E::C}, {{0, 1, s}, {1, 2, s}});
+    // 最长匹配：C2H5 是一个缩写，不拆成 C、2、H、5
+    REQUIRE(expand("C2H5") == propane);
+    REQUIRE(expand("Et") == propane);
+    REQUIRE(expand("CH2CH3") == propane);
+    REQUIRE(expand("COOEt") == reference({E::C, E::C, E::O, E::O, E::C, E::C},
+                                         {{0, 1, s}, {1, 2, d}, {1, 3, s}, {3, 4, s}, {4, 5, s}}));
+    REQUIRE(expand("tBu") == reference({E::C, E::C, E::C, E::C, E::C},
+                                       {{0, 1, s}, {1, 2, s}, {1, 3, s}, {1, 4, s}}));
+    REQUIRE(expand("SCN") == reference({E::C, E::S, E::C, E::N}, {{0, 1, s}, {1, 2, s}, {2, 3, t}}));
+    // 苄基从亚甲基接入
+    REQUIRE(expand("Bn") == reference({E::C, E::C, E::C, E::C, E::C, E::C, E::C, E::C},
+                                      {{0, 1, s}, {1, 2, s}, {2, 3, d}, {3, 4, s}, {4, 5, d}, {5, 6, s},
+                                       {6, 7, d}, {7, 2, s}}));
+}
+
+TEST_CASE("implicit hydrogen counts match bulk hydrogen completion", "[hydrogen]") {
+    using E = ElementType;
+    GuiMol mol;
+    auto c1 = mol.addAtom(E::C, 0, 0), c2 = mol.addAtom(E::C, 1, 0);
+    auto o1 = mol.addAtom(E::O, 2, 0), o2 = mol.addAtom(E::O, 2, 1), n = mol.addAtom(E::N, -1, 0);
+    o2->setCharge(-1);
+    n->setCharge(1);
+    mol.addBond(c1, c2);
+    mol.addBond(c2, o1, BondType::DoubleBond);
+    mol.addBond(c2, o2);
+    mol.addBond(c1, n);
+    auto graph = mol.getGraph();
+    std::vector<int> numHs;
+    MolUtil::GetHydrogenNums(*graph, numHs);
+    REQUIRE(numHs[graph->getAtomIndex(c1->getId())] == 2);
+    REQUIRE(numHs[graph->getAtomIndex(c2->getId())] == 0);
+    REQUIRE(numHs[graph->getAtomIndex(o2->getId())] == 0);
+    // 铵正离子
+    REQUIRE(numHs[graph->getAtomIndex(n->getId())] == 3);
+    const auto heavy = mol.writeAs("inchi");
+    mol.addAllHydrogens();
+    REQUIRE(mol.getGraph()->getAtomNum() == 5 + 5);
+    REQUIRE(mol.getGraph()->getBondNum() == 4 + 5);
+    MolUtil::GetHydrogenNums(*mol.getGraph(), numHs);
+    REQUIRE(std::all_of(numHs.begin(), numHs.end(), [](const int &_num) { return 0 == _num; }));
+    // 已经同步过的 OBMol 只重放新加的氢，结果和重建一致
+    REQUIRE(mol.writeAs("inchi") == mol.deepClone()->writeAs("inchi"));
+    REQUIRE(mol.writeAs("inchi") != heavy);
+}
+
+TEST_CASE("range iteration visits atoms in id order", "[mol_graph]") {
+    GuiMol mol;
+    std::vector<std::shared_ptr<Atom>> chain;
+    for (int i = 0; i < 8; i++) {
+        chain.push_back(mol.addAtom(ElementType::C, i, 0));
+        if (i > 0) { mol.addBond(chain[i - 1], chain[i]); }
+    }
+    mol.removeAtom(chain[3]->getId());
+    std::vector<id_type> aids;
+    for (Atom &atom: mol.atoms()) {
+        aids.push_back(atom.getId());
+        atom.x = 10;
+    }
+    REQUIRE(aids.size() == 7);
+    REQUIRE(std::is_sorted(aids.begin(), aids.end()));
+    size_t bondNum = 0;
+    mol.forEachBond([&](Bond &_bond) { ++bondNum; });
+    REQUIRE(bondNum == 5);
+    // 改写的就是分子自己的记录
+    mol.forEachAtomParallel([](Atom &_atom) { _atom.x += 1; });
+    mol.loopAtomVec([](Atom &_atom) { REQUIRE(_atom.x == 11); });
+}
+
+TEST_CASE("atom iteration benchmark", "[.][benchmark][mol_graph]") {
+    GuiMol mol;
+    std::shared_ptr<Atom> last;
+    for (int i = 0; i < 100000; i++) {
+        auto atom = mol.addAtom(ElementType::C, i, 0);
+        if (last) { mol.addBond(last, atom); }
+        last = atom;
+    }
+    // 只测坐标变换，不跑 coordgen
+    mol.set2DInfoLatest(true);
+    mol.atoms();
+    const int cycles = 100;
+    auto bench = [&](const std::string &_name, const std::function<void()> &_func) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < cycles; i++) { _func(); }
+        auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << _name << ": " << ms / cycles << " ms/pass" << std::endl;
+    };
+    bench("loopAtomVec", [&]() { mol.loopAtomVec([](Atom &_atom) { _atom.x = _atom.x * 0.5f + 1; }); });
+    bench("atoms()", [&]() { for (Atom &atom: mol.atoms()) { atom.x = atom.x * 0.5f + 1; }});
+    bench("forEachAtom", [&]() { mol.forEachAtom([](Atom &_atom) { _atom.x = _atom.x * 0.5f + 1; }); });
+    bench("forEachAtomParallel", [&]() {
+        mol.forEachAtomParallel([](Atom &_atom) { _atom.x = _atom.x * 0.5f + 1; });
+    });
+    bench("norm2D", [&]() { mol.norm2D(1000, 1000, 10, 10); });
+}
@@ -0,0 +1,44 @@
+#include <catch2/catch.hpp>
+#include "ckit/mol.h"
+#include "ckit/ring_finder.h"
+#include <algorithm>
+#include <fstream>
+
+static std::vector<size_t> GetRingSizes(const std::vector<std::vector<id_type>> &_rings) {
+    std::vector<size_t> sizes;
+    for (auto &ring: _rings) { sizes.push_back(ring.size()); }
+    std::sort(sizes.begin(), sizes.end());
+    return sizes;
+}
+
+TEST_CASE("relevant cycles of cubane", "[ring]") {
+    GuiMol mol;
+    mol.readAs("C12C3C4C1C5C2C3C45", "smi");
+    RingFinder finder;
+    auto graph = mol.getGraph();
+    REQUIRE(finder.findSSSR(*graph).size() == 5);
+    // 六个四元环都在某个最小环基里
+    auto &rings = finder.findRelevantCycles(*graph);
+    REQUIRE(rings.size() == 6);
+    for (size_t i = 0; i < rings.size(); i++) {
+        auto ring = rings[i];
+        REQUIRE(ring.size() == 4);
+        for (size_t k = 0; k < ring.size(); k++) {
+            REQUIRE(MolGraph::npos != graph->findBond(ring[k], ring[(k + 1) % ring.size()]));
+        }
+    }
+}
+
+TEST_CASE("native sssr matches openbabel on drugbank", "[ring]") {
+    std::ifstream ifs(DEV_ASSETS_DIR + std::string("/datasets/drugbank.smi"));
+    REQUIRE(ifs.good());
+    std::string line;
+    while (std::getline(ifs, line)) {
+        auto smiles = line.substr(0, line.find_first_of(" \t\r"));
+        if (smiles.empty()) { continue; }
+        GuiMol mol;
+        mol.readAs(smiles, "smi");
+        // 最小环基不唯一，但环长的多重集是唯一的
+        CHECK(GetRingSizes(mol.getSSSR()) == GetRingSizes(mol.getOpenBabelSSSR()));
+    }
+}
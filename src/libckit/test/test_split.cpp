@@ -0,0 +1,35 @@
+#include <catch2/catch.hpp>
+#include "ckit/mol.h"
+#include "ckit/atom.h"
+
+TEST_CASE("split separates salts and reaction components", "[split]") {
+    GuiMol mol;
+    mol.readAs("CC(=O)[O-].[Na+].c1ccccc1O", "smi");
+    auto fragments = mol.split();
+    REQUIRE(fragments.size() == 3);
+    REQUIRE(fragments[0]->getGraph()->getAtomNum() == 4);
+    REQUIRE(fragments[0]->getGraph()->getBondNum() == 3);
+    REQUIRE(fragments[1]->writeAs("can") == "[Na+]");
+    REQUIRE(fragments[2]->getGraph()->getAtomNum() == 7);
+    REQUIRE(fragments[2]->getGraph()->getBondNum() == 7);
+    // 片段保留原来的 id
+    REQUIRE(fragments[1]->getGraph()->getAtomId(0) == mol.getGraph()->getAtomId(4));
+}
+
+TEST_CASE("split skips bonds left dangling by removed atoms", "[split]") {
+    GuiMol mol;
+    std::vector<std::shared_ptr<Atom>> chain;
+    for (int i = 0; i < 5; i++) {
+        chain.push_back(mol.addAtom(ElementType::C, i, 0));
+        if (i > 0) { mol.addBond(chain[i - 1], chain[i]); }
+    }
+    // 只删原子不删键，包括 id 最大的那个
+    mol.removeAtom(chain[4]->getId());
+    mol.removeAtom(chain[2]->getId());
+    auto fragments = mol.split();
+    REQUIRE(fragments.size() == 2);
+    REQUIRE(fragments[0]->getGraph()->getAtomNum() == 2);
+    REQUIRE(fragments[0]->getGraph()->getBondNum() == 1);
+    REQUIRE(fragments[1]->getGraph()->getAtomNum() == 1);
+    REQUIRE(fragments[1]->getGraph()->getBondNum() == 0);
+}
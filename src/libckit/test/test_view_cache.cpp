@@ -0,0 +1,77 @@
+#include <catch2/catch.hpp>
+#include "ckit/mol_view_cache.h"
+#include "ckit/mol.h"
+#include "ckit/atom.h"
+
+TEST_CASE("derived views are cached per drawing", "[view_cache]") {
+    MolViewCache cache;
+    // 同一个乙醇，原子顺序和位置都不同的两种画法
+    auto draw = [](const bool &_reversed, const float &_dx) {
+        auto mol = std::make_shared<GuiMol>();
+        std::vector<std::shared_ptr<Atom>> atoms(3);
+        const ElementType elements[] = {ElementType::C, ElementType::C, ElementType::O};
+        for (int k = 0; k < 3; k++) {
+            const int i = _reversed ? 2 - k : k;
+            atoms[i] = mol->addAtom(elements[i], _dx + i, 0);
+        }
+        mol->addBond(atoms[0], atoms[1]);
+        mol->addBond(atoms[1], atoms[2]);
+        return mol;
+    };
+    auto a = draw(false, 0), b = draw(true, 10);
+    REQUIRE(MolViewCache::GetCanonicalKey(*a) == MolViewCache::GetCanonicalKey(*b));
+    REQUIRE(MolViewCache::GetKey(*a) != MolViewCache::GetKey(*b));
+    // 视图里输入的原子保留 id、元素和坐标
+    auto check_view = [](GuiMol &_input, GuiMol &_view) {
+        auto input = _input.getGraph(), view = _view.getGraph();
+        REQUIRE(view->getAtomNum() == 9);
+        for (MolGraph::index_type i = 0; i < input->getAtomNum(); i++) {
+            const auto j = view->getAtomIndex(input->getAtomId(i));
+            REQUIRE(MolGraph::npos != j);
+            REQUIRE(view->getElement(j) == input->getElement(i));
+            REQUIRE(view->getPos2D(j) == input->getPos2D(i));
+        }
+    };
+    auto viewA = cache.get(a, MolViewType::FullHydrogen), viewB = cache.get(b, MolViewType::FullHydrogen);
+    check_view(*a, *viewA);
+    check_view(*b, *viewB);
+    REQUIRE(cache.getStats().missNum == 2);
+    // 同一画法的副本命中缓存，拿到的是另一份快照
+    auto again = cache.get(a->deepClone(), MolViewType::FullHydrogen);
+    REQUIRE(again != viewA);
+    check_view(*a, *again);
+    auto stats = cache.getStats();
+    REQUIRE(stats.hitNum == 1);
+    REQUIRE(stats.bytes > 0);
+    // 改写取出的快照只复制它自己的记录，缓存里的视图不变
+    const auto aid = a->getGraph()->getAtomId(0);
+    again->getAtom(aid)->setCharge(1);
+    REQUIRE(again->getGraph()->getCharge(again->getGraph()->getAtomIndex(aid)) == 1);
+    auto fresh = cache.get(a, MolViewType::FullHydrogen);
+    REQUIRE(fresh->getGraph()->getCharge(fresh->getGraph()->getAtomIndex(aid)) == 0);
+    cache.invalidate(*a);
+    cache.invalidate(*b);
+    REQUIRE(cache.getStats().bytes == 0);
+    cache.setCapacity(1);
+    cache.get(a, MolViewType::Expanded);
+    cache.get(b, MolViewType::Expanded);
+    REQUIRE(cache.getStats().entryNum == 1);
+    REQUIRE(cache.getStats().evictionNum == 1);
+}
+
+TEST_CASE("view cache keys keep super atom labels in place", "[view_cache]") {
+    // [At]C(=O)N[At]：甲基在羰基上、乙基在氮上，和反过来是两个分子
+    auto draw = [](const std::string &_acyl, const std::string &_amine) {
+        auto mol = std::make_shared<GuiMol>();
+        auto c = mol->addAtom(ElementType::C, 0, 0), o = mol->addAtom(ElementType::O, 0, 1);
+        auto n = mol->addAtom(ElementType::N, 1, 0);
+        mol->addBond(c, o, BondType::DoubleBond);
+        mol->addBond(c, n);
+        mol->addBond(c, mol->addSuperAtom(_acyl, -1, 0, -1, 0));
+        mol->addBond(n, mol->addSuperAtom(_amine, 2, 0, 2, 0));
+        return mol;
+    };
+    auto a = draw("Me", "Et"), b = draw("Et", "Me");
+    REQUIRE(MolViewCache::GetCanonicalKey(*a) != MolViewCache::GetCanonicalKey(*b));
+    REQUIRE(MolViewCache::GetKey(*a) != MolViewCache::GetKey(*b));
+}
@@ -4,10 +4,19 @@
 
 #include "ckit/mol.h"
 #include "cocr/ocr_item.h"
+#include "cocr/ocr_item_table.h"
 #include <utility>
 #include <vector>
 
 class ELS_COCR_EXPORT GraphComposer {
+    bool isSpatialIndexEnabled = true;
 public:
+    /**
+     * 关闭后键端候选改为逐对比较，结果应与开启时完全一致，用于校验空间索引
+     */
+    void setSpatialIndexEnabled(const bool &_enabled);
+
+    std::shared_ptr<GuiMol> compose(const OCRItemTable &_items);
+
     std::shared_ptr<GuiMol> compose(const std::vector<OCRItem> &_items);
 };
\ No newline at end of file
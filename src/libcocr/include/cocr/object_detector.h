@@ -28,6 +28,9 @@ protected:
     ObjectDetector();
 
 public:
+    // 检测器输入长边的默认上限，图像解码时可据此提前降采样
+    inline static const int DEFAULT_MAX_SIDE = 1280;
+
     virtual void freeModel() = 0;
 
     virtual std::pair<Mat, std::vector<DetectorObject>> detect(const Mat &_originImage) = 0;
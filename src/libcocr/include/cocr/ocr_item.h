@@ -23,6 +23,11 @@ public:
 
     void setAsLineBond(const BondType &_bt, const rectf &_rect, const Mat &_input);
 
+    /**
+     * 端点已知时直接构造，不需要原图，用于合成数据和测试
+     */
+    void setAsLineBond(const BondType &_bt, const point2f &_from, const point2f &_to);
+
     void setAsCircleBond(const rectf &_rect);
 
     void setAsText(std::string &_text, const rectf &_rect);
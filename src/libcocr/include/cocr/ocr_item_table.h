@@ -0,0 +1,74 @@
+#pragma once
+
+#include "els_cocr_export.h"
+#include "cocr/ocr_item.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+/**
+ * 一页识别结果的列式存储：每个字段一个数组，整页只需几次分配
+ * 字串按内容驻留，相同的字串只存一份
+ * 各 getter 的语义与 OCRItem 的同名方法一致
+ */
+class ELS_COCR_EXPORT OCRItemTable {
+    std::vector<OCRItemType> types;
+    std::vector<rectf> rects;
+    std::vector<point2f> froms, tos;
+    std::vector<BondType> bondTypes;
+    std::vector<ElementType> elements;
+    std::vector<uint32_t> textIds;
+    std::vector<std::string> texts;
+    std::unordered_map<std::string, uint32_t> textIndex;
+    inline static const uint32_t sNoText = UINT32_MAX;
+
+    size_t push(const OCRItemType &_type, const rectf &_rect);
+
+    uint32_t intern(const std::string &_text);
+
+public:
+    void reserve(const size_t &_n);
+
+    void clear();
+
+    size_t size() const;
+
+    bool empty() const;
+
+    /**
+     * 从原图预测键的起止点
+     */
+    size_t addLineBond(const BondType &_bt, const rectf &_rect, const Mat &_input);
+
+    size_t addLineBond(const BondType &_bt, const point2f &_from, const point2f &_to);
+
+    size_t addCircleBond(const rectf &_rect);
+
+    /**
+     * 能识别为元素的按元素处理，否则按字串处理
+     */
+    size_t addText(const std::string &_text, const rectf &_rect);
+
+    const OCRItemType &getType(const size_t &_i) const;
+
+    const rectf &getRect(const size_t &_i) const;
+
+    const point2f &getFrom(const size_t &_i) const;
+
+    const point2f &getTo(const size_t &_i) const;
+
+    BondType getBondType(const size_t &_i) const;
+
+    ElementType getElement(const size_t &_i) const;
+
+    float getRadius(const size_t &_i) const;
+
+    point2f getCenter(const size_t &_i) const;
+
+    std::string_view getText(const size_t &_i) const;
+
+    static OCRItemTable FromItems(const std::vector<OCRItem> &_items);
+};
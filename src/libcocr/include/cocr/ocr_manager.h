@@ -2,22 +2,45 @@
 
 #include "els_cocr_export.h"
 #include "ocv/mat.h"
+#include "ocv/mat_arena.h"
 #include "cocr/text_corrector.h"
 #include "cocr/object_detector.h"
 #include "cocr/text_recognizer.h"
 #include "cocr/graph_composer.h"
 
+#include <optional>
+
+/**
+ * 单次识别各阶段耗时（毫秒）
+ */
+struct OCRStageStats {
+    float deskewMs = 0, detectMs = 0, convertMs = 0, composeMs = 0;
+    // 估计出的倾斜角，以及是否真的做了旋转
+    float skewAngle = 0;
+    bool deskewed = false;
+};
+
 class ELS_COCR_EXPORT OCRManager {
     Mat image;
+    // 识别过程中的中间图像都从这里分配，每次 ocr 结束后整体回绕
+    MatArena arena;
+    OCRStageStats stats;
+    bool isDeskewEnabled;
+    float deskewThresh;
     inline static const int MAX_WIDTH = 960;
     TextRecognizer &recognizer;
     ObjectDetector &detector;
     GraphComposer &composer;
     TextCorrector &corrector;
 
-    void display(const std::vector<OCRItem> &_items, const Mat &_input);
+    void display(const OCRItemTable &_items, const Mat &_input);
+
+    OCRItemTable convert(const std::vector<DetectorObject> &_objects, const Mat &_input);
 
-    std::vector<OCRItem> convert(const std::vector<DetectorObject> &_objects, const Mat &_input);
+    /**
+     * @return 不需要摆正时为空
+     */
+    std::optional<Mat> deskew(const Mat &_input);
 
 public:
     OCRManager(ObjectDetector &_detector, TextRecognizer &_recognizer, TextCorrector &_corrector,
@@ -27,6 +50,13 @@ public:
 
     Mat &getImage();
 
+    /**
+     * 识别前摆正图像，倾斜角绝对值超过 _thresh 度才旋转
+     */
+    void setDeskewEnabled(bool _enabled, const float &_thresh = 0.5);
+
+    const OCRStageStats &getLastStats() const;
+
     void setImage(const QList<QList<QPointF>> &_script, const int &screenWidth);
 
     void setImage(const QImage &_image);
@@ -1,20 +1,32 @@
 #include "cocr/graph_composer.h"
 #include "ckit/atom.h"
 #include "ckit/bond.h"
-#include "base/std_util.h" // pair_hash
-#include <map>
+#include "ckit/ring_finder.h"
+#include "spatial_grid.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
 #include <stdexcept>
 
+void GraphComposer::setSpatialIndexEnabled(const bool &_enabled) {
+    isSpatialIndexEnabled = _enabled;
+}
+
 std::shared_ptr<GuiMol> GraphComposer::compose(const std::vector<OCRItem> &_items) {
+    return compose(OCRItemTable::FromItems(_items));
+}
+
+std::shared_ptr<GuiMol> GraphComposer::compose(const OCRItemTable &_items) {
 //    ComposerHelper helper;
 //    return helper.compose(_items);
     // FIXME: this is just a simple impl
     // TODO: make better solution in ComposerHelper later
-    // call sub index in _items as oldId
+    // call row index in _items as oldId
     // <oldId> for atom, line bond, circle and grouped string
     std::vector<size_t> aIds, bIds, cIds, gIds;
-    // <bondSideId=oldId+<0,1>+_items.size, bondId=oldId> for bond side points
-    std::unordered_map<size_t, size_t> bSidesMap;
+    // 键端 id 落在 [2*size, 4*size)，所有按 id 索引的表都是长度为 idNum 的平坦数组
+    const size_t idNum = 4 * _items.size();
+    static const size_t sNullId = std::numeric_limits<size_t>::max();
     // cast bond id to a new id for bond-from-side id
     auto cast_side1 = [&](const size_t &_bid) -> size_t { return 2 * (_bid + _items.size()); };
     // cast bond id to a new id for bond-to-side id
@@ -31,32 +43,11 @@ std::shared_ptr<GuiMol> GraphComposer::compose(const std::vector<OCRItem> &_item
         if (_id < _items.size()) { return 2; }
         return _id % 2 != 0;
     };
-    // <oldId1,oldId2> means id1 and id2 are impossible to be together
-    // notice that we need to insert both {id1,id2} and {id2,id1}
-    // e.g. call add_black_list0633, 0022)
-    std::unordered_set<std::pair<size_t, size_t>, pair_hash> blackList;
-    auto kill_common = [&](const size_t &_i1, const size_t &_i2) {
-        blackList.insert({_i1, _i2});
-        blackList.insert({_i2, _i1});
-    };
-    auto is_valid_pair = [&](const size_t &_i1, const size_t &_i2) {
-        return blackList.end() == blackList.find({_i1, _i2});
-    };
     // 统计键长
-    std::unordered_map<size_t, float> bLength;
-    auto init_bond_side = [&](const size_t &_bid) {
-        size_t from = cast_side1(_bid), to = cast_side2(_bid);
-        bSidesMap[from] = _bid;
-        bSidesMap[to] = _bid;
-        // from and to in one bond can't be connected
-        kill_common(from, to);
-        kill_common(from, _bid);
-        kill_common(_bid, to);
-        bLength[_bid] = getDistance(_items[_bid].getFrom(), _items[_bid].getTo());
-    };
+    std::vector<float> bLength(_items.size(), 0);
     // 收集id、计算键长
     for (size_t i = 0; i < _items.size(); i++) {
-        switch (_items[i].type) {
+        switch (_items.getType(i)) {
             case OCRItemType::Element:
                 aIds.push_back(i);
                 break;
@@ -65,7 +56,7 @@ std::shared_ptr<GuiMol> GraphComposer::compose(const std::vector<OCRItem> &_item
                 break;
             case OCRItemType::Line: {
                 bIds.push_back(i);
-                init_bond_side(i);
+                bLength[i] = getDistance(_items.getFrom(i), _items.getTo(i));
                 break;
             }
             case OCRItemType::Circle:
@@ -75,22 +66,17 @@ std::shared_ptr<GuiMol> GraphComposer::compose(const std::vector<OCRItem> &_item
                 throw std::runtime_error("unhandled OCRItemType in GraphComposer::compose");
         }
     }
-    // < <oldId1,{<oldId2, normed distance k>, ...}
+    // 候选关系先按出现顺序记成边表，打分结束后再按 id 分桶成 CSR
+    // 每个桶内的顺序与逐个 push_back 到 vector 的顺序相同
     using feat_type = std::pair<size_t, float>;
-    std::map<size_t, std::vector<feat_type>> feats;
+    struct FeatEdge {
+        size_t id1, id2;
+        float feat;
+    };
+    std::vector<FeatEdge> featEdges;
+    featEdges.reserve(4 * _items.size());
     auto add_feat = [&](const size_t &_id1, const size_t &_id2, const float &_feat) {
-        auto it1 = feats.find(_id1);
-        if (feats.end() == it1) {
-            feats[_id1] = {{_id2, _feat}};
-        } else {
-            it1->second.emplace_back(_id2, _feat);
-        }
-        auto it2 = feats.find(_id2);
-        if (feats.end() == it2) {
-            feats[_id2] = {{_id1, _feat}};
-        } else {
-            it2->second.emplace_back(_id1, _feat);
-        }
+        featEdges.push_back({_id1, _id2, _feat});
     };
     auto calc_pts_to_rect = [](const point2f &_p, const rectf &_r) -> float {
         const auto&[r0, r1]=_r;
@@ -104,242 +90,163 @@ std::shared_ptr<GuiMol> GraphComposer::compose(const std::vector<OCRItem> &_item
     static const float sAtomBondThresh = 0.5;
     static const float sGroupBondThresh = 0.5;
     static const float sBSideBSideThresh = 0.5;
-    auto kill_atom_bond = [&](const size_t &_aid, const size_t &_bid) {
-        kill_common(_aid, _bid);
-        kill_common(_aid, cast_side1(_bid));
-        kill_common(_aid, cast_side2(_bid));
+    // 键端空间索引：以键端为中心、半边长为 阈值*键长 的方框登记到均匀网格，格子边长取键长中位数
+    // 索引只负责筛掉远处的图元对，候选对的判据和逐对比较完全一致
+    SpatialGrid bSideGrid;
+    auto expand_rect = [](const rectf &_r, const float &_margin) -> rectf {
+        const auto&[r0, r1]=_r;
+        return {{r0.first - _margin, r0.second - _margin}, {r1.first + _margin, r1.second + _margin}};
     };
-    // 统计元素边框和键端的距离
-    for (auto &aid: aIds) {
-        auto &ocrAtomItem = _items[aid];
-        auto &rect = ocrAtomItem.getRect();
-        for (auto &bid: bIds) {
-//            if (!is_valid_pair(aid, bid)) { continue; }
-            auto &ocrBondItem = _items[bid];
-            auto &from = ocrBondItem.getFrom();
-            auto &to = ocrBondItem.getTo();
-            const auto&[p0, p1]=rect;
-            float length = (std::max)(p1.second - p0.second, bLength[bid]);
-            float d1 = calc_pts_to_rect(from, rect) / length;
-            float d2 = calc_pts_to_rect(to, rect) / length;
-            if (d1 > sAtomBondThresh && d2 > sAtomBondThresh) {
-                kill_atom_bond(aid, bid);
-                continue;
-            }
-            if (d1 < d2) {
-                add_feat(aid, cast_side1(bid), d1);
-//                feats.insert({{aid, cast_side1(bid)}, d1});
-                kill_common(aid, cast_side2(bid));
-            } else {
-                add_feat(aid, cast_side2(bid), d2);
-//                feats.insert({{aid, cast_side2(bid)}, d2});
-                kill_common(aid, cast_side1(bid));
-            }
+    // 留一点余量，避免浮点误差让临界的候选被网格漏掉
+    auto safe_margin = [](const float &_margin) -> float { return _margin * 1.001f + 1e-3f; };
+    const float maxThresh = (std::max)(sAtomBondThresh, (std::max)(sGroupBondThresh, sBSideBSideThresh));
+    auto get_side_margin = [&](const size_t &_bid) -> float {
+        return safe_margin(maxThresh * (std::max)(0.01f, bLength[_bid]));
+    };
+    if (isSpatialIndexEnabled && !bIds.empty()) {
+        std::vector<float> lengths;
+        lengths.reserve(bIds.size());
+        bSideGrid.reserve(2 * bIds.size());
+        for (size_t k = 0; k < bIds.size(); k++) {
+            const size_t &bid = bIds[k];
+            float margin = get_side_margin(bid);
+            bSideGrid.insert(k, expand_rect({_items.getFrom(bid), _items.getFrom(bid)}, margin));
+            bSideGrid.insert(k, expand_rect({_items.getTo(bid), _items.getTo(bid)}, margin));
+            lengths.push_back(bLength[bid]);
         }
+        std::nth_element(lengths.begin(), lengths.begin() + lengths.size() / 2, lengths.end());
+        bSideGrid.build(lengths[lengths.size() / 2], bIds.size());
     }
-    // 统计字符串边框和键端的距离
-    for (auto &gid: gIds) {
-        auto &ocrGroupItem = _items[gid];
-        auto &rect = ocrGroupItem.getRect();
-        for (auto &bid: bIds) {
-//            if (!is_valid_pair(aid, bid)) { continue; }
-            auto &ocrBondItem = _items[bid];
-            auto &from = ocrBondItem.getFrom();
-            auto &to = ocrBondItem.getTo();
-            const auto&[p0, p1]=rect;
+    // 与网格查询一样返回升序的键下标，关闭索引时返回全部
+    auto query_sides = [&](const rectf &_box, std::vector<size_t> &_out) {
+        if (isSpatialIndexEnabled) {
+            bSideGrid.query(_box, _out);
+        } else {
+            _out.resize(bIds.size());
+            std::iota(_out.begin(), _out.end(), 0);
+        }
+    };
+    std::vector<size_t> candidates, candidates2;
+    // 统计元素、字符串边框和键端的距离，只保留较近的一端
+    auto add_box_bond_feats = [&](const size_t &_boxId, const float &_thresh) {
+        auto &rect = _items.getRect(_boxId);
+        const auto&[p0, p1]=rect;
+        query_sides(expand_rect(rect, safe_margin(_thresh * (p1.second - p0.second))), candidates);
+        for (auto &k: candidates) {
+            auto &bid = bIds[k];
             float length = (std::max)(p1.second - p0.second, bLength[bid]);
-            float d1 = calc_pts_to_rect(from, rect) / length;
-            float d2 = calc_pts_to_rect(to, rect) / length;
-            if (d1 > sGroupBondThresh && d2 > sGroupBondThresh) {
-                kill_atom_bond(gid, bid);
+            float d1 = calc_pts_to_rect(_items.getFrom(bid), rect) / length;
+            float d2 = calc_pts_to_rect(_items.getTo(bid), rect) / length;
+            if (d1 > _thresh && d2 > _thresh) {
                 continue;
             }
             if (d1 < d2) {
-                add_feat(gid, cast_side1(bid), d1);
-//                feats.insert({{gid, cast_side1(bid)}, d1});
-                kill_common(gid, cast_side2(bid));
+                add_feat(_boxId, cast_side1(bid), d1);
             } else {
-                add_feat(gid, cast_side2(bid), d2);
-//                feats.insert({{gid, cast_side2(bid)}, d2});
-                kill_common(gid, cast_side1(bid));
+                add_feat(_boxId, cast_side2(bid), d2);
             }
         }
-    }
-    // 统计键端和键端的距离
+    };
+    for (auto &aid: aIds) { add_box_bond_feats(aid, sAtomBondThresh); }
+    for (auto &gid: gIds) { add_box_bond_feats(gid, sGroupBondThresh); }
+    // 统计键端和键端的距离，只保留最近的一对键端
     for (size_t i = 0; i < bIds.size(); i++) {
         size_t bid1 = bIds[i];
-        auto &ocrBondItem1 = _items[bid1];
-        size_t fid1 = cast_side1(bid1), tid1 = cast_side2(bid1);
-        for (size_t j = i + 1; j < bIds.size(); j++) {
+        // 两端各查一次，合并成升序且只保留 j > i
+        float margin = get_side_margin(bid1);
+        query_sides(expand_rect({_items.getFrom(bid1), _items.getFrom(bid1)}, margin), candidates);
+        query_sides(expand_rect({_items.getTo(bid1), _items.getTo(bid1)}, margin), candidates2);
+        candidates.insert(candidates.end(), candidates2.begin(), candidates2.end());
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+        for (auto &j: candidates) {
+            if (j <= i) { continue; }
             size_t bid2 = bIds[j];
-//            if (!is_valid_pair(bid1, bid2)) { continue; }
-            auto &ocrBondItem2 = _items[bid2];
-            size_t fid2 = cast_side1(bid2), tid2 = cast_side2(bid2);
             float len = (std::max)(0.01f, (std::max)(bLength[bid1], bLength[bid2]));
-            std::map<float, size_t, std::less<float>> distances = {
-                    {getDistance(ocrBondItem1.getFrom(), ocrBondItem2.getFrom()) / len, 0},
-                    {getDistance(ocrBondItem1.getFrom(), ocrBondItem2.getTo()) / len,   1},
-                    {getDistance(ocrBondItem1.getTo(), ocrBondItem2.getFrom()) / len,   2},
-                    {getDistance(ocrBondItem1.getTo(), ocrBondItem2.getTo()) / len,     3}
+            const float distances[4] = {
+                    getDistance(_items.getFrom(bid1), _items.getFrom(bid2)) / len,
+                    getDistance(_items.getFrom(bid1), _items.getTo(bid2)) / len,
+                    getDistance(_items.getTo(bid1), _items.getFrom(bid2)) / len,
+                    getDistance(_items.getTo(bid1), _items.getTo(bid2)) / len
             };
-            auto first = distances.begin();
-            if (first->first > sBSideBSideThresh) {
-                kill_common(bid1, bid2);
-                kill_common(fid1, fid2);
-                kill_common(fid1, tid2);
-                kill_common(tid1, fid2);
-                kill_common(tid1, tid2);
-                continue;
+            // 取最小值，相等时取靠前的一个；k 的高位表示 bid1 的哪一端，低位表示 bid2 的哪一端
+            size_t minK = 0;
+            for (size_t k = 1; k < 4; k++) {
+                if (distances[k] < distances[minK]) {
+                    minK = k;
+                }
             }
-//            for (auto&[feat, id]:distances) {
-//                // qDebug() << "[b-b distance]\t" << feat << id;
-//            }
-//            // qDebug() << "[b-b distance]\t" << "**************************";
-            switch (first->second) {
-                case 0:
-                    add_feat(fid1, fid2, first->first);
-//                    feats.insert({{fid1, fid2}, first->first});
-                    kill_common(fid1, tid2);
-                    kill_common(tid1, fid2);
-                    kill_common(tid1, tid2);
-                    break;
-                case 1:
-                    kill_common(fid1, fid2);
-                    add_feat(fid1, tid2, first->first);
-//                    feats.insert({{fid1, tid2}, first->first});
-                    kill_common(tid1, fid2);
-                    kill_common(tid1, tid2);
-                    break;
-                case 2:
-                    kill_common(fid1, fid2);
-                    kill_common(fid1, tid2);
-                    add_feat(tid1, fid2, first->first);
-//                    feats.insert({{tid1, fid2}, first->first});
-                    kill_common(tid1, tid2);
-                    break;
-                default:
-                    kill_common(fid1, fid2);
-                    kill_common(fid1, tid2);
-                    kill_common(tid1, fid2);
-                    add_feat(tid1, tid2, first->first);
-//                    feats.insert({{tid1, tid2}, first->first});
-                    break;
+            if (distances[minK] > sBSideBSideThresh) {
+                continue;
             }
+            add_feat(cast_side1(bid1) + minK / 2, cast_side1(bid2) + minK % 2, distances[minK]);
         }
     }
 
     // 决策过程
     // Input: 候选关系对 {<id1,id2,distance,(maybe)feature_map>, ......}
     // Output: 实际关系对 {<id1,id2>, ......}
-//    // qDebug() << "blackList.size()=" << blackList.size();
-//    // qDebug() << "feats.size()=" << feats.size();
-    for (auto&[id, vec]: feats) {
-        std::sort(vec.begin(), vec.end(), [](const feat_type &_a, const feat_type &_b) -> bool {
-            return _a.second < _b.second;
-        });
+    // feats[featStart[id], featStart[id+1]) 为 id 的候选邻居，按距离升序
+    std::vector<size_t> featStart(idNum + 1, 0);
+    for (auto &edge: featEdges) {
+        ++featStart[edge.id1 + 1];
+        ++featStart[edge.id2 + 1];
+    }
+    for (size_t i = 1; i <= idNum; i++) {
+        featStart[i] += featStart[i - 1];
+    }
+    std::vector<feat_type> feats(featStart.back());
+    {
+        std::vector<size_t> cursor(featStart.begin(), featStart.end() - 1);
+        for (auto &edge: featEdges) {
+            feats[cursor[edge.id1]++] = {edge.id2, edge.feat};
+            feats[cursor[edge.id2]++] = {edge.id1, edge.feat};
+        }
+    }
+    featEdges = std::vector<FeatEdge>();
+    for (size_t id = 0; id < idNum; id++) {
+        std::sort(feats.begin() + featStart[id], feats.begin() + featStart[id + 1],
+                  [](const feat_type &_a, const feat_type &_b) -> bool {
+                      return _a.second < _b.second;
+                  });
     }
-    ///////// 日志开始
-//    QString logBuffer = "composer log:\n";
-//    for (auto&[id, vec]:feats) {
-//        int type = get_bond_side_type(id);
-//        if (type == 0) {
-//            size_t rd = revert_bond_side(id);
-//            auto &item = _items[rd];
-//            logBuffer.append(QString("@bond %1 {%2}.from:").arg(rd).arg(item.getText().c_str()));
-//        } else if (type == 1) {
-//            size_t rd = revert_bond_side(id);
-//            auto &item = _items[rd];
-//            logBuffer.append(QString("@bond %1 {%2}.to:").arg(rd).arg(item.getText().c_str()));
-//        } else {
-//            auto &item = _items[id];
-//            logBuffer.append(QString("@atom %1 {%2}.mode:").arg(id).arg(item.getText().c_str()));
-//        }
-//        logBuffer.append("\n");
-//        for (auto&[nebId, feat]:vec) {
-//            int nebType = get_bond_side_type(nebId);
-//            if (nebType == 0) {
-//                size_t nebRd = revert_bond_side(nebId);
-//                auto &item = _items[nebRd];
-//                logBuffer.append(QString("[bond %0 {%1}.from: %2]\t").arg(
-//                        nebRd).arg(item.getText().c_str()).arg(QString::number(feat, 'f', 3)));
-//            } else if (nebType == 1) {
-//                size_t nebRd = revert_bond_side(nebId);
-//                auto &item = _items[nebRd];
-//                logBuffer.append(QString("[bond %0 {%1}.to: %2]\t").arg(
-//                        nebRd).arg(item.getText().c_str()).arg(QString::number(feat, 'f', 3)));
-//            } else {
-//                auto &item = _items[nebId];
-//                logBuffer.append(QString("[atom %0 {%1}.node: %2]\t").arg(
-//                        nebId).arg(item.getText().c_str()).arg(QString::number(feat, 'f', 3)));
-//            }
-//        }
-//        logBuffer.append("\n-------------------------------------\n");
-//    }
-//    // qDebug() << logBuffer.toStdString().c_str();
-    ///////// 日志结束
     // 构造集合节点
     // <集合id，<{item1,item2,...}, center>>
     // 元素中心集合的特点：单中心，集合item数量上限由元素决定
     // 字串中心集合的特点：多中心，不考虑集合item数量上限
     // 键端中心集合的特点：需要初始化中心，中心动态变化，最终的中心是键端多边形的重心，集合item数量上限由碳原子决定
-    // 表示方式：aNodeMap, gNodeMap使用itemId作为集合id，bNodeMap使用>=_items.size()的数作为集合id
-    std::unordered_map<size_t, std::unordered_set<size_t>> aNodeMap, gNodeMap, bNodeMap;
+    // 表示方式：元素和字串使用itemId作为集合id，键端集合使用>=_items.size()的数作为集合id
+    // 集合成员记为 <集合id，键端id> 对，最后排序去重
+    std::vector<std::pair<size_t, size_t>> nodeMembers;
+    nodeMembers.reserve(2 * bIds.size());
     size_t nodeIdx = _items.size();
     // 图元向集合的映射
-    // <图元id，集合id>
-    std::unordered_map<size_t, size_t> itemToNodeMap;
-    auto init_atom_node = [&](const size_t &_aid) {
-        itemToNodeMap[_aid] = _aid;
-        aNodeMap[_aid] = {};
-    };
-    auto init_group_node = [&](const size_t &_gid) {
-        itemToNodeMap[_gid] = _gid;
-        gNodeMap[_gid] = {};
-    };
+    std::vector<size_t> itemToNode(idNum, sNullId);
     auto init_bond_side_node = [&](const size_t &_bSideId) {
-        itemToNodeMap[_bSideId] = nodeIdx;
-        bNodeMap[nodeIdx++] = {_bSideId};
+        itemToNode[_bSideId] = nodeIdx;
+        nodeMembers.emplace_back(nodeIdx++, _bSideId);
     };
     auto bind_bond_side_node = [&](const size_t &_bSideId1, const size_t &_bSideId2) {
-        auto it = itemToNodeMap.find(_bSideId1);
-        if (itemToNodeMap.end() == it) { it = itemToNodeMap.find(_bSideId2); }
-        if (itemToNodeMap.end() == it) {
+        size_t nodeId = itemToNode[_bSideId1];
+        if (sNullId == nodeId) { nodeId = itemToNode[_bSideId2]; }
+        if (sNullId == nodeId) {
             init_bond_side_node(_bSideId1);
-            it = itemToNodeMap.find(_bSideId1);
+            nodeId = itemToNode[_bSideId1];
         }
-        size_t nodeId = it->second;
-        if (nodeId < _items.size()) {
-            auto &item = _items[nodeId];
-            switch (item.type) {
-                case OCRItemType::Element:
-                    aNodeMap[nodeId].insert(_bSideId1);
-                    aNodeMap[nodeId].insert(_bSideId2);
-                    break;
-                case OCRItemType::Group:
-                    gNodeMap[nodeId].insert(_bSideId1);
-                    gNodeMap[nodeId].insert(_bSideId2);
-                    break;
-                default:
-                    break;
-            }
-        } else {
-            bNodeMap[nodeId].insert(_bSideId1);
-            bNodeMap[nodeId].insert(_bSideId2);
+        // 元素和字串之外的图元集合不收成员
+        if (nodeId >= _items.size() || OCRItemType::Element == _items.getType(nodeId)
+            || OCRItemType::Group == _items.getType(nodeId)) {
+            nodeMembers.emplace_back(nodeId, _bSideId1);
+            nodeMembers.emplace_back(nodeId, _bSideId2);
         }
-        itemToNodeMap[_bSideId1] = itemToNodeMap[_bSideId2] = nodeId;
+        itemToNode[_bSideId1] = itemToNode[_bSideId2] = nodeId;
     };
     auto bind_bond_node = [&](const size_t &_bSideId, const size_t &_id) {
-        auto it = itemToNodeMap.find(_bSideId);
-        size_t rd = revert_bond_side(_id);
-        auto &item = _items[rd];
-        switch (item.type) {
+        switch (_items.getType(revert_bond_side(_id))) {
             case OCRItemType::Element:
-                itemToNodeMap[_id] = itemToNodeMap[_bSideId] = _id;
-                aNodeMap[_id].insert(_bSideId);
-                break;
             case OCRItemType::Group:
-                itemToNodeMap[_id] = itemToNodeMap[_bSideId] = _id;
-                gNodeMap[_id].insert(_bSideId);
+                itemToNode[_id] = itemToNode[_bSideId] = _id;
+                nodeMembers.emplace_back(_id, _bSideId);
                 break;
             case OCRItemType::Line:
                 bind_bond_side_node(_bSideId, _id);
@@ -348,21 +255,22 @@ std::shared_ptr<GuiMol> GraphComposer::compose(const std::vector<OCRItem> &_item
                 break;
         }
     };
-    for (auto &aid: aIds) { init_atom_node(aid); }
-    for (auto &gid: gIds) { init_group_node(gid); }
+    for (auto &aid: aIds) { itemToNode[aid] = aid; }
+    for (auto &gid: gIds) { itemToNode[gid] = gid; }
 
+    // 候选邻居已按距离排好，键端与键端的关系只在先处理的一端生效，保证键端集合互斥
+    // 与元素、字串的关系不受限制
+    std::vector<bool> isHandled(idNum, false);
     auto handle_bond_side = [&](const size_t &_bSideId) {
-        auto it = feats.find(_bSideId);
-        if (feats.end() == it) {
+        isHandled[_bSideId] = true;
+        if (featStart[_bSideId] == featStart[_bSideId + 1]) {
             init_bond_side_node(_bSideId);
             return;
         }
-        auto &nebVec = it->second;
         // 遍历所有潜在邻居
-        for (auto&[nebId, feat]: nebVec) {
-            // 通过 blackList 保证键端集合互斥
-            if (is_valid_pair(_bSideId, nebId)) {
-                kill_common(_bSideId, nebId);
+        for (size_t k = featStart[_bSideId]; k < featStart[_bSideId + 1]; k++) {
+            const size_t &nebId = feats[k].first;
+            if (2 == get_bond_side_type(nebId) || !isHandled[nebId]) {
                 bind_bond_node(_bSideId, nebId);
             }
         }
@@ -373,120 +281,87 @@ std::shared_ptr<GuiMol> GraphComposer::compose(const std::vector<OCRItem> &_item
         handle_bond_side(fId);
         handle_bond_side(tId);
     }
+    std::sort(nodeMembers.begin(), nodeMembers.end());
+    nodeMembers.erase(std::unique(nodeMembers.begin(), nodeMembers.end()), nodeMembers.end());
     //
     //// ************************************************** ////
     auto mol = std::make_shared<GuiMol>();
-    std::unordered_map<size_t, std::shared_ptr<Atom>> bondSideAtomMap, bondSideGroupMap;
+    // 键端所连的原子、字串，按键端 id 索引
+    std::vector<std::shared_ptr<Atom>> bondSideAtoms(idNum), bondSideGroups(idNum);
 //    std::unordered_map<size_t, std::shared_ptr<JResidue>> bondSideResidueMap;
+    std::vector<std::shared_ptr<Atom>> nodeAtoms(nodeIdx);
 
     // 添加元素图元
-    for (auto&[aid, itemSet]: aNodeMap) {
-        auto &item = _items[aid];
-        auto pos = item.getCenter();
-        auto atom = mol->addAtom(item.getElement(), pos.first, pos.second);
-        auto &rect = item.getRect();
-//        atom->x0 = rect.x;
-//        atom->y0 = rect.y;
-//        atom->x1 = rect.x + rect.width;
-//        atom->y1 = rect.y + rect.height;
-        for (auto &bSideId: itemSet) {
-            bondSideAtomMap[bSideId] = atom;
-        }
+    for (auto &aid: aIds) {
+        auto pos = _items.getCenter(aid);
+        nodeAtoms[aid] = mol->addAtom(_items.getElement(aid), pos.first, pos.second);
     }
     // 如果两个元素图元满足类似 NH 上下临接排布的关系，那么在这两个元素图元之间成键
 
     // 添加字串图元
-    for (auto&[gid, itemSet]: gNodeMap) {
-        auto &item = _items[gid];
-        auto &rect = item.getRect();
-//        auto pos = item.getCenter();
-//        point2f pos(0, 0);
-//        for (auto &bSideId:itemSet) {
-//            int type = get_bond_side_type(bSideId);
-//            size_t bid = revert_bond_side(bSideId);
-//            auto &item = _items[bid];
-//            if (type == 0) {
-//                pos += item.getFrom();
-//            } else if (type == 1) {
-//                pos += item.getTo();
-//            } else {
-//                // qDebug() << "error: type !=0 && type != 1@" << __FILE__ << "@" << __LINE__;
-//            }
-//        }
-//        if (!itemSet.empty()) { pos /= static_cast<float>(itemSet.size()); }
-        const auto&[p0, p1]=rect;
-        auto superAtom = mol->addSuperAtom(item.getText(), p0.first, p0.second, p1.first, p1.second);
-        for (auto &bSideId: itemSet) {
-            bondSideGroupMap[bSideId] = superAtom;
-        }
+    for (auto &gid: gIds) {
+        const auto&[p0, p1]=_items.getRect(gid);
+        nodeAtoms[gid] = mol->addSuperAtom(
+                std::string(_items.getText(gid)), p0.first, p0.second, p1.first, p1.second);
     }
     // 收集键图元的起始原子和结束原子
-    for (auto&[_, itemSet]: bNodeMap) {
-        point2f pos(0, 0);
-        for (auto &bSideId: itemSet) {
-            int type = get_bond_side_type(bSideId);
-            size_t bid = revert_bond_side(bSideId);
-            auto &item = _items[bid];
-            if (type == 0) {
-                pos += item.getFrom();
-            } else if (type == 1) {
-                pos += item.getTo();
-            } else {
-                // qDebug() << "error: type !=0 && type != 1@" << __FILE__ << "@" << __LINE__;
+    for (size_t i = 0; i < nodeMembers.size();) {
+        const size_t nodeId = nodeMembers[i].first;
+        size_t end = i;
+        while (end < nodeMembers.size() && nodeMembers[end].first == nodeId) { ++end; }
+        if (nodeId < _items.size()) {
+            auto &sideMap = (OCRItemType::Group == _items.getType(nodeId)) ? bondSideGroups : bondSideAtoms;
+            for (size_t k = i; k < end; k++) {
+                sideMap[nodeMembers[k].second] = nodeAtoms[nodeId];
             }
-        }
-        if (!itemSet.empty()) { pos /= static_cast<float>(itemSet.size()); }
-        auto atom = mol->addAtom(ElementType::C, pos.first, pos.second);
-        atom->setImplicit();
-        for (auto &bSideId: itemSet) {
-            bondSideAtomMap[bSideId] = atom;
-        }
-    }
-    auto get_side_atom = [&](const size_t &_bSideId) -> std::shared_ptr<Atom> {
-        auto it = bondSideAtomMap.find(_bSideId);
-        if (bondSideAtomMap.end() == it) {
-            return nullptr;
-        } else {
-            return it->second;
-        }
-    };
-    auto get_side_group = [&](const size_t &_bSideId) -> std::shared_ptr<Atom> {
-        auto it = bondSideGroupMap.find(_bSideId);
-        if (bondSideGroupMap.end() == it) {
-            return nullptr;
         } else {
-            return it->second;
+            point2f pos(0, 0);
+            for (size_t k = i; k < end; k++) {
+                const size_t &bSideId = nodeMembers[k].second;
+                const size_t bid = revert_bond_side(bSideId);
+                if (0 == get_bond_side_type(bSideId)) {
+                    pos += _items.getFrom(bid);
+                } else {
+                    pos += _items.getTo(bid);
+                }
+            }
+            pos /= static_cast<float>(end - i);
+            auto atom = mol->addAtom(ElementType::C, pos.first, pos.second);
+            atom->setImplicit();
+            for (size_t k = i; k < end; k++) {
+                bondSideAtoms[nodeMembers[k].second] = atom;
+            }
         }
-    };
+        i = end;
+    }
     // 添加键图元
     for (auto &bid: bIds) {
-        auto &item = _items[bid];
         size_t fId = cast_side1(bid);
         size_t tId = cast_side2(bid);
         float offset1 = 0.5, offset2 = 0.5;
-        auto from = get_side_atom(fId);
+        auto from = bondSideAtoms[fId];
         if (!from) {
-            from = get_side_group(fId);
+            from = bondSideGroups[fId];
             if (from) {
                 // 按照字符串计算键端偏移量
                 float width = from->x1 - from->x0;
-                float offset = width ? (item.getFrom().first - from->x0) / width : 0.5;
+                float offset = width ? (_items.getFrom(bid).first - from->x0) / width : 0.5;
                 offset1 = (std::min)(1.f, (std::max)(0.f, offset));
             }
         }
-        auto to = get_side_atom(tId);
+        auto to = bondSideAtoms[tId];
         if (!to) {
-            to = get_side_group(tId);
+            to = bondSideGroups[tId];
             if (to) {
                 // 按照字符串计算键端偏移量
                 float width = to->x1 - to->x0;
-                float offset = width ? (item.getTo().first - to->x0) / width : 0.5;
+                float offset = width ? (_items.getTo(bid).first - to->x0) / width : 0.5;
                 offset2 = (std::min)(1.f, (std::max)(0.f, offset));
             }
         }
         if (from && to) {
             auto bond = mol->addBond(
-                    from, to, item.getBondType(), offset1, offset2);
+                    from, to, _items.getBondType(bid), offset1, offset2);
             const float dirThresh = 0.6;
 //            // qDebug() << offset1 << offset2;
             from->setIsLeftToRight(offset1 < dirThresh);
@@ -512,90 +387,81 @@ std::shared_ptr<GuiMol> GraphComposer::compose(const std::vector<OCRItem> &_item
     if (cIds.empty()) {
         return mol;
     }
-    auto rings = mol->getSSSR();
+    auto graph = mol->getGraph();
+    // 每个线程复用一份环感知的缓冲，环以图快照的原子下标给出
+    thread_local RingFinder ringFinder;
+    const auto &rings = ringFinder.findSSSR(*graph);
     if (rings.empty()) { return mol; }
-    for (auto &ring: rings) {
-        if (ring.empty()) { continue; }
-        // 多边形中心
-        point2f p(0, 0);
-        for (auto &id: ring) {
-            auto atom = mol->getAtom(id);
-            p.first += atom->x;
-            p.second += atom->y;
+    // 环的重心与平均半径
+    std::vector<point2f> ringCenters(rings.size(), {0, 0});
+    std::vector<float> ringRadius(rings.size(), 0);
+    for (size_t i = 0; i < rings.size(); i++) {
+        auto ring = rings[i];
+        for (auto &idx: ring) {
+            ringCenters[i] += graph->getPos2D(idx);
         }
-        p /= static_cast<float>(ring.size());
-        // 多边形半径
-        float r = 0;
-        for (auto &id: ring) {
-            auto atom = mol->getAtom(id);
-            r += getDistance(p, point2f(atom->x, atom->y));
+        ringCenters[i] /= static_cast<float>(ring.size());
+        for (auto &idx: ring) {
+            ringRadius[i] += getDistance(ringCenters[i], graph->getPos2D(idx));
         }
-        r /= static_cast<float>(ring.size());
-        // 遍历所有检测到的圈，看有没有圈在这个多边形里
-        // TODO: 这是个一对一的婚配问题，显然可以优化下
-        bool needAromatic = false;
-        for (auto &cid: cIds) {
-            auto &circle = _items[cid];
-            if (r - circle.getRadius() > getDistance(p, circle.getCenter())) {
-                needAromatic = true;
-                break;
+        ringRadius[i] /= static_cast<float>(ring.size());
+    }
+    // 以环的外接方框建立空间索引，每个圈只查询包含其圆心的环，取圆心距离最近且能容下这个圈的环
+    SpatialGrid ringGrid;
+    ringGrid.reserve(rings.size());
+    float avgRadius = 0;
+    for (size_t i = 0; i < rings.size(); i++) {
+        ringGrid.insert(i, expand_rect({ringCenters[i], ringCenters[i]}, ringRadius[i]));
+        avgRadius += ringRadius[i];
+    }
+    ringGrid.build(2 * avgRadius / rings.size(), rings.size());
+    std::vector<bool> needAromatic(rings.size(), false);
+    for (auto &cid: cIds) {
+        auto center = _items.getCenter(cid);
+        ringGrid.query({center, center}, candidates);
+        size_t best = sNullId;
+        float bestDis = std::numeric_limits<float>::max();
+        for (auto &rid: candidates) {
+            float dis = getDistance(ringCenters[rid], center);
+            if (ringRadius[rid] - _items.getRadius(cid) > dis && dis < bestDis) {
+                bestDis = dis;
+                best = rid;
             }
         }
-//        // qDebug() << "needAromatic=" << needAromatic;
-        if (!needAromatic) { continue; }
-        // 下面一波操作把环上的边按照深度优先遍历的顺序存进 bondVec2
-        // TODO: 这个 O(n^2) 还有 bug 的写法有损形象，有空可以优化下
-        std::unordered_set<id_type> aidSet;
-        for (auto &id: ring) { aidSet.insert(id); }
-//        // qDebug() << "aidSet.size()=" << aidSet.size();
-        std::vector<id_type> bondVec1, bondVec2;
-        // modify_bond
-        mol->loopBondVec([&](Bond &bond) {
-            if (aidSet.end() != aidSet.find(bond.getFrom()->getId()) &&
-                aidSet.end() != aidSet.find(bond.getTo()->getId())) {
-                bondVec1.push_back(bond.getId());
-            }
-        });
-//        // qDebug() << "bondVec1.size()=" << bondVec1.size();
+        if (sNullId != best) {
+            needAromatic[best] = true;
+        }
+    }
+    // 环上相邻原子之间的键从图快照的邻接表里查
+    auto find_bond = [&](const MolGraph::index_type &_a1, const MolGraph::index_type &_a2) -> std::shared_ptr<Bond> {
+        auto bIdx = graph->findBond(_a1, _a2);
+        if (MolGraph::npos == bIdx) { return nullptr; }
+        return mol->getBond(graph->getBondId(bIdx));
+    };
+    std::vector<std::shared_ptr<Bond>> ringBonds;
+    for (size_t i = 0; i < rings.size(); i++) {
+        if (!needAromatic[i]) { continue; }
+        // SSSR 给出的原子按环上的顺序排列，相邻两个原子之间就是环上的键
+        auto ring = rings[i];
+        ringBonds.clear();
+        for (size_t k = 0; k < ring.size(); k++) {
+            auto bond = find_bond(ring[k], ring[(k + 1) % ring.size()]);
+            if (!bond) { break; }
+            ringBonds.push_back(std::move(bond));
+        }
+        if (ringBonds.size() != ring.size()) { continue; }
         size_t start = 0;
-        for (size_t i = 0; i < bondVec1.size(); i++) {
-            // 优先从官能团出发搜索
-            auto bond = mol->getBond(bondVec1[i]);
-            if (!bond) { continue; }
-            if (bond->getBondOrder() >= 2) {
-                start = i;
-                break;
-            }
-            if (bond->getFrom()->getType() != ElementType::C ||
+        for (size_t k = 0; k < ringBonds.size(); k++) {
+            // 优先从官能团出发
+            auto &bond = ringBonds[k];
+            if (bond->getBondOrder() >= 2 || bond->getFrom()->getType() != ElementType::C ||
                 bond->getTo()->getType() != ElementType::C) {
-                start = i;
+                start = k;
                 break;
             }
         }
-//        // qDebug() << "start idx=" << start;
-        id_type target = mol->getBond(bondVec1[start])->getFrom()->getId();
-        bondVec2.push_back(bondVec1[start]);
-        bondVec1.erase(bondVec1.begin() + start);
-        size_t gard = bondVec1.size();
-        while (!bondVec1.empty() && gard--) {
-            for (size_t i = 0; i < bondVec1.size(); i++) {
-                auto from = mol->getBond(bondVec1[i])->getFrom();
-                auto to = mol->getBond(bondVec1[i])->getTo();
-                if (from->getId() == target) {
-                    bondVec2.push_back(bondVec1[i]);
-                    target = to->getId();
-                    bondVec1.erase(bondVec1.begin() + i);
-                    break;
-                } else if (to->getId() == target) {
-                    bondVec2.push_back(bondVec1[i]);
-                    target = from->getId();
-                    bondVec1.erase(bondVec1.begin() + i);
-                    break;
-                }
-            }
-        }
-        for (size_t i = 0; i < bondVec2.size(); i++) {
-            mol->tryMarkDoubleBond(bondVec2[i]);
+        for (size_t k = 0; k < ringBonds.size(); k++) {
+            mol->tryMarkDoubleBond(ringBonds[(start + k) % ringBonds.size()]->getId());
         }
     }
     return mol;
@@ -1,6 +1,6 @@
 #include "cocr/object_detector.h"
+#include "base/log.h"
 #include "ocv/algorithm.h"
-#include <QDebug>
 
 #ifdef USE_OPENCV_DNN
 
@@ -34,7 +34,7 @@ Mat ObjectDetector::preProcess(const Mat &_src) {
     return CvUtil::ResizeWithBlock(_src, {w, h}, {sizeBase, sizeBase});
 }
 
-ObjectDetector::ObjectDetector() : maxHeight(1280), maxWidth(1280) {
+ObjectDetector::ObjectDetector() : maxHeight(DEFAULT_MAX_SIDE), maxWidth(DEFAULT_MAX_SIDE) {
 
 }
 
@@ -47,22 +47,22 @@ std::shared_ptr<ObjectDetector> ObjectDetector::MakeInstance() {
     detector->setConfThresh(0.25);
     detector->setIouThresh(0.45);
     if (!detector->initModel(ocvDetModelCfg, ocvDetModel)) {
-        qDebug() << "fail to init opencv detector";
+        LOG_ERROR << "fail to init opencv detector";
         detector->freeModel();
         return nullptr;
     }
-    qDebug() << "init opencv detector success";
+    LOG_DEBUG << "init opencv detector success";
 #else
     std::string ncnnDetModel = MODEL_DIR + std::string("/yolo_3l_c8.bin");
     std::string ncnnDetModelCfg = MODEL_DIR + std::string("/yolo_3l_c8.param");
     auto detector = std::make_shared<ObjectDetectorNcnnImpl>();
     detector->setNumThread(4);
     if (!detector->initModel(ncnnDetModel, ncnnDetModelCfg, 1280)) {
-        qDebug() << "fail to init ncnn detector";
+        LOG_ERROR << "fail to init ncnn detector";
         detector->freeModel();
         return nullptr;
     }
-    qDebug() << "init ncnn detector success";
+    LOG_DEBUG << "init ncnn detector success";
 #endif
     return detector;
 }
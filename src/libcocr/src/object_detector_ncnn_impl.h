@@ -1,6 +1,7 @@
 #pragma once
 
 #include "cocr/object_detector.h"
+#include "base/log.h"
 
 #include <ncnn/net.h> // <ncnn/net.h>
 #include <ncnn/datareader.h> // <ncnn/datareader.h>
@@ -8,7 +9,6 @@
 #include <opencv2/core/types.hpp> // cv::Rect
 
 #include <QFile>
-#include <QDebug>
 
 #include <string>
 #include <memory>
@@ -234,7 +234,7 @@ public:
         maxWidth = maxHeight = _maxWidth - sizeBase;
         QFile cfgFile(_ncnnParam.c_str()), weightsFile(_ncnnBin.c_str());
         if (!cfgFile.open(QIODevice::ReadOnly) || !weightsFile.open(QIODevice::ReadOnly)) {
-            qDebug() << "fail in QFile read" << _ncnnBin.c_str() << "and" << _ncnnParam.c_str();
+            LOG_ERROR << "fail in QFile read" << _ncnnBin.c_str() << "and" << _ncnnParam.c_str();
             return false;
         }
         QByteArray cfg = cfgFile.readAll();
@@ -261,14 +261,14 @@ public:
             ncnn::DataReaderFromMemory cfgReader(cfgMem);
             int ret_param = net->load_param(cfgReader);
             if (ret_param != 0) {
-                qDebug() << "net->load_param(cfgReader) dies";
+                LOG_ERROR << "net->load_param(cfgReader) dies";
                 return false;
             }
             const unsigned char *weightsMem = (const unsigned char *) weights.data();
             ncnn::DataReaderFromMemory weightsReader(weightsMem);
             int ret_bin = net->load_model(weightsReader);
             if (ret_bin != 0) {
-                qDebug() << "net->load_model(weightsReader) dies";
+                LOG_ERROR << "net->load_model(weightsReader) dies";
                 return false;
             }
 
@@ -281,7 +281,7 @@ public:
             ncnn::Mat out;
             ex.extract("output", out);
         } catch (std::exception &e) {
-            qDebug() << __FUNCTION__ << "catch" << e.what();
+            LOG_ERROR << "catch" << e.what();
             return false;
         }
         return true;
@@ -378,7 +378,7 @@ public:
         maxWidth = maxHeight = _maxWidth - sizeBase;
         QFile cfgFile(_ncnnParam.c_str()), weightsFile(_ncnnBin.c_str());
         if (!cfgFile.open(QIODevice::ReadOnly) || !weightsFile.open(QIODevice::ReadOnly)) {
-            qDebug() << "fail in QFile read" << _ncnnBin.c_str() << "and" << _ncnnParam.c_str();
+            LOG_ERROR << "fail in QFile read" << _ncnnBin.c_str() << "and" << _ncnnParam.c_str();
             return false;
         }
         QByteArray cfg = cfgFile.readAll();
@@ -404,14 +404,14 @@ public:
             ncnn::DataReaderFromMemory cfgReader(cfgMem);
             int ret_param = net->load_param(cfgReader);
             if (ret_param != 0) {
-                qDebug() << "net->load_param(cfgReader) dies";
+                LOG_ERROR << "net->load_param(cfgReader) dies";
                 return false;
             }
             const unsigned char *weightsMem = (const unsigned char *) weights.data();
             ncnn::DataReaderFromMemory weightsReader(weightsMem);
             int ret_bin = net->load_model(weightsReader);
             if (ret_bin != 0) {
-                qDebug() << "net->load_model(weightsReader) dies";
+                LOG_ERROR << "net->load_model(weightsReader) dies";
                 return false;
             }
 
@@ -424,7 +424,7 @@ public:
             ncnn::Mat out;
             ex.extract("output", out);
         } catch (std::exception &e) {
-            qDebug() << __FUNCTION__ << "catch" << e.what();
+            LOG_ERROR << "catch" << e.what();
             return false;
         }
         return true;
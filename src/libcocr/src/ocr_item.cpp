@@ -151,6 +151,16 @@ void OCRItem::setAsLineBond(const BondType &_bt, const rectf &_rect, const Mat &
     data = bd;
 }
 
+void OCRItem::setAsLineBond(const BondType &_bt, const point2f &_from, const point2f &_to) {
+    type = OCRItemType::Line;
+    rectf rect{{(std::min)(_from.first, _to.first), (std::min)(_from.second, _to.second)},
+               {(std::max)(_from.first, _to.first), (std::max)(_from.second, _to.second)}};
+    auto bd = std::make_shared<OCRLineDataItem>(_bt, rect);
+    bd->from = _from;
+    bd->to = _to;
+    data = bd;
+}
+
 void OCRItem::setAsCircleBond(const rectf &_rect) {
     type = OCRItemType::Circle;
     data = std::make_shared<OCRCircleDataItem>(_rect);
@@ -0,0 +1,190 @@
+#include "cocr/ocr_item_table.h"
+#include "ocv/algorithm.h"
+
+static const point2f sPts0(0, 0);
+
+size_t OCRItemTable::push(const OCRItemType &_type, const rectf &_rect) {
+    types.push_back(_type);
+    rects.push_back(_rect);
+    froms.push_back(sPts0);
+    tos.push_back(sPts0);
+    bondTypes.push_back(BondType::WaveBond);
+    elements.push_back(ElementType::SA);
+    textIds.push_back(sNoText);
+    return types.size() - 1;
+}
+
+uint32_t OCRItemTable::intern(const std::string &_text) {
+    auto it = textIndex.find(_text);
+    if (textIndex.end() != it) {
+        return it->second;
+    }
+    auto id = static_cast<uint32_t>(texts.size());
+    texts.push_back(_text);
+    textIndex.emplace(_text, id);
+    return id;
+}
+
+void OCRItemTable::reserve(const size_t &_n) {
+    types.reserve(_n);
+    rects.reserve(_n);
+    froms.reserve(_n);
+    tos.reserve(_n);
+    bondTypes.reserve(_n);
+    elements.reserve(_n);
+    textIds.reserve(_n);
+}
+
+void OCRItemTable::clear() {
+    types.clear();
+    rects.clear();
+    froms.clear();
+    tos.clear();
+    bondTypes.clear();
+    elements.clear();
+    textIds.clear();
+    texts.clear();
+    textIndex.clear();
+}
+
+size_t OCRItemTable::size() const {
+    return types.size();
+}
+
+bool OCRItemTable::empty() const {
+    return types.empty();
+}
+
+size_t OCRItemTable::addLineBond(const BondType &_bt, const rectf &_rect, const Mat &_input) {
+    size_t i = push(OCRItemType::Line, _rect);
+    bondTypes[i] = _bt;
+    if (BondType::SolidWedgeBond == _bt || BondType::DashWedgeBond == _bt) {
+        std::tie(froms[i], tos[i]) = CvUtil::GetWedgeFromTo(_input, _rect);
+    } else {
+        std::tie(froms[i], tos[i]) = CvUtil::GetLineFromTo(_input, _rect);
+    }
+    return i;
+}
+
+size_t OCRItemTable::addLineBond(const BondType &_bt, const point2f &_from, const point2f &_to) {
+    rectf rect{{(std::min)(_from.first, _to.first), (std::min)(_from.second, _to.second)},
+               {(std::max)(_from.first, _to.first), (std::max)(_from.second, _to.second)}};
+    size_t i = push(OCRItemType::Line, rect);
+    bondTypes[i] = _bt;
+    froms[i] = _from;
+    tos[i] = _to;
+    return i;
+}
+
+size_t OCRItemTable::addCircleBond(const rectf &_rect) {
+    return push(OCRItemType::Circle, _rect);
+}
+
+size_t OCRItemTable::addText(const std::string &_text, const rectf &_rect) {
+    ElementType eleType = ElementUtil::convertStringToElementType(_text);
+    if (eleType != ElementType::SA) {
+        size_t i = push(OCRItemType::Element, _rect);
+        elements[i] = eleType;
+        return i;
+    }
+    size_t i = push(OCRItemType::Group, _rect);
+    textIds[i] = intern(_text);
+    return i;
+}
+
+const OCRItemType &OCRItemTable::getType(const size_t &_i) const {
+    return types[_i];
+}
+
+const rectf &OCRItemTable::getRect(const size_t &_i) const {
+    return rects[_i];
+}
+
+const point2f &OCRItemTable::getFrom(const size_t &_i) const {
+    return froms[_i];
+}
+
+const point2f &OCRItemTable::getTo(const size_t &_i) const {
+    return tos[_i];
+}
+
+BondType OCRItemTable::getBondType(const size_t &_i) const {
+    return bondTypes[_i];
+}
+
+ElementType OCRItemTable::getElement(const size_t &_i) const {
+    return elements[_i];
+}
+
+float OCRItemTable::getRadius(const size_t &_i) const {
+    if (OCRItemType::Circle != types[_i]) {
+        return 0;
+    }
+    return ::getAvgWidth(rects[_i]);
+}
+
+point2f OCRItemTable::getCenter(const size_t &_i) const {
+    if (OCRItemType::Line == types[_i]) {
+        return (froms[_i] + tos[_i]) / 2.0;
+    }
+    return ::getCenter(rects[_i]);
+}
+
+std::string_view OCRItemTable::getText(const size_t &_i) const {
+    if (sNoText != textIds[_i]) {
+        return texts[textIds[_i]];
+    }
+    switch (types[_i]) {
+        case OCRItemType::Element:
+            return ElementUtil::convertElementTypeToString(elements[_i]);
+        case OCRItemType::Circle:
+            return "circle";
+        case OCRItemType::Line: {
+            switch (bondTypes[_i]) {
+                case BondType::SingleBond:
+                    return "-";
+                case BondType::DoubleBond:
+                    return "=";
+                case BondType::TripleBond:
+                    return "#";
+                case BondType::SolidWedgeBond:
+                    return "Up";
+                case BondType::DashWedgeBond:
+                    return "Down";
+                case BondType::WaveBond:
+                    return "~~";
+                default:
+                    return "err";
+            }
+        }
+        default:
+            return "Empty";
+    }
+}
+
+OCRItemTable OCRItemTable::FromItems(const std::vector<OCRItem> &_items) {
+    OCRItemTable table;
+    table.reserve(_items.size());
+    for (auto &item: _items) {
+        switch (item.type) {
+            case OCRItemType::Line:
+                table.addLineBond(item.getBondType(), item.getFrom(), item.getTo());
+                table.rects.back() = item.getRect();
+                break;
+            case OCRItemType::Circle:
+                table.addCircleBond(item.getRect());
+                break;
+            case OCRItemType::Element: {
+                size_t i = table.push(OCRItemType::Element, item.getRect());
+                table.elements[i] = item.getElement();
+                break;
+            }
+            default: {
+                size_t i = table.push(item.type, item.getRect());
+                table.textIds[i] = table.intern(item.getText());
+                break;
+            }
+        }
+    }
+    return table;
+}
@@ -1,39 +1,86 @@
 #include "cocr/ocr_manager.h"
+#include "base/log.h"
 #include "ocv/algorithm.h"
-#include <QDebug>
 #include <QtGui/QImage>
 #include <QtGui/QPixmap>
 
+#include <chrono>
+#include <optional>
+
 OCRManager::OCRManager(ObjectDetector &_detector, TextRecognizer &_recognizer,
                        TextCorrector &_corrector, GraphComposer &_composer)
         : detector(_detector), recognizer(_recognizer), corrector(_corrector), composer(_composer),
-          image(MatChannel::GRAY, DataType::UINT8, 1, 1) {
-    qDebug() << "OCRManager::OCRManager";
+          image(MatChannel::GRAY, DataType::UINT8, 1, 1), isDeskewEnabled(false), deskewThresh(0.5) {
+    LOG_DEBUG;
 }
 
 std::shared_ptr<GuiMol> OCRManager::ocr(Mat &_originInput, bool _debug) {
-    std::vector<OCRItem> items;
+    MatArenaScope arenaScope(arena);
+    stats = OCRStageStats();
+    using clock = std::chrono::steady_clock;
+    auto elapsed = [](const clock::time_point &_from) -> float {
+        return std::chrono::duration<float, std::milli>(clock::now() - _from).count();
+    };
+    OCRItemTable items;
     try {
-        auto[input, objects]=detector.detect(_originInput);
+        auto stamp = clock::now();
+        auto deskewed = deskew(_originInput);
+        stats.deskewMs = elapsed(stamp);
+        stamp = clock::now();
+        auto[input, objects]=detector.detect(deskewed ? *deskewed : _originInput);
+        stats.detectMs = elapsed(stamp);
+        stamp = clock::now();
         items = convert(objects, input);
+        stats.convertMs = elapsed(stamp);
         if (_debug) {
             display(items, input);
         }
     } catch (std::exception &e) {
-        qDebug() << __FUNCTION__ << "detector and convert catch" << e.what();
+        LOG_ERROR << "detector and convert catch" << e.what();
         return nullptr;
     }
     try {
+        auto stamp = clock::now();
         auto mol = composer.compose(items);
+        stats.composeMs = elapsed(stamp);
         mol->set2DInfoLatest(false);
         return mol;
     } catch (std::exception &e) {
-        qDebug() << __FUNCTION__ << "compose catch" << e.what();
+        LOG_ERROR << "compose catch" << e.what();
         return nullptr;
     }
 }
 
-std::vector<OCRItem> OCRManager::convert(
+std::optional<Mat> OCRManager::deskew(const Mat &_input) {
+    if (!isDeskewEnabled) {
+        return std::nullopt;
+    }
+    stats.skewAngle = CvUtil::EstimateSkew(_input);
+    if (std::abs(stats.skewAngle) <= deskewThresh) {
+        return std::nullopt;
+    }
+    // 检测器反正要把长边缩到上限以内，先缩小再旋转，旋转用双线性插值
+    const int maxSide = ObjectDetector::DEFAULT_MAX_SIDE;
+    const int w = _input.getWidth(), h = _input.getHeight();
+    stats.deskewed = true;
+    if (w > maxSide || h > maxSide) {
+        const float k = static_cast<float>(maxSide) / (std::max)(w, h);
+        auto reduced = CvUtil::Resize(_input, {static_cast<int>(w * k), static_cast<int>(h * k)});
+        return CvUtil::Rotate(reduced, stats.skewAngle, true);
+    }
+    return CvUtil::Rotate(_input, stats.skewAngle, true);
+}
+
+void OCRManager::setDeskewEnabled(bool _enabled, const float &_thresh) {
+    isDeskewEnabled = _enabled;
+    deskewThresh = _thresh;
+}
+
+const OCRStageStats &OCRManager::getLastStats() const {
+    return stats;
+}
+
+OCRItemTable OCRManager::convert(
         const std::vector<DetectorObject> &_objects, const Mat &_input) {
     int width = _input.getWidth(), height = _input.getHeight();
     auto round_scale = [&](const float &_x, const float &_y, const float &_w, const float &_h) -> recti {
@@ -45,11 +92,11 @@ std::vector<OCRItem> OCRManager::convert(
         h = std::min(height - 1, (int) std::round(_y + _h + 2 * sy)) - y;
         return {point2i{x, y}, point2i{x + w, y + h}};
     };
-    std::vector<OCRItem> items(_objects.size());
+    // 行号即 uid，与检测结果一一对应
+    OCRItemTable items;
+    items.reserve(_objects.size());
     for (size_t i = 0; i < _objects.size(); i++) {
         const auto &obj = _objects[i];
-        auto &item = items[i];
-        item.setUId(i);
         switch (obj.label) {
             case DetectorObjectType::SingleLine :
             case DetectorObjectType::DoubleLine :
@@ -57,18 +104,18 @@ std::vector<OCRItem> OCRManager::convert(
             case DetectorObjectType::WaveLine :
             case DetectorObjectType::SolidWedge :
             case DetectorObjectType::DashWedge : {
-                item.setAsLineBond(DetectorUtil::toBondType(obj.label), obj.asRect(), _input);
+                items.addLineBond(DetectorUtil::toBondType(obj.label), obj.asRect(), _input);
                 break;
             }
             case DetectorObjectType::Circle : {
-                item.setAsCircleBond(obj.asRect());
+                items.addCircleBond(obj.asRect());
                 break;
             }
             case DetectorObjectType::Text : {
                 auto[text, scores]=recognizer.recognize(_input(round_scale(obj.x(), obj.y(), obj.w(), obj.h())));
 //                qDebug() << "text=" << text.c_str();
                 text = corrector.correct(text);
-                item.setAsText(text, obj.asRect());
+                items.addText(text, obj.asRect());
                 break;
             }
             default: {
@@ -79,7 +126,7 @@ std::vector<OCRItem> OCRManager::convert(
     return items;
 }
 
-void OCRManager::display(const std::vector<OCRItem> &_items, const Mat &_input) {
+void OCRManager::display(const OCRItemTable &_items, const Mat &_input) {
 //    Mat canvas;
 //    cv::cvtColor(_input, canvas, cv::COLOR_GRAY2BGR);
 //    auto move_text_box = [&](const cv::Point2f &_pts) -> cv::Point {
@@ -169,7 +216,7 @@ void OCRManager::setImage(const QList<QList<QPointF>> &_script, const int &scree
     float ky = static_cast<float>(height) / (maxy - miny);
     width += padding * 2;
     height += padding * 2;
-    qDebug() << "kx=" << kx << ",ky=" << ky << ",scale=" << scale;
+    LOG_DEBUG << "kx=" << kx << ",ky=" << ky << ",scale=" << scale;
     std::vector<std::vector<point2f>> ptsVec(_script.size());
     for (size_t i = 0; i < ptsVec.size(); i++) {
         ptsVec[i].resize(_script[i].size());
@@ -202,7 +249,6 @@ void OCRManager::setImage(const QPixmap &_pixmap) {
 
 void OCRManager::setImage(const Mat &_cvMat) {
     image = _cvMat;
-    CvUtil::Rotate(_cvMat, 2);
 }
 
 void OCRManager::clearImage() {
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "base/rect.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+/**
+ * 均匀网格空间索引，每个条目是一个轴对齐包围盒，同一个 id 可以登记多个包围盒
+ * 网格按格子连续存储（CSR），查询返回与查询框相交的所有 id，升序且去重
+ */
+class SpatialGrid {
+    struct Entry {
+        size_t id;
+        rectf box;
+    };
+    float cellSize, x0, y0;
+    int cols, rows;
+    std::vector<Entry> entries;
+    std::vector<size_t> cellStart;
+    std::vector<uint32_t> cellEntries;
+    std::vector<uint32_t> visitStamp;
+    uint32_t stamp;
+
+    // 先在浮点域里截断再转整数，远离网格的坐标不会溢出 int
+    static int toCell(const float &_v, const float &_v0, const float &_cellSize, const int &_num) {
+        return static_cast<int>(std::clamp(std::floor((_v - _v0) / _cellSize), 0.f, static_cast<float>(_num - 1)));
+    }
+
+    int toCol(const float &_x) const {
+        return toCell(_x, x0, cellSize, cols);
+    }
+
+    int toRow(const float &_y) const {
+        return toCell(_y, y0, cellSize, rows);
+    }
+
+    static bool isFinite(const rectf &_box) {
+        return std::isfinite(_box.first.first) && std::isfinite(_box.first.second) &&
+               std::isfinite(_box.second.first) && std::isfinite(_box.second.second);
+    }
+
+    static bool intersects(const rectf &_a, const rectf &_b) {
+        return !(_a.second.first < _b.first.first || _b.second.first < _a.first.first ||
+                 _a.second.second < _b.first.second || _b.second.second < _a.first.second);
+    }
+
+public:
+    SpatialGrid() : cellSize(1), x0(0), y0(0), cols(1), rows(1), stamp(0) {}
+
+    void reserve(const size_t &_n) {
+        entries.reserve(_n);
+    }
+
+    /**
+     * 坐标含 NaN 或无穷的包围盒无法落到格子里，直接丢弃，查询时也不会返回
+     */
+    void insert(const size_t &_id, const rectf &_box) {
+        if (!isFinite(_box)) { return; }
+        entries.push_back({_id, _box});
+    }
+
+    /**
+     * 登记完所有条目后调用
+     * @param _cellSize 期望的格子边长，格子总数过多时会自动放大
+     * @param _maxId 条目 id 的上界（不含）
+     */
+    void build(const float &_cellSize, const size_t &_maxId) {
+        float xmin = 0, ymin = 0, xmax = 0, ymax = 0;
+        if (!entries.empty()) {
+            xmin = ymin = std::numeric_limits<float>::max();
+            xmax = ymax = std::numeric_limits<float>::lowest();
+            for (auto &entry: entries) {
+                xmin = (std::min)(xmin, entry.box.first.first);
+                ymin = (std::min)(ymin, entry.box.first.second);
+                xmax = (std::max)(xmax, entry.box.second.first);
+                ymax = (std::max)(ymax, entry.box.second.second);
+            }
+        }
+        x0 = xmin;
+        y0 = ymin;
+        cellSize = (_cellSize > 0 && std::isfinite(_cellSize)) ? _cellSize : 1.f;
+        // 格子数控制在条目数的常数倍内
+        const double maxCells = 4.0 * entries.size() + 64;
+        while (true) {
+            // 用 double 求跨度，避免极大坐标相减溢出成无穷
+            double c = std::floor((static_cast<double>(xmax) - xmin) / cellSize) + 1;
+            double r = std::floor((static_cast<double>(ymax) - ymin) / cellSize) + 1;
+            if (c * r <= maxCells) {
+                cols = static_cast<int>(c);
+                rows = static_cast<int>(r);
+                break;
+            }
+            cellSize *= 2;
+        }
+        cellStart.assign(static_cast<size_t>(cols) * rows + 1, 0);
+        auto for_cells = [&](const rectf &_box, auto &&_func) {
+            int c0 = toCol(_box.first.first), c1 = toCol(_box.second.first);
+            int r0 = toRow(_box.first.second), r1 = toRow(_box.second.second);
+            for (int r = r0; r <= r1; r++) {
+                for (int c = c0; c <= c1; c++) {
+                    _func(static_cast<size_t>(r) * cols + c);
+                }
+            }
+        };
+        for (auto &entry: entries) {
+            for_cells(entry.box, [&](const size_t &_cell) { ++cellStart[_cell + 1]; });
+        }
+        for (size_t i = 1; i < cellStart.size(); i++) {
+            cellStart[i] += cellStart[i - 1];
+        }
+        cellEntries.resize(cellStart.back());
+        std::vector<size_t> cursor(cellStart.begin(), cellStart.end() - 1);
+        for (uint32_t i = 0; i < entries.size(); i++) {
+            for_cells(entries[i].box, [&](const size_t &_cell) { cellEntries[cursor[_cell]++] = i; });
+        }
+        visitStamp.assign(_maxId, 0);
+        stamp = 0;
+    }
+
+    /**
+     * @param _out 清空后写入与 _box 相交的 id，升序
+     */
+    void query(const rectf &_box, std::vector<size_t> &_out) {
+        _out.clear();
+        if (entries.empty() || !isFinite(_box)) { return; }
+        if (++stamp == 0) {
+            std::fill(visitStamp.begin(), visitStamp.end(), 0);
+            stamp = 1;
+        }
+        int c0 = toCol(_box.first.first), c1 = toCol(_box.second.first);
+        int r0 = toRow(_box.first.second), r1 = toRow(_box.second.second);
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) {
+                const size_t cell = static_cast<size_t>(r) * cols + c;
+                for (size_t k = cellStart[cell]; k < cellStart[cell + 1]; k++) {
+                    auto &entry = entries[cellEntries[k]];
+                    if (visitStamp[entry.id] != stamp && intersects(entry.box, _box)) {
+                        visitStamp[entry.id] = stamp;
+                        _out.push_back(entry.id);
+                    }
+                }
+            }
+        }
+        std::sort(_out.begin(), _out.end());
+    }
+};
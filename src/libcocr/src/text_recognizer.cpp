@@ -1,4 +1,5 @@
 #include "cocr/text_recognizer.h"
+#include "base/log.h"
 #include "cocr/text_corrector.h"
 #include "ocv/algorithm.h"
 
@@ -13,7 +14,6 @@
 #endif
 
 
-#include <QDebug>
 
 #include <iostream>
 
@@ -29,7 +29,7 @@ std::shared_ptr<TextRecognizer> TextRecognizer::MakeInstance() {
     std::string onnxTextModel = MODEL_DIR + std::string("/deprecated/onnx-crnn-57.onnx");
     auto recognizer = std::make_shared<TextRecognizerOpenCVImpl>();
     if (!recognizer->initModel(onnxTextModel, TextCorrector::GetAlphabet(), 192)) {
-        qDebug() << "fail to init opencv recognizer";
+        LOG_ERROR << "fail to init opencv recognizer";
         recognizer->freeModel();
         return nullptr;
     }
@@ -41,11 +41,11 @@ std::shared_ptr<TextRecognizer> TextRecognizer::MakeInstance() {
     if (!recognizer->initModel(
             ncnnTextModel, ncnnTextModelCfg,
             TextCorrector::GetAlphabet(), 3200)) {
-        qDebug() << "fail to init ncnn recognizer";
+        LOG_ERROR << "fail to init ncnn recognizer";
         recognizer->freeModel();
         return nullptr;
     }
-    qDebug() << "init ncnn recognizer success";
+    LOG_DEBUG << "init ncnn recognizer success";
 #endif
     return recognizer;
 }
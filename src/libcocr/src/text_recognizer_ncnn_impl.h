@@ -1,13 +1,13 @@
 #pragma once
 
 #include "cocr/text_recognizer.h"
+#include "base/log.h"
 
 
 #include <ncnn/net.h> // <ncnn/net.h>
 #include <ncnn/datareader.h> // <ncnn/datareader.h>
 
 #include <QFile>
-#include <QDebug>
 
 #include <numeric>
 #include <string>
@@ -71,7 +71,7 @@ public:
             const std::string &_words, const int &_maxWidth) {
         QFile cfgFile(_ncnnParam.c_str()), weightsFile(_ncnnBin.c_str());
         if (!cfgFile.open(QIODevice::ReadOnly) || !weightsFile.open(QIODevice::ReadOnly)) {
-            qDebug() << "fail in QFile read" << _ncnnBin.c_str() << "and" << _ncnnParam.c_str();
+            LOG_ERROR << "fail in QFile read" << _ncnnBin.c_str() << "and" << _ncnnParam.c_str();
             return false;
         }
         QByteArray cfg = cfgFile.readAll();
@@ -96,18 +96,18 @@ public:
             ncnn::DataReaderFromMemory cfgReader(cfgMem);
             int ret_param = net->load_param(cfgReader);
             if (ret_param != 0) {
-                qDebug() << "net->load_param(cfgReader) dies";
+                LOG_ERROR << "net->load_param(cfgReader) dies";
                 return false;
             }
             const unsigned char *weightsMem = (const unsigned char *) weights.data();
             ncnn::DataReaderFromMemory weightsReader(weightsMem);
             int ret_bin = net->load_model(weightsReader);
             if (ret_bin != 0) {
-                qDebug() << "net->load_model(weightsReader) dies";
+                LOG_ERROR << "net->load_model(weightsReader) dies";
                 return false;
             }
         } catch (std::exception &e) {
-            qDebug() << __FUNCTION__ << "catch" << e.what();
+            LOG_ERROR << "catch" << e.what();
             return false;
         }
         for (auto &c: _words) {
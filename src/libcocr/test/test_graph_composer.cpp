@@ -0,0 +1,153 @@
+#include <catch2/catch.hpp>
+#include "cocr/graph_composer.h"
+#include "ckit/atom.h"
+#include "ckit/bond.h"
+#include "../src/spatial_grid.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <tuple>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+/**
+ * 合成一页由正六边形网格组成的结构式，每 _labelEvery 个格点放一个 N 元素框
+ * @return 图元总数约为 _cols * _rows * 2 + 元素框数
+ */
+static std::vector<OCRItem> makeHexPage(const int &_cols, const int &_rows, const int &_labelEvery) {
+    std::vector<OCRItem> items;
+    const float len = 30, dx = len * std::sqrt(3.f), dy = len * 1.5f;
+    auto vertex = [&](const int &_c, const int &_r, const int &_k) -> point2f {
+        // 每个六边形的上顶点 k=0 与左上顶点 k=1
+        float cx = _c * dx + (_r % 2) * dx / 2, cy = _r * dy;
+        if (0 == _k) { return {cx, cy - len}; }
+        return {cx - dx / 2, cy - len / 2};
+    };
+    size_t uid = 0;
+    for (int r = 0; r < _rows; r++) {
+        for (int c = 0; c < _cols; c++) {
+            auto top = vertex(c, r, 0), left = vertex(c, r, 1);
+            point2f down = {left.first, left.second + len};
+            for (auto &to: {left, down}) {
+                OCRItem item(uid++);
+                item.setAsLineBond(BondType::SingleBond, to == left ? top : left, to);
+                items.push_back(item);
+            }
+            if (_labelEvery > 0 && (r * _cols + c) % _labelEvery == 0) {
+                OCRItem item(uid++);
+                std::string text = "N";
+                item.setAsText(text, {{top.first - 6, top.second - 8}, {top.first + 6, top.second + 8}});
+                items.push_back(item);
+            }
+        }
+    }
+    return items;
+}
+
+TEST_CASE("compose hexagon page", "[graph_composer]") {
+    auto items = makeHexPage(3, 3, 0);
+    GraphComposer composer;
+    auto mol = composer.compose(items);
+    REQUIRE(mol);
+    size_t atomNum = 0, bondNum = 0;
+    mol->loopAtomVec([&](Atom &) { ++atomNum; });
+    mol->loopBondVec([&](Bond &) { ++bondNum; });
+    REQUIRE(bondNum == items.size());
+    // 键端在格点处合并，原子数明显少于键端数
+    REQUIRE(atomNum < 2 * bondNum);
+}
+
+TEST_CASE("spatial index finds the same bonds as the pairwise scan", "[graph_composer]") {
+    auto items = makeHexPage(12, 10, 3);
+    // 键端抖动一点，让部分键端对落在阈值附近
+    for (size_t i = 0; i < items.size(); i++) {
+        if (OCRItemType::Line != items[i].type) { continue; }
+        auto from = items[i].getFrom(), to = items[i].getTo();
+        const float jitter = static_cast<float>(i % 7) - 3;
+        to.first += jitter;
+        to.second -= jitter;
+        items[i].setAsLineBond(items[i].getBondType(), from, to);
+    }
+    using atom_record = std::tuple<id_type, ElementType, float, float>;
+    using bond_record = std::tuple<id_type, BondType, id_type, id_type>;
+    auto compose = [&](const bool &_enabled, std::vector<atom_record> &_atoms, std::vector<bond_record> &_bonds) {
+        GraphComposer composer;
+        composer.setSpatialIndexEnabled(_enabled);
+        auto mol = composer.compose(items);
+        REQUIRE(mol);
+        for (Atom &atom: mol->atoms()) {
+            _atoms.emplace_back(atom.getId(), atom.getType(), atom.x, atom.y);
+        }
+        for (Bond &bond: mol->bonds()) {
+            _bonds.emplace_back(bond.getId(), bond.getType(), bond.getFrom()->getId(), bond.getTo()->getId());
+        }
+    };
+    std::vector<atom_record> gridAtoms, pairAtoms;
+    std::vector<bond_record> gridBonds, pairBonds;
+    compose(true, gridAtoms, gridBonds);
+    compose(false, pairAtoms, pairBonds);
+    REQUIRE(!gridBonds.empty());
+    REQUIRE(gridAtoms == pairAtoms);
+    REQUIRE(gridBonds == pairBonds);
+}
+
+TEST_CASE("spatial grid skips boxes with non-finite coordinates", "[graph_composer]") {
+    const float nan = std::numeric_limits<float>::quiet_NaN(), inf = std::numeric_limits<float>::infinity();
+    SpatialGrid grid;
+    grid.insert(0, {{0, 0}, {1, 1}});
+    grid.insert(1, {{nan, 0}, {1, 1}});
+    grid.insert(2, {{5, 5}, {inf, 6}});
+    grid.insert(3, {{4, 4}, {5, 5}});
+    // 坏框不参与求网格范围，build 能正常结束
+    grid.build(1, 4);
+    std::vector<size_t> ids;
+    grid.query({{-10, -10}, {10, 10}}, ids);
+    REQUIRE(ids == std::vector<size_t>{0, 3});
+    grid.query({{nan, nan}, {nan, nan}}, ids);
+    REQUIRE(ids.empty());
+}
+
+TEST_CASE("ocr item table matches item view", "[graph_composer]") {
+    auto items = makeHexPage(2, 2, 2);
+    OCRItem circle(items.size());
+    circle.setAsCircleBond({{10, 10}, {30, 34}});
+    items.push_back(circle);
+    auto table = OCRItemTable::FromItems(items);
+    REQUIRE(table.size() == items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        REQUIRE(table.getType(i) == items[i].type);
+        REQUIRE(table.getRect(i) == items[i].getRect());
+        REQUIRE(table.getCenter(i) == items[i].getCenter());
+        REQUIRE(table.getRadius(i) == items[i].getRadius());
+        REQUIRE(table.getText(i) == items[i].getText());
+        if (OCRItemType::Line == items[i].type) {
+            REQUIRE(table.getFrom(i) == items[i].getFrom());
+            REQUIRE(table.getTo(i) == items[i].getTo());
+            REQUIRE(table.getBondType(i) == items[i].getBondType());
+        }
+    }
+}
+
+TEST_CASE("compose benchmark on synthetic 5k-item page", "[.][benchmark][graph_composer]") {
+    auto items = makeHexPage(40, 55, 7);
+    REQUIRE(items.size() >= 5000);
+#ifdef __linux__
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    long rssBefore = usage.ru_maxrss;
+#endif
+    GraphComposer composer;
+    auto start = std::chrono::steady_clock::now();
+    auto mol = composer.compose(items);
+    auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    REQUIRE(mol);
+    std::cout << "compose " << items.size() << " items: " << ms << " ms";
+#ifdef __linux__
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << ", peak rss +" << (usage.ru_maxrss - rssBefore) << " KB";
+#endif
+    std::cout << std::endl;
+}
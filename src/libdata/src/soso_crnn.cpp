@@ -4,6 +4,7 @@
 #include "stroke/str.h"
 #include "data/g_chem_text.h"
 #include "ocv/algorithm.h"
+#include "ocv/augment.h"
 
 #include <QPainter>
 #include <QTextDocument>
@@ -213,16 +214,18 @@ std::pair<std::vector<uchar>, std::string> CRNNDataGenerator::getSample(
         hwStr.paintTo(img);
     }
 //    img.display("key-tmp");
-    img = CvUtil::Resize(img, {width, height});
-    if (_revertColor && StdUtil::byProb(0.5)) {// 反转颜色
-        img = CvUtil::RevertColor(img);
+    AugmentPipeline pipeline;
+    pipeline.resize({width, height});
+    if (_revertColor) {// 反转颜色
+        pipeline.revertColor(0.5);
     }
-    if (_gaussianNoise && StdUtil::byProb(0.2)) {
-        img = CvUtil::AddGaussianNoise(img);
+    if (_gaussianNoise) {
+        pipeline.gaussianNoise(0.2, 0.1);
     }
-    if (_saltNoise && StdUtil::byProb(0.6)) {
-        img = CvUtil::AddSaltPepperNoise(img, StdUtil::randInt() % 400);
+    if (_saltNoise) {
+        pipeline.saltPepperNoise(0.6, 400);
     }
+    img = pipeline.run(img);
 
     return {img.toBuffer(), convertToKey(_text)};
 }
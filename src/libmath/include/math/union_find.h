@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+/**
+ * 并查集：按大小合并加路径减半，均摊近似常数
+ * @tparam T 下标类型，节点是 [0, n) 的稠密下标
+ */
+template<typename T = unsigned int>
+class UnionFind {
+    std::vector<T> parent, sizes;
+    size_t componentNum = 0;
+
+public:
+    explicit UnionFind(const size_t &_n = 0) { reset(_n); }
+
+    void reset(const size_t &_n) {
+        parent.resize(_n);
+        sizes.assign(_n, 1);
+        for (size_t i = 0; i < _n; i++) { parent[i] = static_cast<T>(i); }
+        componentNum = _n;
+    }
+
+    size_t size() const { return parent.size(); }
+
+    size_t getComponentNum() const { return componentNum; }
+
+    T find(T _x) {
+        while (parent[_x] != _x) {
+            parent[_x] = parent[parent[_x]];
+            _x = parent[_x];
+        }
+        return _x;
+    }
+
+    /**
+     * @return 两个节点原本不在同一个集合里
+     */
+    bool unite(const T &_a, const T &_b) {
+        T ra = find(_a), rb = find(_b);
+        if (ra == rb) { return false; }
+        if (sizes[ra] < sizes[rb]) { std::swap(ra, rb); }
+        parent[rb] = ra;
+        sizes[ra] += sizes[rb];
+        --componentNum;
+        return true;
+    }
+
+    bool isConnected(const T &_a, const T &_b) { return find(_a) == find(_b); }
+
+    T getComponentSize(const T &_x) { return sizes[find(_x)]; }
+
+    /**
+     * 给每个节点一个 [0, getComponentNum()) 的集合编号，按集合里最小节点的顺序编号
+     */
+    std::vector<T> getLabels() {
+        std::vector<T> labels(parent.size()), rootLabels(parent.size(), static_cast<T>(-1));
+        T labelNum = 0;
+        for (size_t i = 0; i < parent.size(); i++) {
+            auto &rootLabel = rootLabels[find(static_cast<T>(i))];
+            if (static_cast<T>(-1) == rootLabel) { rootLabel = labelNum++; }
+            labels[i] = rootLabel;
+        }
+        return labels;
+    }
+};
@@ -0,0 +1,18 @@
+#include <catch2/catch.hpp>
+#include "math/union_find.h"
+
+TEST_CASE("union_find", "") {
+    UnionFind<unsigned int> uf(6);
+    REQUIRE(uf.getComponentNum() == 6);
+    REQUIRE(uf.unite(0, 1));
+    REQUIRE(uf.unite(4, 3));
+    REQUIRE(uf.unite(1, 4));
+    REQUIRE_FALSE(uf.unite(0, 3));
+    REQUIRE(uf.getComponentNum() == 3);
+    REQUIRE(uf.isConnected(0, 4));
+    REQUIRE_FALSE(uf.isConnected(0, 2));
+    REQUIRE(uf.getComponentSize(3) == 4);
+    // 编号按集合里最小节点的顺序
+    const std::vector<unsigned int> labels = {0, 0, 1, 0, 0, 2};
+    REQUIRE(uf.getLabels() == labels);
+}
@@ -39,7 +39,16 @@ public:
 
     static float GetInterArea(const rectf &r0, const rectf &r1);
 
-    static Mat Rotate(const Mat &mat, const float &angle);
+    /**
+     * @param _fast 为真时使用双线性插值，用于预处理阶段的大图
+     */
+    static Mat Rotate(const Mat &mat, const float &angle, const bool &_fast = false);
+
+    /**
+     * 在缩小到 _maxSide 的二值图上用水平投影的锐度估计倾斜角，先粗后细搜索
+     * @return 传给 Rotate 即可摆正的角度（度）
+     */
+    static float EstimateSkew(const Mat &mat, const float &_maxAngle = 10, const int &_maxSide = 256);
 
     static Mat GetFont(const std::string &_text, const std::string &_fontFamily = "Arial");
 
@@ -48,8 +57,28 @@ public:
     static Mat AddSaltPepperNoise(const Mat &mat, const int &n);
 
     static Mat RevertColor(const Mat &mat);
+
+    /**
+     * 按长边不小于 _maxSide 的原则，从 {1,2,4,8} 中选取最大的降采样倍数
+     * @param _srcSize 原图尺寸
+     * @param _maxSide 下游需要的长边，如检测器输入上限
+     */
+    static int GetReduceFactor(const Size<int> &_srcSize, const int &_maxSide);
+
+    /**
+     * 只解析 PNG/JPEG/BMP 文件头获取尺寸，不解码像素
+     * @return 无法识别时返回 {0,0}
+     */
+    static Size<int> PeekImageSize(const std::vector<unsigned char> &buffer);
 #ifndef Q_OS_WASM
     static Mat BufferToGrayMat(std::vector<unsigned char> &buffer);
+
+    /**
+     * 读取文件头得到原图尺寸，大图走 IMREAD_REDUCED_GRAYSCALE_2/4/8 直接解码出小图，
+     * JPEG 在 DCT 阶段缩放，解码耗时和内存都按倍数下降
+     * @param _maxSide 解码结果长边的下限，一般取检测器输入上限
+     */
+    static Mat BufferToGrayMat(std::vector<unsigned char> &buffer, const int &_maxSide);
 #endif
     static Mat HConcat(const Mat &m1, const Mat &m2);
 };
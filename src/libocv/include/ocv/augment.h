@@ -0,0 +1,64 @@
+#pragma once
+
+#include "els_ocv_export.h"
+#include "mat.h"
+
+#include <vector>
+#include <cstdint>
+
+enum class AugmentOpType : unsigned char {
+    RevertColor,
+    GaussianNoise,
+    SaltPepperNoise
+};
+
+struct AugmentOp {
+    AugmentOpType type;
+    // 该操作被执行的概率
+    float prob;
+    // GaussianNoise: 标准差上限；SaltPepperNoise: 噪点数上限
+    float param;
+};
+
+/**
+ * 把 缩放-反色-高斯噪声-椒盐噪声 融合成一次缩放加一次逐像素遍历
+ * 逐像素部分把 拉伸/反色 合成一张查找表，和噪声叠加在同一个循环里完成，
+ * 大图按行分块并行，每个分块使用独立的随机数发生器
+ */
+class ELS_OCV_EXPORT AugmentPipeline {
+    Size<int> dstSize;
+    std::vector<AugmentOp> ops;
+public:
+    AugmentPipeline();
+
+    /**
+     * @param _dstSize 输出尺寸，{0,0} 表示不缩放
+     */
+    AugmentPipeline &resize(const Size<int> &_dstSize);
+
+    AugmentPipeline &revertColor(const float &_prob);
+
+    /**
+     * 先做最大最小值拉伸，再叠加 N(0, sigma)，sigma 从 [0, _maxSigma) 均匀采样
+     */
+    AugmentPipeline &gaussianNoise(const float &_prob, const float &_maxSigma);
+
+    /**
+     * 噪点数从 [0, _maxCount) 均匀采样，一半为椒一半为盐
+     */
+    AugmentPipeline &saltPepperNoise(const float &_prob, const int &_maxCount);
+
+    const std::vector<AugmentOp> &getOps() const;
+
+    /**
+     * 使用当前线程的随机数发生器
+     */
+    Mat run(const Mat &_mat) const;
+
+    Mat run(const Mat &_mat, const uint64_t &_seed) const;
+
+    /**
+     * 设置当前线程随机数发生器的种子，便于复现
+     */
+    static void SetThreadSeed(const uint64_t &_seed);
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "els_ocv_export.h"
+
+#include <memory>
+#include <cstddef>
+
+namespace cv {
+    class MatAllocator;
+}
+
+/**
+ * 一次 OCR 请求内的图像内存池
+ * 请求开始时用 MatArenaScope 激活，期间 Mat::reset 申请的像素内存从大块内存中顺序切分，
+ * 请求结束时整体回绕，避免每个中间图像都走一次 malloc/free
+ * 带出请求的图像继续持有它所在的内存块，最后一张释放时这个块才归还系统，不妨碍下一次回绕
+ */
+class ELS_OCV_EXPORT MatArena {
+    class Impl;
+
+    Impl *impl;
+
+    friend class MatArenaScope;
+
+public:
+    explicit MatArena(const size_t &_blockSize = 16 << 20);
+
+    ~MatArena();
+
+    MatArena(const MatArena &) = delete;
+
+    MatArena &operator=(const MatArena &) = delete;
+
+    /**
+     * 回绕到第一个内存块，仍被图像引用的块移交给这些图像
+     * @return 回绕前是否已没有存活的图像
+     */
+    bool reset();
+
+    size_t getUsedBytes() const;
+
+    size_t getPeakBytes() const;
+
+    size_t getLiveCount() const;
+
+    /**
+     * @return 当前线程激活的分配器，未激活时为 nullptr，即使用 OpenCV 默认分配器
+     */
+    static cv::MatAllocator *Current();
+};
+
+/**
+ * RAII：在当前线程激活一个 MatArena，析构时恢复之前的分配器并尝试回绕
+ */
+class ELS_OCV_EXPORT MatArenaScope {
+    MatArena &arena;
+    cv::MatAllocator *prev;
+public:
+    explicit MatArenaScope(MatArena &_arena);
+
+    ~MatArenaScope();
+
+    MatArenaScope(const MatArenaScope &) = delete;
+
+    MatArenaScope &operator=(const MatArenaScope &) = delete;
+};
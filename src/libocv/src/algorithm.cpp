@@ -15,6 +15,12 @@
 #include <QTextDocument>
 
 #include <optional>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 
 static cv::Scalar convertToScalar(const rgb &color) {
     const auto&[r, g, b]=color;
@@ -196,7 +202,7 @@ float CvUtil::GetInterArea(const rectf &r0, const rectf &r1) {
     return inter.area();
 }
 
-Mat CvUtil::Rotate(const Mat &mat, const float &angle) {
+Mat CvUtil::Rotate(const Mat &mat, const float &angle, const bool &_fast) {
     auto matPtr = mat.getHolder();
     assert(matPtr);
     const auto &srcImage = *matPtr;
@@ -207,7 +213,7 @@ Mat CvUtil::Rotate(const Mat &mat, const float &angle) {
     assert(dstPtr);
     const auto &destImage = *dstPtr;
     cv::warpAffine(srcImage, destImage, M, cv::Size(srcImage.cols, srcImage.rows),
-                   cv::INTER_CUBIC, cv::BORDER_CONSTANT,
+                   _fast ? cv::INTER_LINEAR : cv::INTER_CUBIC, cv::BORDER_CONSTANT,
                    cv::Scalar(255, 255, 255));
 //    cv::erode(destImage, destImage, cv::Mat());
 //    cv::dilate(destImage, destImage, cv::Mat());
@@ -215,6 +221,60 @@ Mat CvUtil::Rotate(const Mat &mat, const float &angle) {
     return result;
 }
 
+float CvUtil::EstimateSkew(const Mat &mat, const float &_maxAngle, const int &_maxSide) {
+    auto matPtr = mat.getHolder();
+    assert(matPtr);
+    cv::Mat small;
+    const int longSide = (std::max)(matPtr->cols, matPtr->rows);
+    if (longSide <= 0) { return 0; }
+    if (longSide > _maxSide) {
+        const double k = static_cast<double>(_maxSide) / longSide;
+        cv::resize(*matPtr, small, cv::Size(), k, k, cv::INTER_AREA);
+    } else {
+        small = *matPtr;
+    }
+    if (small.channels() != 1) {
+        cv::cvtColor(small, small, small.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    }
+    // 没有缩放时 small 和调用方共享像素，二值化写到另一块
+    cv::Mat binary;
+    cv::threshold(small, binary, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+    std::vector<cv::Point> ink;
+    cv::findNonZero(binary, ink);
+    if (ink.size() < 16) { return 0; }
+
+    const float cx = small.cols / 2.f, cy = small.rows / 2.f;
+    const int binNum = static_cast<int>(std::ceil(std::hypot(small.cols, small.rows))) + 2;
+    std::vector<int> bins(binNum);
+    // 旋转 angle 度后的行坐标 y' = -x·sin + y·cos，投影越集中平方和越大
+    auto score = [&](const float &angle) -> double {
+        const float rad = angle * static_cast<float>(CV_PI) / 180.f;
+        const float s = std::sin(rad), c = std::cos(rad);
+        std::fill(bins.begin(), bins.end(), 0);
+        for (auto &pt: ink) {
+            int bin = static_cast<int>(-(pt.x - cx) * s + (pt.y - cy) * c + binNum / 2.f);
+            ++bins[(std::min)((std::max)(bin, 0), binNum - 1)];
+        }
+        double sum = 0;
+        for (auto &b: bins) { sum += static_cast<double>(b) * b; }
+        return sum;
+    };
+    float best = 0;
+    double bestScore = score(0);
+    for (float step: {1.f, 0.2f}) {
+        const float lo = (step == 1.f) ? -_maxAngle : best - 1.f;
+        const float hi = (step == 1.f) ? _maxAngle : best + 1.f;
+        for (float angle = lo; angle <= hi + 1e-4f; angle += step) {
+            double sc = score(angle);
+            if (sc > bestScore) {
+                bestScore = sc;
+                best = angle;
+            }
+        }
+    }
+    return best;
+}
+
 std::pair<cv::Point2f, cv::Point2f> getLineFromTo(const cv::Mat &mat, const cv::Rect2f &box) {
     cv::Point2f from, to;
     float w = box.width, h = box.height, x = box.x, y = box.y;
@@ -384,53 +444,80 @@ std::pair<cv::Point2f, cv::Point2f> getWedgeFromTo(const cv::Mat &mat, const cv:
  * @return 正包围盒
  */
 static std::optional<cv::Rect2i> getBoundBoxForBWFont(const cv::Mat &_uMat, const uchar &_bgPixel = 255) {
-    int xmin;
-    for (int x = 0; x < _uMat.cols; x++) {
-        for (int y = 0; y < _uMat.rows; y++) {
-            if (_bgPixel != _uMat.at<uchar>(y, x)) {
-                xmin = x;
-                goto L1;
-            }
+    // 按行扫描，内存连续；每行先以 8 字节为单位跳过整段背景
+    const uint64_t bgWord = 0x0101010101010101ULL * _bgPixel;
+    const int cols = _uMat.cols;
+    int xmin = cols, xmax = -1, ymin = -1, ymax = -1;
+    for (int y = 0; y < _uMat.rows; y++) {
+        const uchar *row = _uMat.ptr<uchar>(y);
+        int x = 0;
+        for (; x + 8 <= cols; x += 8) {
+            uint64_t word;
+            std::memcpy(&word, row + x, 8);
+            if (word != bgWord) { break; }
         }
-    }
-    return std::nullopt;
-    L1:;
-    int xmax;
-    for (int x = _uMat.cols - 1; x >= xmin; x--) {
-        for (int y = _uMat.rows - 1; y >= 0; y--) {
-            if (_bgPixel != _uMat.at<uchar>(y, x)) {
-                xmax = x;
-                goto L2;
-            }
+        for (; x < cols && row[x] == _bgPixel; x++);
+        if (x == cols) {
+            continue;
         }
-    }
-    xmax = xmin;
-    L2:;
-    int ymin;
-    for (int y = 0; y < _uMat.rows; y++) {
-        for (int x = xmin; x <= xmax; x++) {
-            if (_bgPixel != _uMat.at<uchar>(y, x)) {
-                ymin = y;
-                goto L3;
-            }
+        xmin = (std::min)(xmin, x);
+        // 右端只需在当前包围盒右侧查找
+        const int rBound = (std::max)(xmax, x);
+        int r = cols - 1;
+        for (; r - 7 > rBound; r -= 8) {
+            uint64_t word;
+            std::memcpy(&word, row + r - 7, 8);
+            if (word != bgWord) { break; }
         }
+        for (; r > rBound && row[r] == _bgPixel; r--);
+        xmax = (std::max)(xmax, r);
+        if (ymin < 0) { ymin = y; }
+        ymax = y;
     }
-    ymin = _uMat.rows - 1;
-    L3:;
-    int ymax;
-    for (int y = _uMat.rows - 1; y >= ymin; y--) {
-        for (int x = xmin; x <= xmax; x++) {
-            if (_bgPixel != _uMat.at<uchar>(y, x)) {
-                ymax = y;
-                goto L4;
-            }
-        }
+    if (ymin < 0) {
+        return std::nullopt;
     }
-    ymax = ymin;
-    L4:;
     return cv::Rect2i(xmin, ymin, xmax - xmin + 1, ymax - ymin + 1);
 }
 
+/**
+ * 渲染结果缓存，键为 (字体, 字号, 斜体, 富文本)，按最近最少使用淘汰
+ */
+class FontRenderCache {
+    using entry_type = std::pair<std::string, cv::Mat>;
+    std::list<entry_type> entries;
+    std::unordered_map<std::string, std::list<entry_type>::iterator> index;
+    size_t bytes = 0;
+    std::mutex mutex;
+    inline static const size_t MAX_BYTES = 64 << 20;
+public:
+    std::optional<cv::Mat> get(const std::string &_key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(_key);
+        if (index.end() == it) {
+            return std::nullopt;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second;
+    }
+
+    void put(const std::string &_key, const cv::Mat &_img) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (index.count(_key)) { return; }
+        entries.emplace_front(_key, _img);
+        index[_key] = entries.begin();
+        bytes += _img.total() * _img.elemSize();
+        while (bytes > MAX_BYTES && entries.size() > 1) {
+            auto &last = entries.back();
+            bytes -= last.second.total() * last.second.elemSize();
+            index.erase(last.first);
+            entries.pop_back();
+        }
+    }
+};
+
+static FontRenderCache sFontCache;
+
 Mat CvUtil::GetFont(const std::string &_text, const std::string &_fontFamily) {
 //    return cv::Mat(32,32,CV_8UC1,cv::Scalar(0));
     QString qData;
@@ -458,7 +545,22 @@ Mat CvUtil::GetFont(const std::string &_text, const std::string &_fontFamily) {
     font.setWeight(1);
     font.setItalic(StdUtil::byProb(0.5));
 
-    QImage image(1280, 164, QImage::Format_Grayscale8);
+    const int canvasWidth = 1280, canvasHeight = 164;
+    // 随机选择（斜体、符号样式）已经体现在键里，命中缓存不影响数据多样性
+    std::string key = _fontFamily + '\x1f' + std::to_string(font.pointSizeF()) + '\x1f'
+                      + (font.italic() ? '1' : '0') + '\x1f' + qData.toStdString();
+    // 缓存里的字形和返回值各持一份像素，调用方在返回值上作画不会污染缓存
+    auto to_mat = [&](const cv::Mat &_img) {
+        // 0x0 的 Mat 不申请像素内存，尺寸沿用画布大小
+        Mat mat(MatChannel::GRAY, DataType::UINT8, 0, 0);
+        *mat.getHolder() = _img.clone();
+        mat.setSize(canvasWidth, canvasHeight);
+        return mat;
+    };
+    if (auto cached = sFontCache.get(key)) {
+        return to_mat(*cached);
+    }
+    QImage image(canvasWidth, canvasHeight, QImage::Format_Grayscale8);
     image.fill(Qt::white);
     QPainter painter(&image);
     painter.setFont(font);
@@ -478,9 +580,8 @@ Mat CvUtil::GetFont(const std::string &_text, const std::string &_fontFamily) {
     }
 //    cv::imshow("1",cvImg);
 //    cv::waitKey(0);
-    Mat mat(MatChannel::GRAY, DataType::UINT8, image.width(), image.height());
-    *mat.getHolder() = cvImg.clone();
-    return mat;
+    sFontCache.put(key, cvImg.clone());
+    return to_mat(cvImg);
 }
 
 
@@ -588,7 +689,90 @@ Mat CvUtil::RevertColor(const Mat &mat) {
     cv::bitwise_not(src, dst);
     return result;
 }
+
+int CvUtil::GetReduceFactor(const Size<int> &_srcSize, const int &_maxSide) {
+    const int longSide = (std::max)(_srcSize.first, _srcSize.second);
+    if (_maxSide <= 0 || longSide <= 0) {
+        return 1;
+    }
+    int factor = 1;
+    while (factor < 8 && longSide / (factor * 2) >= _maxSide) {
+        factor *= 2;
+    }
+    return factor;
+}
+
+Size<int> CvUtil::PeekImageSize(const std::vector<unsigned char> &buffer) {
+    const unsigned char *p = buffer.data();
+    const size_t n = buffer.size();
+    auto be16 = [&](const size_t &i) -> int { return (p[i] << 8) | p[i + 1]; };
+    // 字节先提升成无符号数再移位，最高字节不会移进 int 的符号位
+    auto be32 = [&](const size_t &i) -> uint32_t {
+        return (uint32_t(p[i]) << 24) | (uint32_t(p[i + 1]) << 16) | (uint32_t(p[i + 2]) << 8) | uint32_t(p[i + 3]);
+    };
+    auto le32 = [&](const size_t &i) -> uint32_t {
+        return uint32_t(p[i]) | (uint32_t(p[i + 1]) << 8) | (uint32_t(p[i + 2]) << 16) | (uint32_t(p[i + 3]) << 24);
+    };
+    static const unsigned char pngSig[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+    if (n >= 24 && std::equal(pngSig, pngSig + 8, p)) {
+        // 签名后紧跟 IHDR 块：长度(4) 类型(4) 宽(4) 高(4)
+        return {static_cast<int>(be32(16)), static_cast<int>(be32(20))};
+    }
+    if (n >= 26 && p[0] == 'B' && p[1] == 'M') {
+        // 高度为负表示自上而下存储
+        return {static_cast<int>(le32(18)), std::abs(static_cast<int32_t>(le32(22)))};
+    }
+    if (n >= 4 && p[0] == 0xFF && p[1] == 0xD8) {
+        // 逐个跳过 JPEG 段，直到 SOFn
+        size_t i = 2;
+        while (i + 9 < n) {
+            if (p[i] != 0xFF) {
+                break;
+            }
+            const unsigned char marker = p[i + 1];
+            if (marker == 0xFF) {
+                ++i;
+                continue;
+            }
+            if (marker == 0xD8 || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+                i += 2;
+                continue;
+            }
+            const bool isSOF = marker >= 0xC0 && marker <= 0xCF
+                               && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+            if (isSOF) {
+                return {be16(i + 7), be16(i + 5)};
+            }
+            i += 2 + be16(i + 2);
+        }
+    }
+    return {0, 0};
+}
+
 #ifndef Q_OS_WASM
+Mat CvUtil::BufferToGrayMat(std::vector<unsigned char> &buffer, const int &_maxSide) {
+    int flag;
+    switch (GetReduceFactor(PeekImageSize(buffer), _maxSide)) {
+        case 8:
+            flag = cv::IMREAD_REDUCED_GRAYSCALE_8;
+            break;
+        case 4:
+            flag = cv::IMREAD_REDUCED_GRAYSCALE_4;
+            break;
+        case 2:
+            flag = cv::IMREAD_REDUCED_GRAYSCALE_2;
+            break;
+        default:
+            flag = cv::IMREAD_GRAYSCALE;
+    }
+    cv::Mat mat = cv::imdecode(buffer, flag);
+    Mat result(MatChannel::GRAY, DataType::UINT8, mat.cols, mat.rows);
+    auto &dst = *(result.getHolder());
+    dst = mat;
+    result.sync();
+    return result;
+}
+
 Mat CvUtil::BufferToGrayMat(std::vector<unsigned char> &buffer) {
     cv::Mat mat = cv::imdecode(buffer, cv::IMREAD_GRAYSCALE);
     Mat result(MatChannel::GRAY, DataType::UINT8, mat.cols, mat.rows);
@@ -0,0 +1,155 @@
+#include "ocv/augment.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+
+static std::mt19937_64 &threadEngine() {
+    static thread_local std::mt19937_64 engine(
+            std::random_device{}() ^ std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    return engine;
+}
+
+AugmentPipeline::AugmentPipeline() : dstSize({0, 0}) {
+}
+
+AugmentPipeline &AugmentPipeline::resize(const Size<int> &_dstSize) {
+    dstSize = _dstSize;
+    return *this;
+}
+
+AugmentPipeline &AugmentPipeline::revertColor(const float &_prob) {
+    ops.push_back({AugmentOpType::RevertColor, _prob, 0});
+    return *this;
+}
+
+AugmentPipeline &AugmentPipeline::gaussianNoise(const float &_prob, const float &_maxSigma) {
+    ops.push_back({AugmentOpType::GaussianNoise, _prob, _maxSigma});
+    return *this;
+}
+
+AugmentPipeline &AugmentPipeline::saltPepperNoise(const float &_prob, const int &_maxCount) {
+    ops.push_back({AugmentOpType::SaltPepperNoise, _prob, static_cast<float>(_maxCount)});
+    return *this;
+}
+
+const std::vector<AugmentOp> &AugmentPipeline::getOps() const {
+    return ops;
+}
+
+void AugmentPipeline::SetThreadSeed(const uint64_t &_seed) {
+    threadEngine().seed(_seed);
+}
+
+Mat AugmentPipeline::run(const Mat &_mat) const {
+    return run(_mat, threadEngine()());
+}
+
+Mat AugmentPipeline::run(const Mat &_mat, const uint64_t &_seed) const {
+    const auto &src = *(_mat.getHolder());
+    const auto&[dstW, dstH]=dstSize;
+    const bool needResize = dstW > 0 && dstH > 0 && (dstW != src.cols || dstH != src.rows);
+    Mat result(_mat.getChannel(), _mat.getDataType(),
+               needResize ? dstW : _mat.getWidth(), needResize ? dstH : _mat.getHeight());
+    auto &dst = *(result.getHolder());
+    if (needResize) {
+        cv::resize(src, dst, cv::Size{dstW, dstH}, 0, 0, cv::INTER_CUBIC);
+    } else {
+        src.copyTo(dst);
+    }
+    result.sync();
+    if (dst.depth() != CV_8U || dst.empty()) {
+        return result;
+    }
+
+    // 先决定本次执行哪些操作，参数也在这里一次采样完
+    std::mt19937_64 engine(_seed);
+    std::uniform_real_distribution<float> unit(0, 1);
+    bool revert = false, stretch = false;
+    float sigma = 0;
+    int saltCount = 0;
+    for (auto &op: ops) {
+        if (unit(engine) >= op.prob) { continue; }
+        switch (op.type) {
+            case AugmentOpType::RevertColor:
+                revert = !revert;
+                break;
+            case AugmentOpType::GaussianNoise:
+                stretch = true;
+                sigma = unit(engine) * op.param;
+                break;
+            case AugmentOpType::SaltPepperNoise:
+                saltCount = static_cast<int>(unit(engine) * op.param);
+                break;
+        }
+    }
+
+    // 拉伸与反色都是逐值映射，合成一张 256 项查找表
+    uchar lut[256];
+    double minVal = 0, maxVal = 255;
+    if (stretch) {
+        cv::minMaxLoc(dst.reshape(1), &minVal, &maxVal);
+        if (maxVal <= minVal) {
+            minVal = 0;
+            maxVal = 255;
+        }
+    }
+    bool identity = true;
+    for (int v = 0; v < 256; v++) {
+        int u = static_cast<int>(std::round((std::clamp<double>(v, minVal, maxVal) - minVal)
+                                            * 255.0 / (maxVal - minVal)));
+        if (revert) { u = 255 - u; }
+        lut[v] = cv::saturate_cast<uchar>(u);
+        identity = identity && lut[v] == v;
+    }
+    const bool addNoise = sigma > 0;
+    if (!identity || addNoise) {
+        const int rowLength = dst.cols * dst.channels();
+        const uint64_t stripeSeed = engine();
+        const int stripeRows = 32;
+        const int stripeNum = (dst.rows + stripeRows - 1) / stripeRows;
+        cv::parallel_for_(cv::Range(0, stripeNum), [&](const cv::Range &range) {
+            cv::Mat_<float> noise;
+            for (int s = range.start; s < range.end; s++) {
+                // 每个分块独立播种，结果与线程调度无关
+                cv::RNG rng(stripeSeed + s);
+                if (addNoise) {
+                    noise.create(1, rowLength);
+                }
+                const int rowEnd = (std::min)(dst.rows, (s + 1) * stripeRows);
+                for (int r = s * stripeRows; r < rowEnd; r++) {
+                    uchar *p = dst.ptr<uchar>(r);
+                    if (addNoise) {
+                        rng.fill(noise, cv::RNG::NORMAL, 0, sigma);
+                        const float *n = noise.ptr<float>(0);
+                        for (int i = 0; i < rowLength; i++) {
+                            p[i] = cv::saturate_cast<uchar>(lut[p[i]] + n[i]);
+                        }
+                    } else {
+                        for (int i = 0; i < rowLength; i++) {
+                            p[i] = lut[p[i]];
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    // 椒盐噪声点数很少，直接按指针写
+    if (saltCount > 1) {
+        const int channels = dst.channels();
+        std::uniform_int_distribution<int> xDist(0, dst.cols - 1), yDist(0, dst.rows - 1);
+        std::bernoulli_distribution salt(0.5);
+        for (int k = 0; k < saltCount / 2; k++) {
+            uchar *p = dst.ptr<uchar>(yDist(engine)) + xDist(engine) * channels;
+            for (int c = 0; c < channels; c++) {
+                p[c] = salt(engine) ? 255 : 0;
+            }
+        }
+    }
+    return result;
+}
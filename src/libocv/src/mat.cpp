@@ -1,4 +1,5 @@
 #include "ocv/mat.h"
+#include "ocv/mat_arena.h"
 #include "base/std_util.h"
 
 #include <opencv2/core/mat.hpp>
@@ -19,15 +20,15 @@ Mat::Mat(const MatChannel &channel, const DataType &dataType, const int &w, cons
     reset();
 }
 
-Mat::Mat(Mat &&mat) : Mat(mat.mChannel, mat.mDataType, mat.mWidth, mat.mHeight) {
-    holder = std::move(mat.holder);
+// 复制、移动都不经过 reset，免得先申请一块马上丢掉的像素内存
+Mat::Mat(Mat &&mat)
+        : holder(std::move(mat.holder)), mDataType(mat.mDataType), mChannel(mat.mChannel),
+          mWidth(mat.mWidth), mHeight(mat.mHeight) {
 }
 
-Mat::Mat(const Mat &mat) : Mat(mat.mChannel, mat.mDataType, mat.mWidth, mat.mHeight) {
-    if (mat.holder) {
-        holder = std::make_shared<cv::Mat>();
-        *holder = *mat.holder;
-    }
+Mat::Mat(const Mat &mat)
+        : holder(mat.holder ? std::make_shared<cv::Mat>(*mat.holder) : nullptr), mDataType(mat.mDataType),
+          mChannel(mat.mChannel), mWidth(mat.mWidth), mHeight(mat.mHeight) {
 }
 
 MatChannel Mat::getChannel() const {
@@ -96,8 +97,11 @@ void Mat::drawFill(const std::vector<point2i> &pts, const rgb &color) {
 }
 
 void Mat::reset() {
-    holder = std::make_shared<cv::Mat>(
-            mHeight, mWidth, getOpenCVDataTypeMacro(), 255);
+    holder = std::make_shared<cv::Mat>();
+    // 处于 MatArenaScope 内时从请求级内存池分配
+    holder->allocator = MatArena::Current();
+    holder->create(mHeight, mWidth, getOpenCVDataTypeMacro());
+    holder->setTo(255);
 }
 
 void Mat::drawEllipse(
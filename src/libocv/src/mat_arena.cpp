@@ -0,0 +1,201 @@
+#include "ocv/mat_arena.h"
+
+#include <opencv2/core/mat.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+static thread_local cv::MatAllocator *sCurrentAllocator = nullptr;
+
+class MatArena::Impl : public cv::MatAllocator {
+    struct Block {
+        std::unique_ptr<uchar[]> data;
+        size_t size;
+        // 切分自这个块、还没释放的图像数
+        size_t live;
+    };
+    // 分配器接口都是 const 的，内部状态只能 mutable
+    mutable std::mutex mutex;
+    // 正在切分的块；retired 是回绕时仍有图像引用的块，交给这些图像，最后一张释放时归还系统
+    mutable std::vector<std::unique_ptr<Block>> blocks, retired;
+    mutable size_t blockIdx, offset, used, peak, live;
+    // MatArena 已析构，最后一张图像释放时销毁自己
+    mutable bool isOrphaned;
+    const size_t blockSize;
+    inline static const size_t ALIGN = 64;
+
+    static std::unique_ptr<Block> NewBlock(const size_t &_size) {
+        return std::unique_ptr<Block>(new Block{std::unique_ptr<uchar[]>(new uchar[_size + ALIGN]), _size, 0});
+    }
+
+    uchar *bump(const size_t &_size, Block *&_block) const {
+        const size_t size = (_size + ALIGN - 1) / ALIGN * ALIGN;
+        std::lock_guard<std::mutex> lock(mutex);
+        while (blockIdx < blocks.size() && offset + size > blocks[blockIdx]->size) {
+            ++blockIdx;
+            offset = 0;
+        }
+        if (blockIdx == blocks.size()) {
+            blocks.push_back(NewBlock((std::max)(blockSize, size)));
+            offset = 0;
+        }
+        _block = blocks[blockIdx].get();
+        auto base = reinterpret_cast<uintptr_t>(_block->data.get());
+        uchar *ptr = reinterpret_cast<uchar *>((base + ALIGN - 1) / ALIGN * ALIGN) + offset;
+        offset += size;
+        used += size;
+        peak = (std::max)(peak, used);
+        ++_block->live;
+        ++live;
+        return ptr;
+    }
+
+public:
+    explicit Impl(const size_t &_blockSize)
+            : blockIdx(0), offset(0), used(0), peak(0), live(0), isOrphaned(false), blockSize(_blockSize) {}
+
+#if CV_VERSION_MAJOR >= 4
+    using access_flag_type = cv::AccessFlag;
+#else
+    using access_flag_type = int;
+#endif
+
+    // 与 OpenCV StdMatAllocator 相同，只是数据指针来自内存池
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data0, size_t *step,
+                           access_flag_type, cv::UMatUsageFlags) const override {
+        size_t total = CV_ELEM_SIZE(type);
+        for (int i = dims - 1; i >= 0; i--) {
+            if (step) {
+                if (data0 && step[i] != CV_AUTOSTEP) {
+                    CV_Assert(total <= step[i]);
+                    total = step[i];
+                } else {
+                    step[i] = total;
+                }
+            }
+            total *= sizes[i];
+        }
+        auto *u = new cv::UMatData(this);
+        if (data0) {
+            u->data = u->origdata = static_cast<uchar *>(data0);
+            u->flags |= cv::UMatData::USER_ALLOCATED;
+        } else {
+            Block *block = nullptr;
+            u->data = u->origdata = bump(total, block);
+            u->userdata = block;
+        }
+        u->size = total;
+        return u;
+    }
+
+    bool allocate(cv::UMatData *u, access_flag_type, cv::UMatUsageFlags) const override {
+        return u != nullptr;
+    }
+
+    void deallocate(cv::UMatData *u) const override {
+        if (!u) { return; }
+        CV_Assert(u->urefcount == 0);
+        CV_Assert(u->refcount == 0);
+        bool isLast = false;
+        if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+            // 正在切分的块只在回绕时整体回收，这里只记账
+            std::lock_guard<std::mutex> lock(mutex);
+            auto block = static_cast<Block *>(u->userdata);
+            if (0 == --block->live) {
+                auto it = std::find_if(retired.begin(), retired.end(), [&](const std::unique_ptr<Block> &_b) {
+                    return _b.get() == block;
+                });
+                if (retired.end() != it) { retired.erase(it); }
+            }
+            isLast = 0 == --live && isOrphaned;
+        }
+        delete u;
+        if (isLast) { delete this; }
+    }
+
+    /**
+     * 仍有图像引用的块移出去，剩下的回绕
+     * @return 回绕前是否已没有存活的图像
+     */
+    bool rewind() {
+        std::lock_guard<std::mutex> lock(mutex);
+        const bool isIdle = 0 == live;
+        for (auto &block: blocks) {
+            if (block->live > 0) { retired.push_back(std::move(block)); }
+        }
+        blocks.erase(std::remove(blocks.begin(), blocks.end(), nullptr), blocks.end());
+        // 只保留一个内存块，大小取上次请求的峰值，下次请求通常不用再申请
+        if (blocks.size() != 1 || blocks[0]->size < peak) {
+            blocks.clear();
+            blocks.push_back(NewBlock((std::max)(blockSize, peak)));
+        }
+        blockIdx = offset = used = 0;
+        return isIdle;
+    }
+
+    /**
+     * 没有存活的图像时立即销毁，否则交给最后释放的那张图像
+     */
+    void release() {
+        bool isIdle;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isOrphaned = true;
+            isIdle = 0 == live;
+        }
+        if (isIdle) { delete this; }
+    }
+
+    size_t getUsed() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return used;
+    }
+
+    size_t getPeak() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return peak;
+    }
+
+    size_t getLive() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return live;
+    }
+};
+
+MatArena::MatArena(const size_t &_blockSize) : impl(new Impl(_blockSize)) {
+}
+
+MatArena::~MatArena() {
+    impl->release();
+}
+
+bool MatArena::reset() {
+    return impl->rewind();
+}
+
+size_t MatArena::getUsedBytes() const {
+    return impl->getUsed();
+}
+
+size_t MatArena::getPeakBytes() const {
+    return impl->getPeak();
+}
+
+size_t MatArena::getLiveCount() const {
+    return impl->getLive();
+}
+
+cv::MatAllocator *MatArena::Current() {
+    return sCurrentAllocator;
+}
+
+MatArenaScope::MatArenaScope(MatArena &_arena) : arena(_arena), prev(sCurrentAllocator) {
+    sCurrentAllocator = arena.impl;
+}
+
+MatArenaScope::~MatArenaScope() {
+    sCurrentAllocator = prev;
+    arena.reset();
+}
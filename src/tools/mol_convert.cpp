@@ -0,0 +1,63 @@
+/**
+ * a tool to convert a line-based molecule corpus (smi, inchi, ...) in parallel
+ * usage: mol_convert <input> <output> [-i inFormat] [-f outFormat] [-j threads] [--refined] [--hydrogens]
+ */
+#include "ckit/mol_converter.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+
+static std::string GetSuffix(const std::string &_path) {
+    const auto pos = _path.find_last_of('.');
+    if (std::string::npos == pos || _path.find_first_of("/\\", pos) != std::string::npos) {
+        return "";
+    }
+    return _path.substr(pos + 1);
+}
+
+static int PrintUsage() {
+    std::cerr << "usage: mol_convert <input> <output> [-i inFormat] [-f outFormat] [-j threads]"
+                 " [--refined] [--hydrogens]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) { return PrintUsage(); }
+    const std::string inPath = argv[1], outPath = argv[2];
+    MolConverter::Options options;
+    if (auto suffix = GetSuffix(inPath); !suffix.empty()) { options.inputFormat = suffix; }
+    if (auto suffix = GetSuffix(outPath); !suffix.empty()) { options.outputFormat = suffix; }
+    for (int i = 3; i < argc; i++) {
+        const std::string arg = argv[i];
+        if ("--refined" == arg) {
+            options.quality = Coord3DQuality::Refined;
+        } else if ("--hydrogens" == arg) {
+            options.addHydrogens = true;
+        } else if (i + 1 < argc && "-i" == arg) {
+            options.inputFormat = argv[++i];
+        } else if (i + 1 < argc && "-f" == arg) {
+            options.outputFormat = argv[++i];
+        } else if (i + 1 < argc && "-j" == arg) {
+            options.threadNum = std::stoul(argv[++i]);
+        } else {
+            return PrintUsage();
+        }
+    }
+    std::ifstream in(inPath);
+    if (!in) {
+        std::cerr << "failed to open " << inPath << std::endl;
+        return 1;
+    }
+    std::ofstream out(outPath);
+    if (!out) {
+        std::cerr << "failed to open " << outPath << std::endl;
+        return 1;
+    }
+    const auto report = MolConverter(options).convert(in, out);
+    for (auto &failure: report.failures) {
+        std::cerr << "#" << failure.index << " " << failure.input << ": " << failure.message << "\n";
+    }
+    std::cerr << report.total << " molecules, " << report.failures.size() << " failed, "
+              << report.seconds << " s, " << report.getMolsPerSecond() << " mol/s" << std::endl;
+    return report.failures.empty() ? 0 : 2;
+}